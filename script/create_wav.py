@@ -22,5 +22,15 @@ sig = np.round(sig * np.ldexp(1, 31)).astype(np.int32)
 
 wavfile.write("input.wav", SAMPLE_RATE, sig)
 
+# Multichannel input, used by Part 5I. Consecutive samples of the signal are
+# dealt out to the channels in turn, so that every channel is different.
+MC_CHANNEL_COUNT = 8
+MC_DURATION_SMP = 1536
+
+mc_sig = sig[:MC_CHANNEL_COUNT * MC_DURATION_SMP].reshape(MC_DURATION_SMP, 
+                                                          MC_CHANNEL_COUNT)
+
+wavfile.write("input_8ch.wav", SAMPLE_RATE, mc_sig)
+
 
 
@@ -0,0 +1,118 @@
+# Copyright 2022-2023 XMOS LIMITED.
+# This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+# Logs, and optionally plots, the live metrics printed by a stage built with
+# -DLIVE_METRICS_MS=<interval> (see src/common/timing/timing.h) while it runs.
+# The stage's output is read from stdin and passed through, e.g.
+#
+#   xrun --xscope bin/part3A.xe | python live_metrics.py --csv out/part3A_live.csv
+#   bin/part3A | python live_metrics.py --plot
+
+import sys
+import time
+import argparse
+
+LIVE_PREFIX = "live:"
+FIELDS = ["frames", "frame_ave_ns", "frame_max_ns", "min_slack_ns", "misses",
+          "throughput"]
+
+
+def parse(line):
+  # "live: frames=34 frame_ave_ns=45430 ..."
+  values = {}
+  for item in line[len(LIVE_PREFIX):].split():
+    key, _, value = item.partition("=")
+    if key in FIELDS:
+      values[key] = int(value)
+  return values if len(values) == len(FIELDS) else None
+
+
+class LivePlot:
+
+  def __init__(self):
+    import matplotlib.pyplot as plt
+    self.plt = plt
+    plt.ion()
+    fig, ax = plt.subplots(3, 1, sharex=True)
+    ax[0].set_ylabel("frame time (us)")
+    ax[1].set_ylabel("min slack (us)")
+    ax[2].set_ylabel("samples/s")
+    ax[2].set_xlabel("time (s)")
+    self.ax = ax
+    # Each line, and how to get its value (in the plotted units) from a row
+    self.lines = [
+      (ax[0].plot([], [], "b", label="average")[0],
+       lambda r: r["frame_ave_ns"] / 1000),
+      (ax[0].plot([], [], "r", label="max")[0],
+       lambda r: r["frame_max_ns"] / 1000),
+      (ax[1].plot([], [], "g")[0], lambda r: r["min_slack_ns"] / 1000),
+      (ax[2].plot([], [], "k")[0], lambda r: r["throughput"]),
+    ]
+    ax[0].legend()
+    self.t = []
+    self.rows = []
+
+  def add(self, t, row):
+    self.t.append(t)
+    self.rows.append(row)
+    for line, value in self.lines:
+      line.set_data(self.t, [value(r) for r in self.rows])
+    for a in self.ax:
+      a.relim()
+      a.autoscale_view()
+    self.plt.pause(0.001)
+
+
+def run(args):
+  csv = open(args.csv, "w") if args.csv else None
+  if csv:
+    csv.write(",".join(["time_s"] + FIELDS) + "\n")
+
+  plot = LivePlot() if args.plot else None
+  t0 = time.monotonic()
+  worst = None
+
+  for line in sys.stdin:
+    line = line.rstrip("\n")
+    if not line.startswith(LIVE_PREFIX):
+      if not args.quiet:
+        print(line, flush=True)
+      continue
+
+    row = parse(line)
+    if row is None:
+      continue
+
+    # Lines are timestamped on arrival, which is close enough for watching
+    # drift over a long run.
+    t = time.monotonic() - t0
+    if worst is None or row["frame_max_ns"] > worst:
+      worst = row["frame_max_ns"]
+
+    print(f"[{t:8.1f} s] frame ave {row['frame_ave_ns']/1000:9.2f} us, "
+          f"max {row['frame_max_ns']/1000:9.2f} us (worst {worst/1000:.2f}), "
+          f"min slack {row['min_slack_ns']/1000:10.2f} us, "
+          f"misses {row['misses']}, {row['throughput']} samples/s", flush=True)
+
+    if csv:
+      csv.write(",".join([f"{t:.3f}"] + [str(row[f]) for f in FIELDS]) + "\n")
+      csv.flush()
+    if plot:
+      plot.add(t, row)
+
+  if csv:
+    csv.close()
+  if plot:
+    plot.plt.ioff()
+    plot.plt.show()
+
+
+if __name__ == "__main__":
+  parser = argparse.ArgumentParser(
+      description="Log and plot a stage's live metrics, read from stdin")
+  parser.add_argument("--csv", help="Also write the metrics to this CSV file")
+  parser.add_argument("--plot", action="store_true",
+                      help="Plot the metrics as they arrive")
+  parser.add_argument("-q", "--quiet", action="store_true",
+                      help="Don't pass through the stage's other output")
+  run(parser.parse_args())
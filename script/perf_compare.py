@@ -0,0 +1,348 @@
+# Copyright 2022-2023 XMOS LIMITED.
+# This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+# Keeps a store of performance results, and compares new results against a
+# baseline, flagging any stage whose mean frame time got slower by more than the
+# noise in its frame times. Run it from the workspace root, e.g.
+#
+#   python xmath_walkthrough/script/perf_compare.py record --label before
+#   python xmath_walkthrough/script/perf_compare.py baseline --runs 3
+#   python xmath_walkthrough/script/perf_compare.py compare
+#
+# Results are read from the json files in out/ -- the <stage>.json file of each
+# stage that was run, and benchmark.json (see src/benchmark/). Each result is
+# keyed by its stage, e.g. "part2C", or by the benchmark's stage, tap count and
+# frame size, e.g. "benchmark/part2C/1024x256". The store holds:
+#
+#   <store>/runs/<time>[-<label>].json   Every recorded run
+#   <store>/baseline.json                The baseline results of each platform
+
+import os
+import re
+import sys
+import json
+import math
+import argparse
+import datetime
+import statistics
+
+STAGE_NAME = re.compile(r"part\w+")
+
+# A result's mean frame time and frame time percentiles (ns), and the number of
+# frames timed. The mean is exact. The percentiles are the middle of the
+# histogram bucket they fall in, which may be over 10% from the true value, so
+# they are only used to estimate the spread of the frame times and to watch the
+# tail.
+RESULT_FIELDS = ["frame_time", "p50", "p90", "p99", "max", "count"]
+
+# z-scores of the 90th and 99th percentiles of a normal distribution, to
+# estimate the standard deviation of the frame times
+Z_P90 = 1.2816
+Z_P99 = 2.3263
+
+# Frames needed before a result's p99 is compared. With fewer, the p99 is
+# little more than the few slowest frames, which are mostly noise.
+TAIL_MIN_COUNT = 1000
+
+
+def load_out(out_dir):
+  # Gather the results in out/ as {platform: {key: result}}
+  results = {}
+
+  def add(platform, key, result):
+    results.setdefault(platform, {})[key] = result
+
+  for name in sorted(os.listdir(out_dir)):
+    stem, ext = os.path.splitext(name)
+    if ext != ".json":
+      continue
+    with open(os.path.join(out_dir, name)) as f:
+      try:
+        data = json.load(f)
+      except json.JSONDecodeError:
+        print(f"Couldn't parse {name}. Skipping.")
+        continue
+
+    if stem == "benchmark":
+      for r in data["results"]:
+        key = f"benchmark/{r['stage']}/{r['tap_count']}x{r['frame_size']}"
+        add(data["platform"], key, {
+            "frame_time": r["frame_time"],
+            "p50": r["frame_time_p50"],
+            "p99": r["frame_time_p99"],
+            "max": r["frame_time_max"],
+            "count": data["frames"]})
+
+    elif STAGE_NAME.fullmatch(stem) and "frame_time" in data:
+      # Older stage outputs have no distribution, only the average
+      dist = data.get("frame_time_dist", {})
+      ave = data["frame_time"]
+      add(data.get("platform", "xcore"), stem, {
+          "frame_time": ave,
+          "p50": dist.get("p50", ave),
+          "p90": dist.get("p90", ave),
+          "p99": dist.get("p99", ave),
+          "max": dist.get("max", ave),
+          "count": dist.get("count", 0)})
+
+  return results
+
+
+def run_dir(store):
+  return os.path.join(store, "runs")
+
+
+def list_runs(store):
+  # Stored run names, oldest first. Names start with the time of the run.
+  path = run_dir(store)
+  if not os.path.isdir(path):
+    return []
+  return sorted(os.path.splitext(n)[0] for n in os.listdir(path)
+                if n.endswith(".json"))
+
+
+def load_run(store, name):
+  with open(os.path.join(run_dir(store), f"{name}.json")) as f:
+    return json.load(f)
+
+
+def save_run(store, results, label=None):
+  os.makedirs(run_dir(store), exist_ok=True)
+  now = datetime.datetime.now()
+  name = now.strftime("%Y%m%d-%H%M%S") + (f"-{label}" if label else "")
+  # Runs recorded within the same second get a suffix
+  base, k = name, 1
+  while os.path.exists(os.path.join(run_dir(store), f"{name}.json")):
+    name, k = f"{base}.{k}", k + 1
+  with open(os.path.join(run_dir(store), f"{name}.json"), "w") as f:
+    json.dump({"time": now.isoformat(timespec="seconds"), "label": label,
+               "results": results}, f, indent=1)
+  return name
+
+
+def load_baseline(store):
+  path = os.path.join(store, "baseline.json")
+  if not os.path.exists(path):
+    return None
+  with open(path) as f:
+    return json.load(f)
+
+
+def make_baseline(runs):
+  # Each result is the median of its results in the given runs. The mean frame
+  # time and p99 of each run are kept too, as the run-to-run noise is usually
+  # larger than the noise within a single run.
+  merged = {}
+  for run in runs:
+    for platform, results in run["results"].items():
+      for key, r in results.items():
+        merged.setdefault(platform, {}).setdefault(key, []).append(r)
+
+  baseline = {}
+  for platform, results in merged.items():
+    for key, rs in results.items():
+      b = {}
+      for field in RESULT_FIELDS:
+        values = [r[field] for r in rs if field in r]
+        if values:
+          b[field] = statistics.median(values)
+      b["run_mean"] = [r["frame_time"] for r in rs]
+      b["run_p99"] = [r["p99"] for r in rs]
+      baseline.setdefault(platform, {})[key] = b
+  return baseline
+
+
+def std_dev(r):
+  # Estimate the standard deviation of a result's frame times from the spread
+  # of its upper percentiles
+  if "p90" in r and r["p90"] > r["p50"]:
+    return (r["p90"] - r["p50"]) / Z_P90
+  return max(r["p99"] - r["p50"], 0) / Z_P99
+
+
+def threshold_ns(base, new, args):
+  # The smallest change in mean frame time (ns) which isn't put down to noise.
+  # The standard error of a mean is sigma / sqrt(n).
+  var = 0.0
+  for r in (base, new):
+    var += std_dev(r) ** 2 / max(r.get("count", 0), 1)
+  noise = args.z * math.sqrt(var)
+
+  run_mean = base.get("run_mean", [])
+  if len(run_mean) > 1:
+    noise = max(noise, args.z * statistics.stdev(run_mean))
+
+  return max(noise, args.min_change * base["frame_time"])
+
+
+def tail_threshold_ns(base, new, thresh, args):
+  # The smallest change in p99 (ns) which isn't put down to noise, or None if
+  # either result has too few frames to tell. The p99 moves a whole histogram
+  # bucket (12.5% to 25% of its value) at a time, so --tail-change should stay
+  # above that.
+  if min(base.get("count", 0), new.get("count", 0)) < TAIL_MIN_COUNT:
+    return None
+  noise = max(thresh, args.tail_change * base["p99"])
+  run_p99 = base.get("run_p99", [])
+  if len(run_p99) > 1:
+    noise = max(noise, args.z * statistics.stdev(run_p99))
+  return noise
+
+
+def compare(base, new, args):
+  # Compare two sets of {platform: {key: result}}, as rows of
+  # (platform, key, base, new, threshold, status)
+  rows = []
+  for platform in sorted(set(base) | set(new)):
+    b_res = base.get(platform, {})
+    n_res = new.get(platform, {})
+    for key in sorted(set(b_res) | set(n_res)):
+      b, n = b_res.get(key), n_res.get(key)
+      if b is None or n is None:
+        rows.append((platform, key, b, n, 0.0,
+                     "new" if b is None else "missing"))
+        continue
+
+      thresh = threshold_ns(b, n, args)
+      tail_thresh = tail_threshold_ns(b, n, thresh, args)
+      delta = n["frame_time"] - b["frame_time"]
+      if delta > thresh:
+        status = "SLOWER"
+      elif tail_thresh is not None and n["p99"] - b["p99"] > tail_thresh:
+        status = "TAIL"
+      elif delta < -thresh:
+        status = "faster"
+      else:
+        status = "ok"
+      rows.append((platform, key, b, n, thresh, status))
+  return rows
+
+
+def print_rows(rows, show_all):
+  print(f"{'Platform':8} {'Result':30} {'Base mean (us)':>14} {'Mean (us)':>10}"
+        f" {'Change':>8} {'Noise':>7} {'Base p99 (us)':>14} {'p99 (us)':>10}"
+        f"  Status")
+  for platform, key, b, n, thresh, status in rows:
+    if not show_all and status == "ok":
+      continue
+    if b is None or n is None:
+      print(f"{platform:8} {key:30} {'':>14} {'':>10} {'':>8} {'':>7}"
+            f" {'':>14} {'':>10}  {status}")
+      continue
+    base_ave, ave = b["frame_time"], n["frame_time"]
+    change = (ave - base_ave) / base_ave if base_ave else 0.0
+    noise = thresh / base_ave if base_ave else 0.0
+    print(f"{platform:8} {key:30} {base_ave/1000:14.3f} {ave/1000:10.3f}"
+          f" {100*change:+7.2f}% {100*noise:6.2f}% {b['p99']/1000:14.3f}"
+          f" {n['p99']/1000:10.3f}  {status}")
+
+
+def cmd_record(args):
+  results = load_out(args.out)
+  if not results:
+    sys.exit(f"No results found in {args.out}")
+  name = save_run(args.store, results, args.label)
+  print(f"Recorded {sum(len(r) for r in results.values())} results as {name}")
+
+
+def save_baseline(store, names):
+  baseline = make_baseline([load_run(store, n) for n in names])
+  os.makedirs(store, exist_ok=True)
+  with open(os.path.join(store, "baseline.json"), "w") as f:
+    json.dump({"runs": names, "results": baseline}, f, indent=1)
+  print(f"Baseline made from {', '.join(names)}")
+
+
+def cmd_baseline(args):
+  names = args.run or list_runs(args.store)[-args.runs:]
+  if not names:
+    sys.exit(f"No runs stored in {args.store}. Use 'record' first.")
+  save_baseline(args.store, names)
+
+
+def cmd_compare(args):
+  new = (load_run(args.store, args.run)["results"] if args.run
+         else load_out(args.out))
+  recorded = None
+  if args.record and not args.run:
+    if not new:
+      sys.exit(f"No results found in {args.out}")
+    recorded = save_run(args.store, new, args.label)
+    print(f"Recorded as {recorded}")
+
+  if args.against:
+    base = make_baseline([load_run(args.store, args.against)])
+  else:
+    stored = load_baseline(args.store)
+    if stored is None:
+      # The first recorded run becomes the baseline, so there is nothing to
+      # compare it with yet.
+      if recorded is None:
+        sys.exit(f"No baseline in {args.store}. Use 'record' and 'baseline' "
+                 "first.")
+      save_baseline(args.store, [recorded])
+      return
+    base = stored["results"]
+
+  rows = compare(base, new, args)
+  print_rows(rows, args.all)
+
+  flagged = [r for r in rows if r[5] in ("SLOWER", "TAIL")]
+  print(f"\n{len(flagged)} of {len(rows)} results regressed.")
+  if flagged and not args.no_fail:
+    sys.exit(1)
+
+
+def add_threshold_args(parser):
+  parser.add_argument("--min-change", type=float, default=0.02,
+                      help="Smallest relative change in mean frame time which "
+                           "is flagged "
+                           "(default: 0.02)")
+  parser.add_argument("--z", type=float, default=3.0,
+                      help="Number of standard errors of noise a change in mean "
+                           "frame time must exceed to be flagged (default: 3)")
+  parser.add_argument("--tail-change", type=float, default=0.25,
+                      help="Smallest relative change in p99 which is flagged, "
+                           f"for results of at least {TAIL_MIN_COUNT} frames "
+                           "(default: 0.25)")
+
+
+if __name__ == "__main__":
+  parser = argparse.ArgumentParser(
+      description="Store performance results and compare them with a baseline")
+  parser.add_argument("--store", default="perf",
+                      help="Directory of the results store (default: perf)")
+  parser.add_argument("--out", default="out",
+                      help="Directory of the results to read (default: out)")
+  sub = parser.add_subparsers(dest="command", required=True)
+
+  p = sub.add_parser("record", help="Store the results in out/ as a new run")
+  p.add_argument("--label", help="Appended to the run's name")
+  p.set_defaults(func=cmd_record)
+
+  p = sub.add_parser("baseline", help="Make the baseline from stored runs")
+  p.add_argument("run", nargs="*", help="The runs to use")
+  p.add_argument("--runs", type=int, default=1,
+                 help="Use the latest this many runs, if none are given "
+                      "(default: 1)")
+  p.set_defaults(func=cmd_baseline)
+
+  p = sub.add_parser("compare",
+                     help="Compare the results in out/ with the baseline")
+  p.add_argument("run", nargs="?",
+                 help="Compare this stored run instead of out/")
+  p.add_argument("--against", help="Compare against this stored run instead "
+                                   "of the baseline")
+  p.add_argument("--record", action="store_true",
+                 help="Also store the results in out/ as a new run, which "
+                      "becomes the baseline if there isn't one")
+  p.add_argument("--label", help="Appended to the recorded run's name")
+  p.add_argument("--all", action="store_true",
+                 help="List every result, not only the changed ones")
+  p.add_argument("--no-fail", action="store_true",
+                 help="Exit with 0 even if results regressed")
+  add_threshold_args(p)
+  p.set_defaults(func=cmd_compare)
+
+  args = parser.parse_args()
+  args.func(args)
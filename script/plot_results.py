@@ -9,29 +9,42 @@ import os
 import sys
 import argparse
 
+import perf_compare
+
 TAP_COUNT = 1024
 FRAME_SIZE = 256
 SAMPLE_RATE = 16000  # Sample/sec
 
+# Stages which filter a multichannel input, and the input they use
+MULTICHANNEL_INPUTS = {"part5I": "input_8ch.wav"}
 
-def run(args):
 
-  # Get the input waveform
-  input_signal = wavfile.read(os.path.join(
-      "xmath_walkthrough", "wav", "input.wav"))[1]
-  N = len(input_signal)
-  dex = np.arange(N)
+def read_q31(path):
+  # wav files may hold 16, 24 or 32-bit PCM or 32-bit float samples. scipy
+  # reads 24-bit samples left-justified in int32.
+  samples = wavfile.read(path)[1]
+  if samples.dtype == np.int16:
+    return samples.astype(np.int32) << 16
+  if samples.dtype == np.float32:
+    return np.clip(np.round(np.ldexp(samples.astype(float), 31)),
+                   -2**31, 2**31 - 1).astype(np.int32)
+  return samples
+
 
+def reference_output(input_signal, coef):
   # Convert to float using exponent -31
   float_signal = np.ldexp(input_signal, -31)
 
+  # Each channel (column) is filtered independently
+  ref_out = lfilter(coef, [1.0], float_signal, axis=0)
+  return np.round(np.ldexp(ref_out, 31)).astype(np.int32)
+
+
+def run(args):
+
   # Create filter coefficients
   coef: np.ndarray = np.ones(TAP_COUNT, dtype=float) / TAP_COUNT
 
-  # Compute reference output
-  ref_out = lfilter(coef, [1.0], float_signal)
-  ref_out_pcm = np.round(np.ldexp(ref_out, 31)).astype(np.int32)
-
   # Do each stage
   for stage in args.stages:
     spath = os.path.join("out", f"output-{stage}.wav")
@@ -39,7 +52,14 @@ def run(args):
       print(f"Couldn't find {spath}. Skipping.")
       continue
 
-    stage_res = wavfile.read(spath)[1]
+    # Get the input waveform and compute the reference output
+    input_name = MULTICHANNEL_INPUTS.get(stage, "input.wav")
+    input_signal = read_q31(os.path.join(
+        "xmath_walkthrough", "wav", input_name))
+    ref_out_pcm = reference_output(input_signal, coef)
+    dex = np.arange(len(input_signal))
+
+    stage_res = read_q31(spath)
 
     fig, (ax1, ax2) = plt.subplots(2, 1)
 
@@ -61,10 +81,113 @@ def run(args):
     plt.show()
 
 
+def result_stage(key):
+  # "part2C" or "benchmark/part2C/1024x256"
+  parts = key.split("/")
+  return parts[1] if parts[0] == "benchmark" else parts[0]
+
+
+def run_trend(args):
+  # Plot each result's mean frame time over the stored runs, shaded up to its
+  # p99, one plot per platform
+  names = perf_compare.list_runs(args.store)
+  if not names:
+    print(f"No runs stored in {args.store}.")
+    return
+  runs = [perf_compare.load_run(args.store, n) for n in names]
+  platforms = sorted(set(p for r in runs for p in r["results"]))
+
+  for platform in platforms:
+    keys = sorted(set(k for r in runs for k in r["results"].get(platform, {})
+                      if result_stage(k) in args.stages))
+    if not keys:
+      continue
+
+    fig, ax = plt.subplots()
+    for key in keys:
+      dex, ave, p99 = [], [], []
+      for k, run in enumerate(runs):
+        res = run["results"].get(platform, {}).get(key)
+        if res is None:
+          continue
+        dex.append(k)
+        ave.append(res["frame_time"] / 1000)
+        p99.append(res["p99"] / 1000)
+      line = ax.plot(dex, ave, marker="o", label=key)[0]
+      ax.fill_between(dex, ave, p99, color=line.get_color(), alpha=0.15)
+
+    ax.set_title(f"Frame Time Trend ({platform})")
+    ax.set_xticks(range(len(names)))
+    ax.set_xticklabels(names, rotation=45, ha="right")
+    ax.set_ylabel("Mean Frame Time, to p99 (us)")
+    ax.set_yscale("log")
+    ax.grid()
+    ax.legend(fontsize="small")
+    plt.tight_layout()
+  plt.show()
+
+
+def run_diff(args):
+  # Plot the change in each result's mean frame time between two sets of results,
+  # with the threshold perf_compare.py puts down to noise. By default, the
+  # baseline is compared with the results in out/.
+  names = args.diff
+  if len(names) == 2:
+    base = perf_compare.load_run(args.store, names[0])["results"]
+  else:
+    stored = perf_compare.load_baseline(args.store)
+    if stored is None:
+      print(f"No baseline in {args.store}.")
+      return
+    base = stored["results"]
+  new = (perf_compare.load_run(args.store, names[-1])["results"] if names
+         else perf_compare.load_out("out"))
+
+  rows = [r for r in perf_compare.compare(base, new, args)
+          if r[2] is not None and r[3] is not None
+          and result_stage(r[1]) in args.stages]
+  if not rows:
+    print("No results to compare.")
+    return
+
+  labels = [f"{platform} {key}" for platform, key, *_ in rows]
+  change = [100 * (n["frame_time"] - b["frame_time"]) / b["frame_time"]
+            for _, _, b, n, _, _ in rows]
+  noise = [100 * t / b["frame_time"] for _, _, b, _, t, _ in rows]
+  colors = {"SLOWER": "r", "TAIL": "orange", "faster": "g", "ok": "gray"}
+
+  dex = np.arange(len(rows))
+  fig, ax = plt.subplots(figsize=(8, 2 + 0.25 * len(rows)))
+  ax.barh(dex, change, color=[colors[r[5]] for r in rows])
+  ax.errorbar(np.zeros(len(rows)), dex, xerr=noise, fmt="none", ecolor="k",
+              capsize=3, label="noise")
+  ax.set_yticks(dex)
+  ax.set_yticklabels(labels, fontsize="small")
+  ax.invert_yaxis()
+  title = " vs ".join(names) if len(names) == 2 else "baseline vs " + (
+      names[0] if names else "out/")
+  ax.set_title(f"Mean Frame Time Change ({title})")
+  ax.set_xlabel("Change (%)")
+  ax.grid(axis="x")
+  ax.legend()
+  plt.tight_layout()
+  plt.show()
+
+
 if __name__ == '__main__':
   parser = argparse.ArgumentParser()
   parser.add_argument("--stages", default='all', type=str,
                       help="The stage name (e.g. 'stage1')")
+  parser.add_argument("--trend", action="store_true",
+                      help="Plot the frame times of the runs stored by "
+                           "perf_compare.py, instead of the output")
+  parser.add_argument("--diff", nargs="*", metavar="RUN",
+                      help="Plot the change in frame times between two stored "
+                           "runs, from the baseline to a stored run, or from "
+                           "the baseline to the results in out/")
+  parser.add_argument("--store", default="perf",
+                      help="Directory of perf_compare.py's results store")
+  perf_compare.add_threshold_args(parser)
   args = parser.parse_args()
 
   if args.stages == 'all':
@@ -72,9 +195,16 @@ if __name__ == '__main__':
                    "part2A", "part2B", "part2C",
                    "part3A", "part3B", "part3C",
                    "part4A", "part4B", "part4C",
+                   "part5A", "part5B", "part5C", "part5D", "part5E",
+                   "part5F", "part5G", "part5H", "part5H_user", "part5I",
                    ]
   else:
     args.stages = [args.stages]
 
-  print(f"Plotting {', '.join(args.stages)}..")
-  run(args)
+  if args.trend:
+    run_trend(args)
+  elif args.diff is not None:
+    run_diff(args)
+  else:
+    print(f"Plotting {', '.join(args.stages)}..")
+    run(args)
@@ -0,0 +1,137 @@
+# Copyright 2022-2023 XMOS LIMITED.
+# This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+# Converts a binary trace file written by a stage built with -DTRACE=ON (see
+# src/common/timing/trace.h) to the Chrome trace event format, which can be
+# viewed with chrome://tracing or https://ui.perfetto.dev.
+
+import struct
+import json
+import os
+import argparse
+
+TRACE_MAGIC = b"XTRC"
+TRACE_VERSION = 1
+TRACE_END = 0x80000000
+
+
+class TraceReader:
+
+  def __init__(self, data):
+    self.data = data
+    self.pos = 0
+
+  def bytes(self, count):
+    if self.pos + count > len(self.data):
+      raise ValueError("Trace file is truncated")
+    b = self.data[self.pos:self.pos + count]
+    self.pos += count
+    return b
+
+  def word(self):
+    return struct.unpack("<I", self.bytes(4))[0]
+
+
+def read_trace(path):
+  with open(path, "rb") as f:
+    rd = TraceReader(f.read())
+
+  if rd.bytes(4) != TRACE_MAGIC:
+    raise ValueError(f"{path} is not a trace file")
+  version = rd.word()
+  if version != TRACE_VERSION:
+    raise ValueError(f"Unsupported trace file version {version}")
+  clock_hz = rd.word()
+
+  names = [rd.bytes(rd.word()).decode() for _ in range(rd.word())]
+
+  rings = []
+  for _ in range(rd.word()):
+    thread, total, count = rd.word(), rd.word(), rd.word()
+    records = struct.unpack(f"<{2*count}I", rd.bytes(8 * count))
+    rings.append({"thread": thread, "total": total,
+                  "records": list(zip(records[0::2], records[1::2]))})
+
+  return clock_hz, names, rings
+
+
+def signed32(x):
+  x &= 0xFFFFFFFF
+  return x - (1 << 32) if x & 0x80000000 else x
+
+
+def unwrap(rings):
+  # Timestamps are 32-bit, so they wrap every ~43 s at 100 MHz. Each ring's
+  # records are in order, so they can be unwrapped one after another, and all
+  # rings are placed relative to the first record of the first one.
+  ref = next((r["records"][0][0] for r in rings if r["records"]), 0)
+  for ring in rings:
+    prev_raw = None
+    t = 0
+    times = []
+    for raw, _ in ring["records"]:
+      t = signed32(raw - ref) if prev_raw is None else \
+          t + ((raw - prev_raw) & 0xFFFFFFFF)
+      prev_raw = raw
+      times.append(t)
+    ring["times"] = times
+
+  start = min((r["times"][0] for r in rings if r["times"]), default=0)
+  for ring in rings:
+    ring["times"] = [t - start for t in ring["times"]]
+
+
+def to_chrome(clock_hz, names, rings, process_name):
+  unwrap(rings)
+  us_per_tick = 1.0e6 / clock_hz
+
+  events = [{"name": "process_name", "ph": "M", "pid": 1, "tid": 0,
+             "args": {"name": process_name}}]
+
+  for ring in rings:
+    tid = ring["thread"]
+    events.append({"name": "thread_name", "ph": "M", "pid": 1, "tid": tid,
+                   "args": {"name": f"thread {tid}"}})
+
+    # The beginning of the oldest events may have been overwritten, so an end
+    # without a beginning is dropped.
+    depth = {}
+    for (_, event), t in zip(ring["records"], ring["times"]):
+      kind = event & ~TRACE_END
+      name = names[kind] if kind < len(names) else f"event_{kind}"
+      if event & TRACE_END:
+        if depth.get(kind, 0) == 0:
+          continue
+        depth[kind] -= 1
+        ph = "E"
+      else:
+        depth[kind] = depth.get(kind, 0) + 1
+        ph = "B"
+      events.append({"name": name, "ph": ph, "pid": 1, "tid": tid,
+                     "ts": t * us_per_tick})
+
+  return {"traceEvents": events, "displayTimeUnit": "ns"}
+
+
+def run(args):
+  clock_hz, names, rings = read_trace(args.trace)
+
+  for ring in rings:
+    lost = ring["total"] - len(ring["records"])
+    print(f"thread {ring['thread']}: {len(ring['records'])} records"
+          + (f" ({lost} older records were overwritten)" if lost else ""))
+
+  out_path = args.output or (os.path.splitext(args.trace)[0] + "_trace.json")
+  process_name = os.path.splitext(os.path.basename(args.trace))[0]
+  with open(out_path, "w") as f:
+    json.dump(to_chrome(clock_hz, names, rings, process_name), f)
+  print(f"Wrote {out_path}")
+
+
+if __name__ == "__main__":
+  parser = argparse.ArgumentParser(
+      description="Convert a stage's binary trace file to Chrome trace JSON")
+  parser.add_argument("trace", help="Trace file, e.g. out/part4A.trace")
+  parser.add_argument("-o", "--output",
+                      help="Output file (default: <trace>_trace.json)")
+  run(parser.parse_args())
@@ -3,6 +3,9 @@
 #include <stdint.h>
 
 #include "xmath/xmath.h"
+#if HOST_BUILD
+# include "host_kernels.h"
+#endif
 
 
 void filter_wrapped_init(
@@ -22,4 +25,7 @@ void filter_float(
     float frame_in_out[]);
 
 
-void filter_float_deinit();
\ No newline at end of file
+void filter_float_deinit();
+
+
+void mc_crossover_benchmark();
\ No newline at end of file
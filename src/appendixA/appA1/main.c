@@ -205,5 +205,9 @@ int main()
   printf("|-------------------------------|\n");
 
 
+  // Finally, the multichannel layout crossover
+  printf("\n\n");
+  mc_crossover_benchmark();
+
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,136 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <xcore/hwtimer.h>
+
+#include "appA1.h"
+#include "mc_fir.h"
+
+// Frame size used for every run. Short filters are typically used with short
+// frames.
+#define XO_FRAME_SIZE   (64)
+
+// Number of frames timed for each configuration, after one untimed frame.
+#define XO_FRAMES       (8)
+
+static const unsigned xo_channels[] = {4, 8, 16};
+static const unsigned xo_taps[] = {16, 32, 64, 96, 128, 192, 256, 512};
+
+#define XO_CHANNEL_CASES  (sizeof(xo_channels) / sizeof(unsigned))
+#define XO_TAP_CASES      (sizeof(xo_taps) / sizeof(unsigned))
+
+static int32_t frame_in[MC_FIR_MAX_CHANNELS * XO_FRAME_SIZE];
+static int32_t frame_out[MC_FIR_MAX_CHANNELS * XO_FRAME_SIZE];
+static exponent_t frame_in_exp[MC_FIR_MAX_CHANNELS];
+static exponent_t frame_out_exp[MC_FIR_MAX_CHANNELS];
+
+
+// Average time per channel-sample, in ns, to filter XO_FRAMES frames of every
+// channel on a single thread.
+static
+float time_layout(
+    const unsigned channel_count,
+    const unsigned tap_count,
+    const mc_fir_layout_e layout)
+{
+  int32_t* coef = (int32_t*) malloc(tap_count * sizeof(int32_t));
+  int32_t* history_buff = (int32_t*) malloc(
+      MC_FIR_HISTORY_BUFFER_LENGTH(channel_count, tap_count, XO_FRAME_SIZE)
+        * sizeof(int32_t));
+  assert(coef && history_buff);
+
+  for(int k = 0; k < tap_count; k++)
+    coef[k] = rand() - (RAND_MAX >> 1);
+
+  mc_fir_t filter;
+  mc_fir_init(&filter, history_buff, coef, -40, tap_count, XO_FRAME_SIZE, 
+              channel_count, layout);
+
+  uint64_t total_ticks = 0UL;
+
+  for(int frame = 0; frame <= XO_FRAMES; frame++){
+    for(int k = 0; k < channel_count * XO_FRAME_SIZE; k++)
+      frame_in[k] = rand() - (RAND_MAX >> 1);
+    for(int ch = 0; ch < channel_count; ch++)
+      frame_in_exp[ch] = -31;
+
+    const uint32_t t0 = get_reference_time();
+    for(int u = 0; u < filter.unit_count; u++)
+      mc_fir_process_unit(&filter, u, frame_out, frame_out_exp, 
+                          frame_in, frame_in_exp);
+    const uint32_t ticks = get_reference_time() - t0;
+
+    // The first frame also pays for any rescaling of the (silent) histories.
+    if(frame) total_ticks += ticks;
+  }
+
+  mc_fir_deinit(&filter);
+  free(history_buff);
+  free(coef);
+
+  // Reference clock is 100 MHz
+  return (10.0f * total_ticks) / (XO_FRAMES * XO_FRAME_SIZE * channel_count);
+}
+
+
+/**
+ * Compare the tap-parallel and channel-parallel layouts of the multichannel
+ * filter from Part 5I, and find the tap count at which the tap-parallel layout
+ * becomes faster for each channel count. MC_FIR_CROSSOVER_TAPS should be set
+ * from the crossover found with 8 channels.
+ */
+void mc_crossover_benchmark()
+{
+  float ave_ns[XO_CHANNEL_CASES][XO_TAP_CASES][2];
+
+  for(int c = 0; c < XO_CHANNEL_CASES; c++){
+    for(int t = 0; t < XO_TAP_CASES; t++){
+      printf("channels: %u  tap_count: %u\n", xo_channels[c], xo_taps[t]);
+      ave_ns[c][t][0] = time_layout(xo_channels[c], xo_taps[t], 
+                                    MC_FIR_LAYOUT_TAPS);
+      ave_ns[c][t][1] = time_layout(xo_channels[c], xo_taps[t], 
+                                    MC_FIR_LAYOUT_CHANNELS);
+    }
+  }
+
+  printf("\n\n");
+  printf("|---------------------------------------------------------------|\n");
+  printf("|          Multichannel Channel-Sample Time (ns)                |\n");
+  printf("|----------|--------|-------------|-------------|--------|------|\n");
+  printf("| Channels |  Taps  | Tap-Par.    | Chan-Par.   | Faster | Auto |\n");
+  printf("|----------|--------|-------------|-------------|--------|------|\n");
+  for(int c = 0; c < XO_CHANNEL_CASES; c++){
+    for(int t = 0; t < XO_TAP_CASES; t++){
+      const unsigned faster = (ave_ns[c][t][1] < ave_ns[c][t][0]);
+      const mc_fir_layout_e auto_layout = 
+          mc_fir_choose_layout(xo_channels[c], xo_taps[t]);
+
+      printf("|   % 4u   ", xo_channels[c]);
+      printf("| % 6u ", xo_taps[t]);
+      printf("|  % 9.02f  ", ave_ns[c][t][0]);
+      printf("|  % 9.02f  ", ave_ns[c][t][1]);
+      printf("|  %s  ", faster? "Chan" : "Taps");
+      printf("| %s%s |", (auto_layout == MC_FIR_LAYOUT_CHANNELS)? "Chan" : "Taps",
+             ((auto_layout == MC_FIR_LAYOUT_CHANNELS) == faster)? "" : "!");
+      printf("\n");
+    }
+  }
+  printf("|---------------------------------------------------------------|\n");
+  printf("('!' marks configurations where the automatic choice is slower.)\n");
+
+  printf("\n");
+  for(int c = 0; c < XO_CHANNEL_CASES; c++){
+    unsigned crossover = 0;
+    for(int t = 0; t < XO_TAP_CASES && !crossover; t++)
+      if(ave_ns[c][t][0] <= ave_ns[c][t][1]) crossover = xo_taps[t];
+
+    if(crossover)
+      printf("%u channels: tap-parallel is faster from %u taps.\n", 
+             xo_channels[c], crossover);
+    else
+      printf("%u channels: channel-parallel is faster at every tap count.\n", 
+             xo_channels[c]);
+  }
+}
@@ -140,6 +140,10 @@ void flt_fft_forward_float(
       vC[2] = W[2];
       vC[3] = W[3];
 
+#if HOST_BUILD
+      // Same butterflies, using the host CPU's SIMD instructions
+      host_kernels.fft_butterflies(&x[s], b, a, vC, 0);
+#else
       for(int j = 0; j < a; j++){
 
         for(int i = 0; i < 4; i++){
@@ -154,6 +158,7 @@ void flt_fft_forward_float(
 
         s += 2*b;
       }
+#endif
       
       W = &W[4];
     }
@@ -198,6 +203,10 @@ void flt_fft_inverse_float(
       vC[2] = W[2];
       vC[3] = W[3];
 
+#if HOST_BUILD
+      // Same butterflies, using the host CPU's SIMD instructions
+      host_kernels.fft_butterflies(&x[s], b, a, vC, 1);
+#else
       for(int j = 0; j < a; j++){
 
         for(int i = 0; i < 4; i++){
@@ -212,6 +221,7 @@ void flt_fft_inverse_float(
 
         s += 2*b;
       }
+#endif
       
       W = &W[4];
     }
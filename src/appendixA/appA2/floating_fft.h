@@ -6,6 +6,9 @@
 #include <complex.h>
 
 #include "xmath/xmath.h"
+#if HOST_BUILD
+# include "host_kernels.h"
+#endif
 
 EXTERN_C
 void flt_fft_forward_float(
@@ -0,0 +1,73 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+#include <stdint.h>
+#include <setjmp.h>
+
+#include <xcore/chanend.h>
+
+// Benchmark of every stage's filter over a grid of tap counts and frame sizes.
+//
+// Each stage is built once for every combination (an "engine"), with TAP_COUNT
+// and FRAME_SIZE set accordingly, and with its global symbols renamed so that
+// they don't collide (see CMakeLists.txt). Every engine is run through its
+// unmodified filter_task(). Instead of frame_transport.c, the benchmark links
+// bench_transport.c, whose frame_receive() makes up each input frame and, once
+// the engine has processed enough frames, jumps back out of filter_task().
+
+// Sample rate used to compute each engine's deadline utilization
+#ifndef BENCH_SAMPLE_RATE
+# define BENCH_SAMPLE_RATE    (16000)
+#endif
+
+// Frames processed by each engine before timing begins
+#ifndef BENCH_WARMUP_FRAMES
+# define BENCH_WARMUP_FRAMES  (8)
+#endif
+
+// Frames timed for each engine
+#ifndef BENCH_FRAMES
+# define BENCH_FRAMES         (64)
+#endif
+
+// The largest tap count in the grid, which sizes the coefficient buffers
+#ifndef BENCH_MAX_TAPS
+# define BENCH_MAX_TAPS       (1024)
+#endif
+
+// Formats of filter coefficients. Each stage's filter_coef[] is one of the
+// bench_coef_<format>[] buffers, which are filled in before each engine runs.
+typedef enum {
+  BENCH_COEF_none = 0,    // The engine has its own coefficients
+  BENCH_COEF_float,
+  BENCH_COEF_q4_28,
+  BENCH_COEF_q2_30,
+} bench_coef_e;
+
+extern float bench_coef_float[BENCH_MAX_TAPS];
+extern int32_t bench_coef_q4_28[BENCH_MAX_TAPS];
+extern int32_t bench_coef_q2_30[BENCH_MAX_TAPS];
+
+/**
+ * One stage built with one tap count and frame size.
+ */
+typedef struct {
+  const char* stage;
+  unsigned tap_count;
+  unsigned frame_size;
+  bench_coef_e coef;
+  void (*filter_task)(chanend_t);
+} bench_engine_t;
+
+/**
+ * Prepare bench_transport.c for an engine with the given frame size, which is
+ * to process `frame_count` frames. After that many frames, its next call to
+ * frame_receive() does a longjmp() to `bench_done`.
+ */
+void bench_transport_start(
+    const unsigned frame_size,
+    const unsigned frame_count);
+
+extern jmp_buf bench_done;
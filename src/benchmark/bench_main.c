@@ -0,0 +1,212 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+
+#if !HOST_BUILD
+# include <xscope.h>
+#endif
+
+#include "common.h"
+#include "fileio.h"
+#include "bench.h"
+
+// Declare each engine's filter_task(), and then list them. bench_engines.inc is
+// generated by CMakeLists.txt, with one BENCH_ENGINE() per engine.
+#define BENCH_ENGINE(STAGE, TAPS, FRAME, COEF)                              \
+  void bench_##STAGE##_##TAPS##_##FRAME##_filter_task(chanend_t c_audio);
+#include "bench_engines.inc"
+#undef BENCH_ENGINE
+
+#define BENCH_ENGINE(STAGE, TAPS, FRAME, COEF)                              \
+  { #STAGE, TAPS, FRAME, BENCH_COEF_##COEF,                                 \
+    bench_##STAGE##_##TAPS##_##FRAME##_filter_task },
+static const bench_engine_t engines[] = {
+#include "bench_engines.inc"
+};
+#undef BENCH_ENGINE
+
+#define ENGINE_COUNT  (sizeof(engines) / sizeof(bench_engine_t))
+
+float bench_coef_float[BENCH_MAX_TAPS];
+int32_t bench_coef_q4_28[BENCH_MAX_TAPS];
+int32_t bench_coef_q2_30[BENCH_MAX_TAPS];
+
+/**
+ * An engine's results. Times are in nanoseconds.
+ */
+typedef struct {
+  // Average, median, 99th percentile and longest times to process a frame
+  float frame_time;
+  float frame_p50;
+  float frame_p99;
+  float frame_max;
+  // Average time per output sample, and per tap of each output sample
+  float sample_time;
+  float tap_time;
+  // Output samples per second
+  float throughput;
+  // Frames which took longer than they would take to arrive at
+  // BENCH_SAMPLE_RATE, and the fraction of that time the average frame took
+  unsigned misses;
+  float utilization;
+} bench_result_t;
+
+static bench_result_t results[ENGINE_COUNT];
+
+
+// Fill in an engine's coefficients: a simple averaging filter, like the one
+// used by the stages themselves.
+static
+void load_coef(
+    const bench_engine_t* engine)
+{
+  const unsigned taps = engine->tap_count;
+  for(int k = 0; k < taps; k++){
+    switch(engine->coef){
+      case BENCH_COEF_float: bench_coef_float[k] = 1.0f / taps; break;
+      case BENCH_COEF_q4_28: bench_coef_q4_28[k] = (1 << 28) / taps; break;
+      case BENCH_COEF_q2_30: bench_coef_q2_30[k] = (1 << 30) / taps; break;
+      default: break;
+    }
+  }
+}
+
+
+static
+void run_engine(
+    const bench_engine_t* engine,
+    bench_result_t* res)
+{
+  load_coef(engine);
+
+  timer_deadline_config(BENCH_SAMPLE_RATE, engine->frame_size);
+  timer_reset(BENCH_WARMUP_FRAMES);
+  bench_transport_start(engine->frame_size,
+                        BENCH_WARMUP_FRAMES + BENCH_FRAMES);
+
+  // filter_task() never returns. It is left by a longjmp() once it has
+  // processed every frame.
+  if(!setjmp(bench_done))
+    engine->filter_task(0);
+
+  const timing_dist_t* dist = timer_dist(TIMING_FRAME);
+  const timing_deadline_t* deadline = timer_deadline();
+
+  res->frame_time = timer_avg_ns(TIMING_FRAME);
+  res->frame_p50 = timing_dist_percentile_ns(dist, 0.5f);
+  res->frame_p99 = timing_dist_percentile_ns(dist, 0.99f);
+  res->frame_max = 10.0f * dist->max; // Reference clock is 100 MHz
+  res->sample_time = res->frame_time / engine->frame_size;
+  res->tap_time = res->sample_time / engine->tap_count;
+  res->throughput = res->sample_time? 1.0e9f / res->sample_time : 0.0f;
+  res->misses = deadline->misses;
+  res->utilization = res->frame_time / (10.0f * deadline->budget);
+}
+
+
+// Write the results as json, with one member for each engine
+static
+int write_json(
+    const char* file_name)
+{
+  file_t file;
+  if(file_open(&file, file_name, "wb")) return -1;
+
+  char buff[400];
+  unsigned c = sprintf(buff,
+      "{\n\"platform\": \"%s\",\n\"sample_rate\": %u,\n"
+      "\"warmup_frames\": %u,\n\"frames\": %u,\n\"results\": [",
+      HOST_BUILD? "host" : "xcore", BENCH_SAMPLE_RATE,
+      BENCH_WARMUP_FRAMES, BENCH_FRAMES);
+  file_write(&file, buff, c);
+
+  for(int k = 0; k < ENGINE_COUNT; k++){
+    const bench_engine_t* e = &engines[k];
+    const bench_result_t* r = &results[k];
+    c = sprintf(buff,
+        "%s\n{\"stage\": \"%s\", \"tap_count\": %u, \"frame_size\": %u, "
+        "\"frame_time\": %0.02f, \"frame_time_p50\": %0.02f, "
+        "\"frame_time_p99\": %0.02f, \"frame_time_max\": %0.02f, "
+        "\"sample_time\": %0.03f, \"tap_time\": %0.04f, "
+        "\"throughput\": %0.02f, \"deadline_misses\": %u, "
+        "\"utilization\": %0.05f}",
+        k? "," : "", e->stage, e->tap_count, e->frame_size,
+        r->frame_time, r->frame_p50, r->frame_p99, r->frame_max,
+        r->sample_time, r->tap_time, r->throughput, r->misses,
+        r->utilization);
+    file_write(&file, buff, c);
+  }
+
+  file_write(&file, (void*) "\n]\n}\n", 5);
+  file_close(&file);
+  return 0;
+}
+
+
+// Write the results as CSV, with one row for each engine
+static
+int write_csv(
+    const char* file_name)
+{
+  file_t file;
+  if(file_open(&file, file_name, "wb")) return -1;
+
+  char buff[250];
+  unsigned c = sprintf(buff,
+      "stage,tap_count,frame_size,frame_time,frame_time_p50,frame_time_p99,"
+      "frame_time_max,sample_time,tap_time,throughput,deadline_misses,"
+      "utilization\n");
+  file_write(&file, buff, c);
+
+  for(int k = 0; k < ENGINE_COUNT; k++){
+    const bench_engine_t* e = &engines[k];
+    const bench_result_t* r = &results[k];
+    c = sprintf(buff,
+        "%s,%u,%u,%0.02f,%0.02f,%0.02f,%0.02f,%0.03f,%0.04f,%0.02f,%u,%0.05f\n",
+        e->stage, e->tap_count, e->frame_size,
+        r->frame_time, r->frame_p50, r->frame_p99, r->frame_max,
+        r->sample_time, r->tap_time, r->throughput, r->misses,
+        r->utilization);
+    file_write(&file, buff, c);
+  }
+
+  file_close(&file);
+  return 0;
+}
+
+
+int main()
+{
+#if !HOST_BUILD
+  xscope_config_io(XSCOPE_IO_BASIC);
+#endif
+
+  printf("Now running benchmark: %u engines, %u frames each.\n\n",
+         (unsigned) ENGINE_COUNT, BENCH_FRAMES);
+
+  printf("| Stage  |  Taps | Frame | Frame Time (us) | Sample Time (ns) "
+         "| Tap Time (ns) | Utilization |\n");
+  printf("|--------|-------|-------|-----------------|------------------"
+         "|---------------|-------------|\n");
+
+  for(int k = 0; k < ENGINE_COUNT; k++){
+    const bench_engine_t* e = &engines[k];
+    bench_result_t* r = &results[k];
+    run_engine(e, r);
+
+    printf("| %-6s | %5u | %5u | %15.03f | %16.03f | %13.04f | %10.02f%% |\n",
+           e->stage, e->tap_count, e->frame_size, r->frame_time / 1000.0f,
+           r->sample_time, r->tap_time, 100.0f * r->utilization);
+  }
+
+  printf("\nWriting: %s\n", BENCH_JSON);
+  if(write_json(BENCH_JSON)) printf("Couldn't write %s\n", BENCH_JSON);
+  printf("Writing: %s\n", BENCH_CSV);
+  if(write_csv(BENCH_CSV)) printf("Couldn't write %s\n", BENCH_CSV);
+
+  return 0;
+}
@@ -12,11 +12,15 @@ int file_open(file_t *fp, const char* name, const char *mode) {
         if(fp->file == -1) {return -1;}
     }
     else if(!strcmp(mode, "wb")) {
-        fp->file = open(name, O_WRONLY|O_CREAT, 0644);
+        fp->file = open(name, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+        if(fp->file == -1) {return -1;}
+    }
+    else if(!strcmp(mode, "r+b")) {
+        fp->file = open(name, O_RDWR);
         if(fp->file == -1) {return -1;}
     }
     else {
-        assert((0) && "invalid file open mode specified. Only 'rb' and 'wb' modes supported");
+        assert((0) && "invalid file open mode specified. Only 'rb', 'wb' and 'r+b' modes supported");
     } 
 #endif
     return 0;
@@ -68,14 +72,31 @@ void file_read(file_t *fp, void *buf, size_t count) {
 #endif
 }
 
-void file_write(file_t *fp, void *buf, size_t count) {
+size_t file_write(file_t *fp, void *buf, size_t count) {
 #if TEST_WAV_XSCOPE
-    xscope_fwrite(&fp->xscope_file, (uint8_t*)buf, count);
+    return xscope_fwrite(&fp->xscope_file, (uint8_t*)buf, count);
 #else
-    write(fp->file, buf, count);
+    const int written = write(fp->file, buf, count);
+    return (written > 0)? written : 0;
 #endif
 }
 
+size_t file_write_all(file_t *fp, void *buf, size_t count, unsigned *retries) {
+    //a write may be cut short, so keep writing whatever is left. Only give up
+    //if several attempts in a row make no progress at all.
+    size_t done = 0;
+    unsigned failures = 0;
+    while(done < count && failures <= FILE_WRITE_RETRIES) {
+        const size_t written = file_write(fp, ((uint8_t*)buf) + done, count - done);
+        if(written < count - done) {
+            if(retries) (*retries)++;
+        }
+        failures = written? 0 : failures + 1;
+        done += written;
+    }
+    return done;
+}
+
 void file_close(file_t *fp) {
 #if !TEST_WAV_XSCOPE
     close(fp->file);
@@ -4,6 +4,7 @@
 #ifndef FILEIO_H
 #define FILEIO_H
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,6 +15,12 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+// Number of times in a row file_write_all() retries a write which makes no
+// progress before giving up.
+#ifndef FILE_WRITE_RETRIES
+#define FILE_WRITE_RETRIES (8)
+#endif
+
 typedef union {
     int file;
 #if TEST_WAV_XSCOPE
@@ -24,7 +31,8 @@ typedef union {
 
 int file_open(file_t *fp, const char* name, const char *mode);
 void file_read(file_t *fp, void *buf, size_t count);
-void file_write(file_t *fp, void *buf, size_t count);
+size_t file_write(file_t *fp, void *buf, size_t count);
+size_t file_write_all(file_t *fp, void *buf, size_t count, unsigned *retries);
 void file_seek(file_t *fp, long int offset, int origin);
 void file_close(file_t *fp);
 void shutdown_session(); //Needed for XSCOPE_ID_HOST_QUIT in xscope_close_all_files()
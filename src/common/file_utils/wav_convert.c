@@ -0,0 +1,103 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include <string.h>
+
+#include "wav_convert.h"
+
+
+wav_sample_format_e wav_sample_format(
+    const wav_header_t* header)
+{
+  if(header->audio_format == WAV_FORMAT_IEEE_FLOAT)
+    return WAV_SAMPLE_F32;
+
+  switch(header->bit_depth){
+    case 16: return WAV_SAMPLE_S16;
+    case 24: return WAV_SAMPLE_S24;
+    default: return WAV_SAMPLE_S32;
+  }
+}
+
+
+const char* wav_sample_format_name(
+    const wav_sample_format_e format)
+{
+  static const char* names[] = {"s16", "s24", "s32", "f32"};
+  return names[format];
+}
+
+
+unsigned wav_sample_bytes(
+    const wav_sample_format_e format)
+{
+  return (format == WAV_SAMPLE_S16)? 2 : (format == WAV_SAMPLE_S24)? 3 : 4;
+}
+
+
+void wav_samples_to_q31(
+    int32_t dst[],
+    const void* src,
+    const unsigned count,
+    const wav_sample_format_e format)
+{
+  switch(format){
+    case WAV_SAMPLE_S16:
+      // vect_s16_to_vect_s32() only shifts each sample left 8 bits.
+      vect_s16_to_vect_s32(dst, (const int16_t*) src, count);
+      vect_s32_shl(dst, dst, count, 8);
+      break;
+
+    case WAV_SAMPLE_S24: {
+      // There is no vectorized form of this, because 24-bit samples aren't
+      // word-aligned. The bytes just need to be moved to the top of each word.
+      const uint8_t* in = (const uint8_t*) src;
+      for(int k = 0; k < count; k++, in += 3)
+        dst[k] = (int32_t) (((uint32_t) in[0] << 8)
+                          | ((uint32_t) in[1] << 16)
+                          | ((uint32_t) in[2] << 24));
+      break;
+    }
+
+    case WAV_SAMPLE_S32:
+      memcpy(dst, src, count * sizeof(int32_t));
+      break;
+
+    case WAV_SAMPLE_F32:
+      vect_f32_to_vect_s32(dst, (const float*) src, count, -31);
+      break;
+  }
+}
+
+
+void wav_samples_from_q31(
+    void* dst,
+    const int32_t src[],
+    const unsigned count,
+    const wav_sample_format_e format)
+{
+  switch(format){
+    case WAV_SAMPLE_S16:
+      vect_s32_to_vect_s16((int16_t*) dst, src, count, 16);
+      break;
+
+    case WAV_SAMPLE_S24: {
+      uint8_t* out = (uint8_t*) dst;
+      for(int k = 0; k < count; k++, out += 3){
+        const uint32_t sample = (uint32_t) src[k];
+        out[0] = sample >> 8;
+        out[1] = sample >> 16;
+        out[2] = sample >> 24;
+      }
+      break;
+    }
+
+    case WAV_SAMPLE_S32:
+      memcpy(dst, src, count * sizeof(int32_t));
+      break;
+
+    case WAV_SAMPLE_F32:
+      vect_s32_to_vect_f32((float*) dst, src, count, -31);
+      break;
+  }
+}
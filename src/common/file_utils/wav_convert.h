@@ -0,0 +1,66 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "xmath/xmath.h"
+#include "wav_utils.h"
+
+// Largest number of bytes used by one sample in any supported format
+#define WAV_MAX_SAMPLE_BYTES    (4)
+
+/**
+ * Sample formats which can be converted to and from Q1.31.
+ */
+typedef enum {
+  WAV_SAMPLE_S16 = 0,   // 16-bit PCM
+  WAV_SAMPLE_S24 = 1,   // 24-bit packed PCM
+  WAV_SAMPLE_S32 = 2,   // 32-bit PCM
+  WAV_SAMPLE_F32 = 3,   // 32-bit IEEE float
+} wav_sample_format_e;
+
+
+/**
+ * Get the sample format of a canonical header (see wav_header_read()). The
+ * header must already have passed wav_header_check_details().
+ */
+wav_sample_format_e wav_sample_format(
+    const wav_header_t* header);
+
+/**
+ * Get a short name for a sample format, e.g. "s16".
+ */
+const char* wav_sample_format_name(
+    const wav_sample_format_e format);
+
+/**
+ * Get the number of bytes used by one sample in a sample format.
+ */
+unsigned wav_sample_bytes(
+    const wav_sample_format_e format);
+
+/**
+ * Convert `count` samples of the given format in `src` to Q1.31.
+ * 
+ * `src` and `dst[]` must both be word-aligned and must not overlap. Float
+ * samples outside [-1.0, 1.0) saturate.
+ */
+void wav_samples_to_q31(
+    int32_t dst[],
+    const void* src,
+    const unsigned count,
+    const wav_sample_format_e format);
+
+/**
+ * Convert `count` Q1.31 samples in `src[]` to the given format.
+ * 
+ * `dst` and `src[]` must both be word-aligned and must not overlap. 16-bit
+ * samples are rounded; 24-bit samples are truncated.
+ */
+void wav_samples_from_q31(
+    void* dst,
+    const int32_t src[],
+    const unsigned count,
+    const wav_sample_format_e format);
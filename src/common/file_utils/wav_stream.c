@@ -0,0 +1,295 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include <string.h>
+
+#include <xcore/hwtimer.h>
+
+#include "wav_stream.h"
+
+static inline
+unsigned min_u32(
+    const unsigned a,
+    const unsigned b)
+{
+  return (a < b)? a : b;
+}
+
+
+int wav_reader_open(
+    wav_reader_t* reader,
+    const char* file_name)
+{
+  const int ret = file_open(&reader->file, file_name, "rb");
+  if(ret != 0) return ret;
+
+  const int err = wav_header_read(&reader->file, &reader->header);
+  if(err != 0){
+    file_close(&reader->file);
+    return err;
+  }
+
+  reader->file_bytes_left = reader->header.data_bytes;
+  reader->cur = 0;
+  reader->pos = 0;
+  reader->len = 0;
+  reader->pending = 0;
+
+  channel_t c = chan_alloc();
+  reader->c_fetch = c.end_a;
+  reader->c_reader = c.end_b;
+  return 0;
+}
+
+
+// Hand the buffer not being read from to the background thread, to be filled
+// with the next chunk of the file.
+static
+void fetch(
+    wav_reader_t* reader)
+{
+  if(reader->pending || reader->file_bytes_left == 0) return;
+
+  const unsigned chunk = min_u32(WAV_STREAM_CHUNK_BYTES, 
+                                 reader->file_bytes_left);
+  chan_out_word(reader->c_fetch, reader->cur ^ 1);
+  chan_out_word(reader->c_fetch, chunk);
+  reader->file_bytes_left -= chunk;
+  reader->pending = 1;
+}
+
+
+// Wait for the background thread to fill the other buffer, and start reading
+// from it.
+static
+void take(
+    wav_reader_t* reader)
+{
+  reader->len = chan_in_word(reader->c_fetch);
+  reader->pending = 0;
+  reader->cur ^= 1;
+  reader->pos = 0;
+}
+
+
+unsigned wav_reader_read(
+    wav_reader_t* reader,
+    void* dst,
+    const unsigned bytes)
+{
+  uint8_t* out = (uint8_t*) dst;
+  unsigned done = 0;
+
+  while(done < bytes){
+    if(reader->pos == reader->len){
+      // Nothing is pending only on the first read (or after a skip).
+      fetch(reader);
+      if(!reader->pending) break;
+      take(reader);
+
+      // Read ahead the next chunk while this one is used up.
+      fetch(reader);
+    }
+
+    const uint8_t* buff = &reader->buff[reader->cur][0];
+    const unsigned n = min_u32(bytes - done, reader->len - reader->pos);
+    memcpy(&out[done], &buff[reader->pos], n);
+    reader->pos += n;
+    done += n;
+  }
+
+  return done;
+}
+
+
+void wav_reader_skip(
+    wav_reader_t* reader,
+    const unsigned bytes)
+{
+  unsigned left = bytes;
+
+  // Whatever is already buffered, or on its way, is used up first.
+  while(1){
+    const unsigned n = min_u32(left, reader->len - reader->pos);
+    reader->pos += n;
+    left -= n;
+    if(left == 0 || !reader->pending) break;
+    take(reader);
+  }
+
+  if(left == 0) return;
+
+  // Nothing is pending now, so the file can be moved on without disturbing the
+  // background thread.
+  const unsigned skip = min_u32(left, reader->file_bytes_left);
+  file_seek(&reader->file, skip, SEEK_CUR);
+  reader->file_bytes_left -= skip;
+}
+
+
+void wav_reader_finish(
+    wav_reader_t* reader)
+{
+  if(reader->pending)
+    chan_in_word(reader->c_fetch);
+  reader->pending = 0;
+
+  // A zero-length buffer tells the background thread to stop.
+  chan_out_word(reader->c_fetch, 0);
+  chan_out_word(reader->c_fetch, 0);
+}
+
+
+void wav_reader_close(
+    wav_reader_t* reader)
+{
+  file_close(&reader->file);
+  chan_free((channel_t){reader->c_fetch, reader->c_reader});
+}
+
+
+void wav_reader_thread(
+    wav_reader_t* reader)
+{
+  while(1){
+    const unsigned index = chan_in_word(reader->c_reader);
+    const unsigned len = chan_in_word(reader->c_reader);
+    if(len == 0) break;
+
+    file_read(&reader->file, (void*) &reader->buff[index][0], len);
+
+    chan_out_word(reader->c_reader, len);
+  }
+}
+
+
+int wav_writer_open(
+    wav_writer_t* writer,
+    const char* file_name,
+    const wav_header_t* format)
+{
+  const int ret = file_open(&writer->file, file_name, "wb");
+  if(ret != 0) return ret;
+
+  writer->header = *format;
+  writer->header.data_bytes = 0;
+  writer->header.wav_size = WAV_HEADER_BYTES - 8;
+  writer->data_bytes = 0;
+  writer->fill = 0;
+  writer->len = 0;
+  writer->pending = 0;
+  writer->bytes_written = 0;
+  writer->retries = 0;
+  writer->write_ticks = 0;
+
+  channel_t c = chan_alloc();
+  writer->c_flush = c.end_a;
+  writer->c_writer = c.end_b;
+
+  // The sizes are patched in by wav_writer_close().
+  file_write_all(&writer->file, (void*) &writer->header, WAV_HEADER_BYTES,
+                 &writer->retries);
+  return 0;
+}
+
+
+// Hand the buffer being filled to the background thread, and start filling the
+// other one.
+static
+void flush(
+    wav_writer_t* writer)
+{
+  if(!writer->len) return;
+
+  // The other buffer can't be refilled until the background thread is done
+  // with it.
+  if(writer->pending)
+    chan_in_word(writer->c_flush);
+
+  chan_out_word(writer->c_flush, writer->fill);
+  chan_out_word(writer->c_flush, writer->len);
+  writer->pending = 1;
+
+  writer->fill ^= 1;
+  writer->len = 0;
+}
+
+
+void wav_writer_write(
+    wav_writer_t* writer,
+    const void* src,
+    const unsigned bytes)
+{
+  const uint8_t* in = (const uint8_t*) src;
+  unsigned done = 0;
+
+  while(done < bytes){
+    uint8_t* buff = &writer->buff[writer->fill][0];
+    const unsigned n = min_u32(bytes - done, 
+                               WAV_WRITE_CHUNK_BYTES - writer->len);
+    memcpy(&buff[writer->len], &in[done], n);
+    writer->len += n;
+    done += n;
+
+    if(writer->len == WAV_WRITE_CHUNK_BYTES)
+      flush(writer);
+  }
+
+  writer->data_bytes += bytes;
+}
+
+
+void wav_writer_finish(
+    wav_writer_t* writer)
+{
+  flush(writer);
+
+  if(writer->pending)
+    chan_in_word(writer->c_flush);
+  writer->pending = 0;
+
+  // A zero-length buffer tells the background thread to stop.
+  chan_out_word(writer->c_flush, 0);
+  chan_out_word(writer->c_flush, 0);
+}
+
+
+int wav_writer_close(
+    wav_writer_t* writer)
+{
+  writer->header.data_bytes = writer->data_bytes;
+  writer->header.wav_size = writer->data_bytes + WAV_HEADER_BYTES - 8;
+
+  file_seek(&writer->file, 0, SEEK_SET);
+  const unsigned header_bytes = file_write_all(&writer->file, 
+      (void*) &writer->header, WAV_HEADER_BYTES, &writer->retries);
+
+  // Check the file actually ended up the size it should be.
+  const int file_bytes = get_file_size(&writer->file);
+  file_close(&writer->file);
+
+  chan_free((channel_t){writer->c_flush, writer->c_writer});
+
+  if(header_bytes != WAV_HEADER_BYTES) return -1;
+  if(writer->bytes_written != writer->data_bytes) return -1;
+  if(file_bytes != (int) (writer->data_bytes + WAV_HEADER_BYTES)) return -1;
+  return 0;
+}
+
+
+void wav_writer_thread(
+    wav_writer_t* writer)
+{
+  while(1){
+    const unsigned index = chan_in_word(writer->c_writer);
+    const unsigned len = chan_in_word(writer->c_writer);
+    if(len == 0) break;
+
+    const uint32_t t_start = get_reference_time();
+    writer->bytes_written += file_write_all(&writer->file, 
+        (void*) &writer->buff[index][0], len, &writer->retries);
+    writer->write_ticks += get_reference_time() - t_start;
+
+    chan_out_word(writer->c_writer, 0);
+  }
+}
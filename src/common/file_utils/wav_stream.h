@@ -0,0 +1,196 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <xcore/channel.h>
+#include <xcore/chanend.h>
+#include <xcore/parallel.h>
+
+#include "fileio.h"
+#include "wav_utils.h"
+
+// Size of the buffer through which a wav stream reads or writes its file. The
+// file is only ever accessed in chunks of this many bytes (except for the last
+// one), so a stream's memory use doesn't depend on the length of the file.
+#ifndef WAV_STREAM_CHUNK_BYTES
+# define WAV_STREAM_CHUNK_BYTES   (8192)
+#endif
+
+// Size of each of a wav writer's two buffers. Each write to the file is one
+// whole buffer, so larger buffers mean fewer, bulkier writes.
+#ifndef WAV_WRITE_CHUNK_BYTES
+# define WAV_WRITE_CHUNK_BYTES    (WAV_STREAM_CHUNK_BYTES)
+#endif
+
+
+/**
+ * Reads the sample data of a wav file sequentially, a chunk at a time.
+ * 
+ * Data is read from one of two buffers. While the caller uses one up, the next
+ * WAV_STREAM_CHUNK_BYTES of the data chunk are read into the other by a
+ * background thread (wav_reader_thread()), so the caller only waits for the
+ * file if it uses up a buffer faster than the next one can be read.
+ */
+typedef struct {
+  file_t file;
+  wav_header_t header;
+  // Bytes of the data chunk not yet handed to the background thread to read
+  unsigned file_bytes_left;
+  // Index of the buffer being read from, read position in it, and number of
+  // valid bytes in it
+  unsigned cur;
+  unsigned pos;
+  unsigned len;
+  // Whether the other buffer has been handed to the background thread to fill
+  // and not yet acknowledged
+  unsigned pending;
+  // Caller's end of the channel to the background thread
+  chanend_t c_fetch;
+  // Background thread's end of the channel
+  chanend_t c_reader;
+  uint8_t buff[2][WAV_STREAM_CHUNK_BYTES];
+} wav_reader_t;
+
+
+/**
+ * Writes the sample data of a wav file sequentially, a chunk at a time.
+ * 
+ * Data is collected in one of two buffers. When it fills, it is handed to a
+ * background thread (wav_writer_thread()) which writes it to the file while the
+ * caller carries on filling the other one, so the caller only waits for the
+ * file if it fills a buffer faster than the previous one can be written.
+ * 
+ * The header's RIFF and data chunk sizes are only known when the stream is
+ * closed, at which point they are patched in.
+ */
+typedef struct {
+  file_t file;
+  wav_header_t header;
+  // Total bytes of sample data written so far (including any still buffered)
+  unsigned data_bytes;
+  // Index of the buffer being filled, and number of bytes waiting in it
+  unsigned fill;
+  unsigned len;
+  // Whether the other buffer has been handed to the background thread and not
+  // yet acknowledged
+  unsigned pending;
+  // Caller's end of the channel to the background thread
+  chanend_t c_flush;
+  // Background thread's end of the channel
+  chanend_t c_writer;
+  // Written by the background thread: bytes actually written to the file
+  // (excluding the header), number of short writes retried, and reference
+  // clock ticks spent writing.
+  unsigned bytes_written;
+  unsigned retries;
+  uint64_t write_ticks;
+  uint8_t buff[2][WAV_WRITE_CHUNK_BYTES];
+} wav_writer_t;
+
+
+/**
+ * Open a wav file for reading, and read its header into `reader->header` (see
+ * wav_header_read()).
+ * 
+ * Returns 0 on success. The header's details are not checked here; see
+ * wav_header_check_details().
+ */
+int wav_reader_open(
+    wav_reader_t* reader,
+    const char* file_name);
+
+/**
+ * Read up to `bytes` bytes of sample data. Returns the number of bytes read,
+ * which is less than `bytes` only at the end of the data.
+ * 
+ * The reader's background thread must be running.
+ */
+unsigned wav_reader_read(
+    wav_reader_t* reader,
+    void* dst,
+    const unsigned bytes);
+
+/**
+ * Skip over the next `bytes` bytes of sample data (or the rest of it, if there
+ * are fewer), without reading them from the file.
+ */
+void wav_reader_skip(
+    wav_reader_t* reader,
+    const unsigned bytes);
+
+/**
+ * Wait for any read ahead to complete, and then stop the background thread.
+ * 
+ * Must be called by the thread which called wav_reader_read().
+ */
+void wav_reader_finish(
+    wav_reader_t* reader);
+
+/**
+ * Close the file. If the background thread was started, wav_reader_finish()
+ * must have been called first.
+ */
+void wav_reader_close(
+    wav_reader_t* reader);
+
+/**
+ * Thread entry point for a wav reader's background thread.
+ * 
+ * Returns once wav_reader_finish() has been called.
+ */
+DECLARE_JOB(wav_reader_thread, (wav_reader_t*));
+void wav_reader_thread(
+    wav_reader_t* reader);
+
+
+/**
+ * Create a wav file for writing, using the format of `format` (the sizes in it
+ * are ignored).
+ * 
+ * Returns 0 on success. A placeholder header is written immediately.
+ */
+int wav_writer_open(
+    wav_writer_t* writer,
+    const char* file_name,
+    const wav_header_t* format);
+
+/**
+ * Append `bytes` bytes of sample data.
+ * 
+ * The writer's background thread must be running.
+ */
+void wav_writer_write(
+    wav_writer_t* writer,
+    const void* src,
+    const unsigned bytes);
+
+/**
+ * Hand any buffered data to the background thread, wait for all of it to be
+ * written, and then stop the background thread.
+ * 
+ * Must be called by the thread which called wav_writer_write().
+ */
+void wav_writer_finish(
+    wav_writer_t* writer);
+
+/**
+ * Patch the header's sizes and close the file. wav_writer_finish() must have
+ * been called first.
+ * 
+ * Returns 0 if the whole of the sample data was written and the file is the
+ * expected size.
+ */
+int wav_writer_close(
+    wav_writer_t* writer);
+
+/**
+ * Thread entry point for a wav writer's background thread.
+ * 
+ * Returns once wav_writer_finish() has been called.
+ */
+DECLARE_JOB(wav_writer_thread, (wav_writer_t*));
+void wav_writer_thread(
+    wav_writer_t* writer);
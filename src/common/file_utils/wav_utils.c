@@ -21,6 +21,8 @@
 #define RIFF_SECTION_SIZE (12)
 #define FMT_SUBCHUNK_MIN_SIZE (24)
 #define EXTENDED_FMT_GUID_SIZE (16)
+// Offset of the sub-format GUID within a WAVE_FORMAT_EXTENSIBLE fmt chunk
+#define EXTENDED_FMT_GUID_OFFSET (24)
 // static const char wav_default_header[WAV_HEADER_BYTES] = {
 //         0x52, 0x49, 0x46, 0x46,
 //         0x00, 0x00, 0x00, 0x00,
@@ -51,7 +53,7 @@ unsigned wav_header_check_details(
     return 3;
   
   DEBUG_PRINT("%lu\n", header->fmt_chunk_size);
-  if( header->fmt_chunk_size != 0x00000010 )
+  if( header->fmt_chunk_size < 0x00000010 )
     return 4;
 
   DEBUG_PRINT("%u\n", header->num_channels);
@@ -71,8 +73,19 @@ unsigned wav_header_check_details(
   const uint32_t byte_depth = header->bit_depth >> 3;
 
   DEBUG_PRINT("0x%04X\n", (unsigned) header->audio_format);
-  if(header->audio_format != 0x0001)
-    return 8;
+  switch(header->audio_format){
+    case WAV_FORMAT_PCM:
+      if(header->bit_depth != 16 && header->bit_depth != 24 
+          && header->bit_depth != 32)
+        return 8;
+      break;
+    case WAV_FORMAT_IEEE_FLOAT:
+      if(header->bit_depth != 32)
+        return 8;
+      break;
+    default:
+      return 8;
+  }
 
 
   DEBUG_PRINT("%lu\n", header->byte_rate);
@@ -95,6 +108,70 @@ unsigned wav_header_check_details(
   return 0;
 }
 
+int wav_header_read(
+    file_t* file,
+    wav_header_t* header)
+{
+  // RIFF section
+  file_read(file, (void*) header, RIFF_SECTION_SIZE);
+  if( memcmp(header->riff_header, "RIFF", sizeof(header->riff_header)) != 0 )
+    return 1;
+  if( memcmp(header->wave_header, "WAVE", sizeof(header->wave_header)) != 0 ) 
+    return 2;
+
+  unsigned have_fmt = 0;
+  const unsigned riff_end = header->wav_size + 8;
+  unsigned pos = RIFF_SECTION_SIZE;
+
+  // Walk the chunks until the data chunk is found.
+  while(1){
+    if(pos + 8 > riff_end)
+      return 12;
+
+    struct {
+      uint8_t id[4];
+      uint32_t size;
+    } chunk;
+    file_read(file, (void*) &chunk, sizeof(chunk));
+    pos += sizeof(chunk) + ((chunk.size + 1) & ~1);
+
+    if( memcmp(chunk.id, "fmt ", sizeof(chunk.id)) == 0 ){
+      // The 16 bytes common to every fmt chunk, then (for
+      // WAVE_FORMAT_EXTENSIBLE) cbSize, valid bits, channel mask and the
+      // sub-format GUID, whose first two bytes are the actual format.
+      uint8_t fmt[EXTENDED_FMT_GUID_OFFSET + EXTENDED_FMT_GUID_SIZE] = {0};
+      if(chunk.size < 16 || chunk.size > sizeof(fmt))
+        return 4;
+      file_read(file, (void*) &fmt[0], chunk.size);
+      if(chunk.size & 1)
+        file_seek(file, 1, SEEK_CUR);
+
+      memcpy(header->fmt_header, "fmt ", sizeof(header->fmt_header));
+      header->fmt_chunk_size = 16;
+      memcpy(&header->audio_format, &fmt[0], 16);
+
+      if(header->audio_format == WAV_FORMAT_EXTENSIBLE){
+        if(chunk.size < EXTENDED_FMT_GUID_OFFSET + EXTENDED_FMT_GUID_SIZE)
+          return 4;
+        memcpy(&header->audio_format, &fmt[EXTENDED_FMT_GUID_OFFSET], 2);
+      }
+
+      have_fmt = 1;
+    } else if( memcmp(chunk.id, "data", sizeof(chunk.id)) == 0 ){
+      if(!have_fmt)
+        return 3;
+      memcpy(header->data_header, "data", sizeof(header->data_header));
+      header->data_bytes = chunk.size;
+      header->wav_size = chunk.size + WAV_HEADER_BYTES - 8;
+      return 0;
+    } else {
+      // Skip any other chunk. Chunks are padded to an even size.
+      DEBUG_PRINT("skipping %lu\n", chunk.size);
+      file_seek(file, (chunk.size + 1) & ~1, SEEK_CUR);
+    }
+  }
+}
+
 unsigned wav_header_get_file_size(
     const wav_header_t* header)
 {
@@ -9,6 +9,11 @@
 
 #define WAV_HEADER_BYTES 44
 
+// Values of wav_header_t::audio_format
+#define WAV_FORMAT_PCM          (0x0001)
+#define WAV_FORMAT_IEEE_FLOAT   (0x0003)
+#define WAV_FORMAT_EXTENSIBLE   (0xFFFE)
+
 typedef struct {
     // RIFF Header
     uint8_t riff_header[4];    // Should be "RIFF"
@@ -31,6 +36,30 @@ typedef struct {
 } wav_header_t;
 
 
+/**
+ * Read the header of a wav file, leaving `file` positioned at the first byte of
+ * sample data.
+ * 
+ * The file's fmt chunk may be any size (including the 40-byte
+ * WAVE_FORMAT_EXTENSIBLE form) and other chunks may come before the data
+ * chunk. Whatever the file's layout, `header` is filled in as the canonical
+ * 44-byte header describing the same audio: a 16-byte fmt chunk whose
+ * audio_format is WAV_FORMAT_PCM or WAV_FORMAT_IEEE_FLOAT (an extensible
+ * format's sub-format), followed immediately by the data chunk.
+ * 
+ * Returns 0 on success.
+ */
+int wav_header_read(
+    file_t* file,
+    wav_header_t* header);
+
+/**
+ * Check a canonical header (see wav_header_read()) describes audio that can be
+ * processed: 16, 24 or 32-bit PCM, or 32-bit float.
+ * 
+ * `exp_channels`, `exp_sample_rate` and `exp_bit_depth` are ignored if 0.
+ * Returns 0 if the header is good.
+ */
 unsigned wav_header_check_details(
     const wav_header_t* header,
     const uint16_t exp_channels,
@@ -0,0 +1,52 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include <string.h>
+#include <assert.h>
+
+#include "history.h"
+
+void history_init(
+    history_t* hist,
+    void* buff,
+    const unsigned capacity,
+    const unsigned frame_size,
+    const unsigned elem_size)
+{
+  assert( (capacity % frame_size) == 0 );
+
+  hist->data = buff;
+  hist->capacity = capacity;
+  hist->frame_size = frame_size;
+  hist->elem_size = elem_size;
+  hist->head = 0;
+
+  memset(buff, 0, HISTORY_BUFFER_LENGTH(capacity) * elem_size);
+}
+
+// Index of the slot which the next frame will occupy
+static inline
+unsigned next_head(
+    const history_t* hist)
+{
+  return (hist->head >= hist->frame_size)? (hist->head - hist->frame_size)
+                                         : (hist->capacity - hist->frame_size);
+}
+
+void* history_next_frame(
+    const history_t* hist)
+{
+  return ((uint8_t*) hist->data) + (next_head(hist) * hist->elem_size);
+}
+
+void history_commit_frame(
+    history_t* hist)
+{
+  hist->head = next_head(hist);
+
+  // Write the mirror copy of the new frame.
+  uint8_t* frame = ((uint8_t*) hist->data) + (hist->head * hist->elem_size);
+  memcpy(frame + (hist->capacity * hist->elem_size), 
+         frame, 
+         hist->frame_size * hist->elem_size);
+}
@@ -0,0 +1,90 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Sample history stored in a mirrored ring buffer.
+ * 
+ * The buffer holds `2*capacity` elements, and every sample is stored twice,
+ * `capacity` elements apart. As a result, the most recent `capacity` samples
+ * are always contiguous in memory, in reverse-chronological order (newest
+ * first), starting at history_window(). Unlike a linear history buffer, the
+ * older samples never need to be shifted to make room for a new frame.
+ * 
+ * New frames are written directly into the buffer at the location given by
+ * history_next_frame(), in reverse-chronological order, and then made visible
+ * by history_commit_frame(), which writes their second copy. `capacity` must be
+ * a multiple of the frame size, so that a frame never wraps around the end of
+ * the ring.
+ * 
+ * The element type is up to the caller; only its size is needed here.
+ */
+typedef struct {
+  // Buffer of 2*capacity elements
+  void* data;
+  // Number of samples held in the ring
+  unsigned capacity;
+  // Number of samples in each frame
+  unsigned frame_size;
+  // Size of each sample in bytes
+  unsigned elem_size;
+  // Index of the newest sample, in the range [0, capacity)
+  unsigned head;
+} history_t;
+
+// The number of elements needed for a history buffer of the given capacity.
+#define HISTORY_BUFFER_LENGTH(CAPACITY)   (2 * (CAPACITY))
+
+/**
+ * Initialize a history, clearing its buffer to zeros.
+ * 
+ * `buff` must have room for HISTORY_BUFFER_LENGTH(capacity) elements.
+ */
+void history_init(
+    history_t* hist,
+    void* buff,
+    const unsigned capacity,
+    const unsigned frame_size,
+    const unsigned elem_size);
+
+/**
+ * Get the location to which the next frame should be written.
+ * 
+ * The newest sample of the frame goes at index 0 and the oldest at index
+ * (frame_size-1). The frame is not part of the history until
+ * history_commit_frame() is called.
+ */
+void* history_next_frame(
+    const history_t* hist);
+
+/**
+ * Add the frame written to history_next_frame() to the history.
+ */
+void history_commit_frame(
+    history_t* hist);
+
+/**
+ * Get the newest sample in the history. It is followed by the (capacity-1)
+ * next newest samples.
+ */
+static inline
+void* history_window(
+    const history_t* hist)
+{
+  return ((uint8_t*) hist->data) + (hist->head * hist->elem_size);
+}
+
+/**
+ * Get the number of elements in the history's buffer (including both copies of
+ * each sample). Operations that modify samples in-place, such as rescaling,
+ * must be applied to all of them.
+ */
+static inline
+unsigned history_buffer_length(
+    const history_t* hist)
+{
+  return HISTORY_BUFFER_LENGTH(hist->capacity);
+}
@@ -16,11 +16,24 @@
 #endif
 
 #include "xmath/xmath.h"
+#if HOST_BUILD && !defined(__XC__)
+# include "host_kernels.h"
+#endif
 
 #include "timing.h"
+#include "trace.h"
+#ifndef __XC__
+# include "history.h"
+# include "frame_transport.h"
+#endif
 #include "misc_func.h"
 
 
-#define TAP_COUNT     (1024)
-#define FRAME_SIZE    (256)
+// The benchmark (see benchmark/) builds each stage with other values
+#ifndef TAP_COUNT
+# define TAP_COUNT    (1024)
+#endif
+#ifndef FRAME_SIZE
+# define FRAME_SIZE   (256)
+#endif
 #define HISTORY_SIZE  (TAP_COUNT + FRAME_SIZE)
\ No newline at end of file
@@ -57,6 +57,29 @@ int32_t float_s64_to_fixed(float_s64_t v, exponent_t output_exp)
   return sat32(ashr64(v.mant, shr)); 
 }
 
+// Add two float_s64_t values. The result has the larger of the two exponents,
+// and the other mantissa is shifted to match it. If the sum would overflow, both
+// mantissas are shifted right one more bit.
+static inline
+float_s64_t float_s64_add(float_s64_t x, float_s64_t y)
+{
+  if(x.exp < y.exp){
+    float_s64_t t = x;
+    x = y;
+    y = t;
+  }
+
+  const right_shift_t shr = x.exp - y.exp;
+  y.mant = (shr > 63)? ((y.mant < 0)? -1 : 0) : (y.mant >> shr);
+
+  float_s64_t res = {0, x.exp};
+  if(__builtin_add_overflow(x.mant, y.mant, &res.mant)){
+    res.mant = (x.mant >> 1) + (y.mant >> 1);
+    res.exp++;
+  }
+  return res;
+}
+
 // Convert float to 32-bit fixed-point value using the specified exponent
 static inline
 int32_t float_to_fixed(float x, exponent_t output_exp)
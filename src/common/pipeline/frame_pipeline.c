@@ -0,0 +1,81 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include "frame_pipeline.h"
+
+
+// Receives each frame into a free buffer and hands it to the compute thread.
+DECLARE_JOB(pipeline_rx, (frame_pipeline_t*, chanend_t));
+void pipeline_rx(
+    frame_pipeline_t* pipeline,
+    chanend_t c_audio_in)
+{
+  for(unsigned frame = 0; ; frame++){
+    // Every buffer starts out free. After that, wait for the transmitter to
+    // give one back.
+    const unsigned buff = (frame < PIPELINE_BUFFERS)? frame 
+                        : s_chan_in_word(pipeline->c_tx_rx.end_b);
+
+    frame_receive(c_audio_in, &pipeline->frames[buff][0], FRAME_SIZE, NULL);
+
+    chan_out_word(pipeline->c_rx_compute.end_a, buff);
+  }
+}
+
+
+// Processes each frame in-place and hands it to the transmitter.
+DECLARE_JOB(pipeline_compute, (frame_pipeline_t*));
+void pipeline_compute(
+    frame_pipeline_t* pipeline)
+{
+  while(1){
+    const unsigned buff = chan_in_word(pipeline->c_rx_compute.end_b);
+
+    timer_start(TIMING_FRAME);
+    timer_start(TIMING_PHASE_COMPUTE);
+    pipeline->process(pipeline->ctx, &pipeline->frames[buff][0]);
+    timer_stop(TIMING_PHASE_COMPUTE);
+    timer_stop(TIMING_FRAME);
+
+    chan_out_word(pipeline->c_compute_tx.end_a, buff);
+  }
+}
+
+
+// Sends each processed frame and gives its buffer back to the receiver.
+DECLARE_JOB(pipeline_tx, (frame_pipeline_t*, chanend_t));
+void pipeline_tx(
+    frame_pipeline_t* pipeline,
+    chanend_t c_audio_out)
+{
+  while(1){
+    const unsigned buff = chan_in_word(pipeline->c_compute_tx.end_b);
+
+    frame_send(c_audio_out, &pipeline->frames[buff][0], FRAME_SIZE, -31);
+
+    // At most 2 returned buffers are ever waiting for the receiver, which fits
+    // in the channel's buffer, so this does not block.
+    s_chan_out_word(pipeline->c_tx_rx.end_a, buff);
+  }
+}
+
+
+void frame_pipeline_run(
+    frame_pipeline_t* pipeline,
+    const chanend_t c_audio_in,
+    const chanend_t c_audio_out,
+    const frame_process_t process,
+    void* ctx)
+{
+  pipeline->process = process;
+  pipeline->ctx = ctx;
+  pipeline->c_rx_compute = chan_alloc();
+  pipeline->c_compute_tx = chan_alloc();
+  pipeline->c_tx_rx = s_chan_alloc();
+
+  PAR_JOBS(
+    PJOB(pipeline_rx, (pipeline, c_audio_in)),
+    PJOB(pipeline_compute, (pipeline)),
+    PJOB(pipeline_tx, (pipeline, c_audio_out))
+  );
+}
@@ -0,0 +1,62 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <xcore/channel.h>
+#include <xcore/channel_streaming.h>
+#include <xcore/chanend.h>
+#include <xcore/parallel.h>
+
+#include "common.h"
+
+// Number of frame buffers passed between the pipeline's threads. With 3, one
+// frame can be received, one filtered and one sent all at the same time.
+#define PIPELINE_BUFFERS    (3)
+
+/**
+ * Processes one frame of FRAME_SIZE samples in-place.
+ */
+typedef void (*frame_process_t)(void* ctx, int32_t frame[FRAME_SIZE]);
+
+/**
+ * Three-stage receive/process/transmit frame pipeline.
+ * 
+ * The receiver, compute and transmitter each run on their own thread, and pass
+ * ownership of frame buffers to each other through channels. While frame N is
+ * being processed, frame N+1 can be received and frame N-1 sent, so the time
+ * spent transferring frames no longer adds to the time spent processing them.
+ * 
+ * The pipeline adds (PIPELINE_BUFFERS-1) frames of latency.
+ */
+typedef struct {
+  int32_t frames[PIPELINE_BUFFERS][FRAME_SIZE];
+  frame_process_t process;
+  void* ctx;
+  // Receiver -> compute and compute -> transmitter
+  channel_t c_rx_compute;
+  channel_t c_compute_tx;
+  // Transmitter -> receiver. This one is a streaming channel, so that the
+  // transmitter never waits for the receiver. If all three hand-offs were
+  // synchronous, the threads could each end up waiting on the next.
+  streaming_channel_t c_tx_rx;
+} frame_pipeline_t;
+
+
+/**
+ * Start the pipeline's three threads, receiving input frames on `c_audio_in`,
+ * applying `process` to each, and sending output frames on `c_audio_out`.
+ * Never returns.
+ * 
+ * The compute thread measures `TIMING_FRAME` and `TIMING_PHASE_COMPUTE` around
+ * each call to `process`. Receiving and sending overlap with computation, so
+ * the other frame phases are not measured.
+ */
+void frame_pipeline_run(
+    frame_pipeline_t* pipeline,
+    const chanend_t c_audio_in,
+    const chanend_t c_audio_out,
+    const frame_process_t process,
+    void* ctx);
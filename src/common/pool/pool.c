@@ -0,0 +1,65 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include <assert.h>
+
+#include "pool.h"
+
+void pool_init(
+    pool_t* pool,
+    const unsigned worker_count)
+{
+  assert(worker_count <= POOL_MAX_WORKERS);
+
+  pool->worker_count = worker_count;
+  pool->job = 0;
+  pool->ctx = 0;
+  pool->count = 0;
+
+  for(int k = 0; k < worker_count; k++){
+    channel_t c = chan_alloc();
+    pool->c_job[k] = c.end_a;
+    pool->c_worker[k] = c.end_b;
+  }
+}
+
+
+void pool_run(
+    pool_t* pool,
+    const pool_job_t job,
+    void* ctx,
+    const unsigned threads)
+{
+  assert(threads >= 1 && threads <= pool->worker_count + 1);
+
+  pool->job = job;
+  pool->ctx = ctx;
+  pool->count = threads;
+
+  // Fork. Worker k does share (k+1) of the job.
+  for(int k = 0; k < threads-1; k++)
+    chan_out_word(pool->c_job[k], 0);
+
+  // The calling thread does share 0.
+  job(ctx, 0, threads);
+
+  // Join. The workers are idle (blocked on their channel) until the next job, so
+  // they take no issue slots away from the calling thread.
+  for(int k = 0; k < threads-1; k++)
+    chan_in_word(pool->c_job[k]);
+}
+
+
+void pool_worker(
+    pool_t* pool,
+    const unsigned id)
+{
+  // Workers beyond worker_count have no channel, and are never used.
+  if(id >= pool->worker_count) return;
+
+  while(1){
+    chan_in_word(pool->c_worker[id]);
+    pool->job(pool->ctx, id+1, pool->count);
+    chan_out_word(pool->c_worker[id], 0);
+  }
+}
@@ -0,0 +1,75 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <xcore/channel.h>
+#include <xcore/chanend.h>
+#include <xcore/parallel.h>
+
+// Maximum number of worker threads in a pool. With the calling thread, a job can
+// be split across up to (POOL_MAX_WORKERS+1) threads. Together with
+// timer_report_task() that uses all 8 of a tile's hardware threads.
+#define POOL_MAX_WORKERS    (6)
+#define POOL_MAX_THREADS    (POOL_MAX_WORKERS + 1)
+
+/**
+ * A job run by pool_run(). `index` is in the range [0, count), where `count` is
+ * the number of threads the job was split across.
+ */
+typedef void (*pool_job_t)(void* ctx, unsigned index, unsigned count);
+
+/**
+ * A pool of persistent worker threads.
+ * 
+ * The workers are started once, each running pool_worker(), and block on a
+ * channel until they are given work. pool_run() hands a job to some number of
+ * them, does its own share of the job on the calling thread, and then waits for
+ * all of them to finish. So each job costs one fork and one join, regardless of
+ * how much work it contains.
+ */
+typedef struct {
+  // Number of workers which have been started
+  unsigned worker_count;
+  // The job currently being run
+  pool_job_t job;
+  void* ctx;
+  unsigned count;
+  // Calling thread's end of each worker's channel
+  chanend_t c_job[POOL_MAX_WORKERS];
+  // Each worker's end of its channel
+  chanend_t c_worker[POOL_MAX_WORKERS];
+} pool_t;
+
+
+/**
+ * Initialize a pool with `worker_count` workers. The workers must then be
+ * started with pool_worker().
+ */
+void pool_init(
+    pool_t* pool,
+    const unsigned worker_count);
+
+/**
+ * Run `job` split across `threads` threads, one of which is the calling thread.
+ * 
+ * `threads` must be in the range [1, worker_count+1]. Returns once every
+ * thread has finished its share of the job.
+ */
+void pool_run(
+    pool_t* pool,
+    const pool_job_t job,
+    void* ctx,
+    const unsigned threads);
+
+/**
+ * Thread entry point for worker `id` of the pool. Never returns, unless `id` is
+ * not less than the pool's `worker_count`, in which case it returns
+ * immediately.
+ */
+DECLARE_JOB(pool_worker, (pool_t*, unsigned));
+void pool_worker(
+    pool_t* pool,
+    const unsigned id);
@@ -1,24 +1,239 @@
 // Copyright 2022-2023 XMOS LIMITED.
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+
 #include "timing.h"
+#include "trace.h"
 
-#define TYPE_COUNT    (2)
+#if HOST_BUILD
+# include <poll.h>
+#else
+# include <xcore/select.h>
+#endif
 
 static 
-uint32_t t_start[TYPE_COUNT] = {0};
+uint32_t t_start[TIMING_TYPE_COUNT] = {0};
 
 static 
-unsigned t_count[TYPE_COUNT] = {0};
+unsigned t_count[TIMING_TYPE_COUNT] = {0};
 
 static 
-uint64_t t_total[TYPE_COUNT] = {0};
+uint64_t t_total[TIMING_TYPE_COUNT] = {0};
+
+static
+timing_dist_t t_dist[TIMING_TYPE_COUNT];
+
+static
+timing_deadline_t deadline = {
+  TIMING_DEADLINE_SAMPLE_RATE, TIMING_DEADLINE_FRAME_SIZE,
+  (uint32_t) ((100000000ULL * TIMING_DEADLINE_FRAME_SIZE) 
+                / TIMING_DEADLINE_SAMPLE_RATE),
+  0, 0, INT32_MAX, 0, 0 };
+
+// Live metrics for the frames in the current interval (see timer_live_config())
+static struct {
+  // Length of each interval in ticks, or 0 if live metrics are off
+  uint32_t interval;
+  // Whether the first interval has started, and when the current one did
+  unsigned started;
+  uint32_t start;
+  // Number of frames, their total and longest durations, the least slack of
+  // any of them and how many missed their deadline
+  unsigned frames;
+  uint64_t total;
+  uint32_t max;
+  int32_t min_slack;
+  unsigned misses;
+} live = { 100000u * TIMING_LIVE_INTERVAL_MS, 0, 0, 0, 0, 0, INT32_MAX, 0 };
+
+// The metrics of the last complete interval, handed from the filter thread to
+// timer_report_task() to be printed. `seq` is odd while they are being written,
+// and goes up by 2 with each interval. Every member is a word, read and written
+// with atomic accesses, so that the two threads never race on plain ones.
+static struct {
+  unsigned seq;
+  uint32_t elapsed;
+  unsigned frames;
+  uint32_t ave;
+  uint32_t max;
+  int32_t min_slack;
+  unsigned misses;
+} live_out = { 0 };
+
+#define LIVE_STORE(FIELD, VALUE) \
+    __atomic_store_n(&live_out.FIELD, (VALUE), __ATOMIC_RELAXED)
+#define LIVE_LOAD(FIELD) \
+    __atomic_load_n(&live_out.FIELD, __ATOMIC_RELAXED)
+
+static
+const char* type_names[TIMING_TYPE_COUNT] = {
+  "sample", "frame", "history", "rx_transfer", "tx_transfer",
+  "rx", "rescale", "compute", "tx" };
+
+// Number of timing types, including registered phases
+static
+unsigned type_count = TIMING_BUILTIN_COUNT;
+
+// The phases, in the order they happen in each frame, and then any registered
+// with timer_phase()
+static
+timing_type_e phase_order[TIMING_TYPE_COUNT] = {
+  TIMING_PHASE_RX, TIMING_PHASE_RESCALE, TIMING_HISTORY, 
+  TIMING_PHASE_COMPUTE, TIMING_PHASE_TX };
+
+static
+unsigned phase_count = 5;
+
+// Additional values to be reported, registered with timer_report_series()
+static struct {
+  const char* name;
+  const float* values;
+  unsigned count;
+} series[TIMING_MAX_SERIES];
+
+static
+unsigned series_count = 0;
 
 // ignore this many frames before starting to track them
 // this will ensure the avg is closer to the steady state timing
 static 
 unsigned ignore_next_frames = 8; 
 
+// Count a frame in the live metrics, and hand them over to be printed if the
+// interval is over. `now` is when the frame ended. Printing is left to
+// timer_report_task(), so that it takes no time from the filter thread.
+static
+void live_update(
+    const uint32_t now,
+    const uint32_t dur,
+    const int32_t slack)
+{
+  if(!live.started){
+    live.started = 1;
+    live.start = now - dur;
+  }
+
+  live.frames++;
+  live.total += dur;
+  if(dur > live.max) live.max = dur;
+  if(slack < live.min_slack) live.min_slack = slack;
+  if(slack < 0) live.misses++;
+
+  const uint32_t elapsed = now - live.start;
+  if(elapsed < live.interval) return;
+
+  // The fence keeps the metrics from being written before `seq` is odd.
+  const unsigned seq = LIVE_LOAD(seq);
+  LIVE_STORE(seq, seq + 1);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  LIVE_STORE(elapsed, elapsed);
+  LIVE_STORE(frames, live.frames);
+  LIVE_STORE(ave, (uint32_t) (live.total / live.frames));
+  LIVE_STORE(max, live.max);
+  LIVE_STORE(min_slack, live.min_slack);
+  LIVE_STORE(misses, live.misses);
+  __atomic_store_n(&live_out.seq, seq + 2, __ATOMIC_RELEASE);
+
+  live.start = now;
+  live.frames = 0;
+  live.total = 0;
+  live.max = 0;
+  live.min_slack = INT32_MAX;
+  live.misses = 0;
+}
+
+// Print the metrics of the last complete interval, unless they have already
+// been printed.
+static
+void live_print()
+{
+  static unsigned printed = 0;
+
+  unsigned seq;
+  uint32_t elapsed, ave, max;
+  unsigned frames, misses;
+  int32_t min_slack;
+
+  // Copy them again if the filter thread was writing them at the time. The
+  // fence keeps the copy from being read after `seq` is checked again.
+  do {
+    seq = __atomic_load_n(&live_out.seq, __ATOMIC_ACQUIRE);
+    elapsed = LIVE_LOAD(elapsed);
+    frames = LIVE_LOAD(frames);
+    ave = LIVE_LOAD(ave);
+    max = LIVE_LOAD(max);
+    min_slack = LIVE_LOAD(min_slack);
+    misses = LIVE_LOAD(misses);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while((seq & 1) || LIVE_LOAD(seq) != seq);
+
+  if(seq == printed) return;
+  printed = seq;
+
+  // Reference clock is 100 MHz, so 1 tick is 10 ns. Only integers are printed,
+  // which is much quicker than printing floats on the xcore.
+  const unsigned throughput = (unsigned) 
+      ((100000000ULL * frames * deadline.frame_size) / elapsed);
+  printf("live: frames=%u frame_ave_ns=%u frame_max_ns=%u min_slack_ns=%d "
+         "misses=%u throughput=%u\n",
+         frames, 
+         (unsigned) (10 * ave),
+         (unsigned) (10 * max),
+         (int) (10 * (int64_t) min_slack),
+         misses,
+         throughput);
+  fflush(stdout);
+}
+
+// Wait up to `ticks` for input on `c`. Returns whether there is any.
+static
+int wait_input(
+    const chanend_t c,
+    const uint32_t ticks)
+{
+#if HOST_BUILD
+  // On the host a chanend is a socket (see xcore_shim.c).
+  struct pollfd p = { (int) c, POLLIN, 0 };
+  return poll(&p, 1, ticks / 100000) > 0;
+#else
+  hwtimer_t tmr = hwtimer_alloc();
+  hwtimer_set_trigger_time(tmr, get_reference_time() + ticks);
+
+  int ready = 0;
+  SELECT_RES(
+    CASE_THEN(c, on_input),
+    CASE_THEN(tmr, on_timeout))
+  {
+    on_input:
+      ready = 1;
+      break;
+    on_timeout:
+      break;
+  }
+
+  hwtimer_free(tmr);
+  return ready;
+#endif
+}
+
+// Get the histogram bucket which a duration (in ticks) is counted in. Durations
+// shorter than TIMING_HIST_SUB_BUCKETS ticks each have their own bucket.
+static inline
+unsigned hist_bucket(
+    const uint32_t ticks)
+{
+  if(ticks < TIMING_HIST_SUB_BUCKETS) return ticks;
+
+  const unsigned log2 = 31 - __builtin_clz(ticks);
+  const unsigned sub = (ticks >> (log2 - TIMING_HIST_SUB_BITS)) 
+                     & (TIMING_HIST_SUB_BUCKETS - 1);
+  return ((log2 - TIMING_HIST_SUB_BITS + 1) << TIMING_HIST_SUB_BITS) + sub;
+}
+
 void timer_start(
     const timing_type_e type)
 {
@@ -27,39 +242,309 @@ void timer_start(
 
 void timer_stop(
     const timing_type_e type)
+{
+  timer_stop_count(type, 1);
+}
+
+// Stop the timer, attributing the elapsed time to `count` events. This is used
+// where a single measured interval produced several output samples at once.
+void timer_stop_count(
+    const timing_type_e type,
+    const unsigned count)
 {
   if(ignore_next_frames){
     if(type == TIMING_FRAME) ignore_next_frames--;
     return;
   }
 
-  uint32_t dur = get_reference_time() - t_start[type];
-  t_count[type]++;
+  const uint32_t now = get_reference_time();
+  uint32_t dur = now - t_start[type];
+  t_count[type] += count;
   t_total[type] += dur;
+
+  // Each of the `count` events is taken to have lasted an equal share of the
+  // interval.
+  const uint32_t each = (count == 1)? dur : dur / count;
+  timing_dist_t* dist = &t_dist[type];
+  if(dist->count == 0 || each < dist->min) dist->min = each;
+  if(each > dist->max) dist->max = each;
+  dist->bucket[hist_bucket(each)] += count;
+  dist->count += count;
+
+  if(type == TIMING_FRAME){
+    const int32_t slack = (int32_t) (deadline.budget - dur);
+    deadline.frames++;
+    deadline.total_slack += slack;
+    if(slack < deadline.min_slack) deadline.min_slack = slack;
+    if(slack < 0){
+      deadline.misses++;
+      if(-slack > deadline.worst_overrun) deadline.worst_overrun = -slack;
+    }
+
+    if(live.interval)
+      live_update(now, dur, slack);
+  }
+}
+
+
+void timer_live_config(
+    const unsigned interval_ms)
+{
+  assert(interval_ms < 42000);
+  // Reference clock is 100 MHz
+  live.interval = 100000u * interval_ms;
+  live.started = 0;
+  live.frames = 0;
+  live.total = 0;
+  live.max = 0;
+  live.min_slack = INT32_MAX;
+  live.misses = 0;
+}
+
+
+void timer_deadline_config(
+    const unsigned sample_rate,
+    const unsigned frame_size)
+{
+  deadline.sample_rate = sample_rate;
+  deadline.frame_size = frame_size;
+  // Reference clock is 100 MHz
+  deadline.budget = (uint32_t) ((100000000ULL * frame_size) / sample_rate);
+  deadline.frames = 0;
+  deadline.misses = 0;
+  deadline.min_slack = INT32_MAX;
+  deadline.total_slack = 0;
+  deadline.worst_overrun = 0;
+}
+
+
+void timer_reset(
+    const unsigned warmup_frames)
+{
+  memset(t_count, 0, sizeof(t_count));
+  memset(t_total, 0, sizeof(t_total));
+  memset(t_dist, 0, sizeof(t_dist));
+  timer_deadline_config(deadline.sample_rate, deadline.frame_size);
+  timer_live_config(live.interval / 100000u);
+  ignore_next_frames = warmup_frames;
+}
+
+
+const timing_deadline_t* timer_deadline()
+{
+  return &deadline;
 }
 
 // Get the average execution time in nanoseconds.
 float timer_avg_ns(
     const timing_type_e type)
 {
+  // Not every stage uses every timing type.
+  if(t_count[type] == 0)
+    return 0.0f;
+
   // reference clock freq is 100 MHz, so 1 tick is 10 ns
   return (t_total[type] / ((float)t_count[type])) * (10.0f);
 }
 
 
+const char* timer_type_name(
+    const timing_type_e type)
+{
+  return type_names[type];
+}
+
+
+timing_type_e timer_phase(
+    const char* name)
+{
+  for(int t = 0; t < type_count; t++)
+    if(!strcmp(type_names[t], name)) return (timing_type_e) t;
+
+  assert(type_count < TIMING_TYPE_COUNT);
+  type_names[type_count] = name;
+  phase_order[phase_count++] = (timing_type_e) type_count;
+  return (timing_type_e) type_count++;
+}
+
+
+const timing_dist_t* timer_dist(
+    const timing_type_e type)
+{
+  return &t_dist[type];
+}
+
+
+// Reverses hist_bucket(). Results are in ticks.
+static
+uint32_t bucket_lower(
+    const unsigned bucket)
+{
+  if(bucket < TIMING_HIST_SUB_BUCKETS) return bucket;
+
+  const unsigned log2 = (bucket >> TIMING_HIST_SUB_BITS) 
+                      + TIMING_HIST_SUB_BITS - 1;
+  const unsigned sub = bucket & (TIMING_HIST_SUB_BUCKETS - 1);
+  return (TIMING_HIST_SUB_BUCKETS + sub) << (log2 - TIMING_HIST_SUB_BITS);
+}
+
+static
+uint32_t bucket_width(
+    const unsigned bucket)
+{
+  if(bucket < TIMING_HIST_SUB_BUCKETS) return 1;
+
+  const unsigned log2 = (bucket >> TIMING_HIST_SUB_BITS) 
+                      + TIMING_HIST_SUB_BITS - 1;
+  return 1u << (log2 - TIMING_HIST_SUB_BITS);
+}
+
+
+float timing_bucket_lower_ns(
+    const unsigned bucket)
+{
+  return bucket_lower(bucket) * 10.0f;
+}
+
+
+float timing_bucket_width_ns(
+    const unsigned bucket)
+{
+  return bucket_width(bucket) * 10.0f;
+}
+
+
+// The percentile is taken to be the middle of the bucket it falls in, but never
+// outside of the distribution's range.
+float timing_dist_percentile_ns(
+    const timing_dist_t* dist,
+    const float fraction)
+{
+  if(dist->count == 0) return 0.0f;
+
+  // Rank (from 1) of the duration wanted
+  uint64_t rank = (uint64_t) (fraction * dist->count + 0.999999f);
+  if(rank < 1) rank = 1;
+  if(rank > dist->count) rank = dist->count;
+
+  uint64_t seen = 0;
+  unsigned b = 0;
+  for(; b < TIMING_HIST_BUCKETS - 1; b++){
+    seen += dist->bucket[b];
+    if(seen >= rank) break;
+  }
+
+  float ticks = bucket_lower(b) + 0.5f * (bucket_width(b) - 1);
+  if(ticks < dist->min) ticks = dist->min;
+  if(ticks > dist->max) ticks = dist->max;
+  return ticks * 10.0f;
+}
+
+
+// Register an array of values to be sent along with the timing info. `values`
+// is only read when the timing info is reported, so the caller may keep
+// updating it until then. A `count` of 1 is reported as a single value rather
+// than an array.
+void timer_report_series(
+    const char* name,
+    const float* values,
+    const unsigned count)
+{
+  if(series_count == TIMING_MAX_SERIES) return;
+
+  series[series_count].name = name;
+  series[series_count].values = values;
+  series[series_count].count = (count < TIMING_MAX_SERIES_LEN)? count 
+                                                               : TIMING_MAX_SERIES_LEN;
+  series_count++;
+}
+
+
 void timer_report_task(
     chanend_t c_timing)
 {
   // This task will wait until the tile0 task is finished and then report the
-  // timing numbers once it's done.
+  // timing numbers once it's done. Meanwhile, it prints the live metrics of
+  // each interval, if they're on.
+  while(live.interval && !wait_input(c_timing, live.interval))
+    live_print();
+  if(live.interval)
+    live_print();
 
   // Simple handshake to make sure they're synchronized
-  chan_out_word(c_timing, 0);
   chan_in_word(c_timing);
+  chan_out_word(c_timing, 0);
 
   float sample_timing_ns = timer_avg_ns(TIMING_SAMPLE);
   float frame_timing_ns = timer_avg_ns(TIMING_FRAME);
+  float history_timing_ns = timer_avg_ns(TIMING_HISTORY);
+  float rx_transfer_ns = timer_avg_ns(TIMING_RX_TRANSFER);
+  float tx_transfer_ns = timer_avg_ns(TIMING_TX_TRANSFER);
 
   chan_out_word(c_timing, ((unsigned*) &sample_timing_ns)[0]);
   chan_out_word(c_timing, ((unsigned*) &frame_timing_ns)[0]);
+  chan_out_word(c_timing, ((unsigned*) &history_timing_ns)[0]);
+  chan_out_word(c_timing, ((unsigned*) &rx_transfer_ns)[0]);
+  chan_out_word(c_timing, ((unsigned*) &tx_transfer_ns)[0]);
+
+  // Each timing type is sent as its name and average, and then its distribution:
+  // its count, min and max, followed by the number of non-empty buckets and
+  // then the index and count of each of them.
+  chan_out_word(c_timing, type_count);
+  for(int t = 0; t < type_count; t++){
+    unsigned len = strlen(type_names[t]);
+    if(len >= TIMING_MAX_NAME_LEN) len = TIMING_MAX_NAME_LEN - 1;
+    chan_out_word(c_timing, len);
+    for(int i = 0; i < len; i++)
+      chan_out_byte(c_timing, type_names[t][i]);
+
+    float ave_ns = timer_avg_ns(t);
+    chan_out_word(c_timing, ((unsigned*) &ave_ns)[0]);
+
+    const timing_dist_t* dist = &t_dist[t];
+    chan_out_word(c_timing, dist->count);
+    chan_out_word(c_timing, dist->min);
+    chan_out_word(c_timing, dist->max);
+
+    unsigned used = 0;
+    for(int b = 0; b < TIMING_HIST_BUCKETS; b++)
+      used += (dist->bucket[b] != 0);
+
+    chan_out_word(c_timing, used);
+    for(int b = 0; b < TIMING_HIST_BUCKETS; b++){
+      if(dist->bucket[b] == 0) continue;
+      chan_out_word(c_timing, b);
+      chan_out_word(c_timing, dist->bucket[b]);
+    }
+  }
+
+  chan_out_word(c_timing, phase_count);
+  for(int k = 0; k < phase_count; k++)
+    chan_out_word(c_timing, phase_order[k]);
+
+  chan_out_word(c_timing, deadline.sample_rate);
+  chan_out_word(c_timing, deadline.frame_size);
+  chan_out_word(c_timing, deadline.budget);
+  chan_out_word(c_timing, deadline.frames);
+  chan_out_word(c_timing, deadline.misses);
+  chan_out_word(c_timing, (uint32_t) deadline.min_slack);
+  chan_out_word(c_timing, (uint32_t) deadline.total_slack);
+  chan_out_word(c_timing, (uint32_t) (deadline.total_slack >> 32));
+  chan_out_word(c_timing, deadline.worst_overrun);
+
+  chan_out_word(c_timing, series_count);
+  for(int k = 0; k < series_count; k++){
+    unsigned len = strlen(series[k].name);
+    if(len >= TIMING_MAX_NAME_LEN) len = TIMING_MAX_NAME_LEN - 1;
+
+    chan_out_word(c_timing, len);
+    for(int i = 0; i < len; i++)
+      chan_out_byte(c_timing, series[k].name[i]);
+
+    chan_out_word(c_timing, series[k].count);
+    for(int i = 0; i < series[k].count; i++)
+      chan_out_word(c_timing, ((unsigned*) &series[k].values[i])[0]);
+  }
+
+  trace_report(c_timing);
 }
\ No newline at end of file
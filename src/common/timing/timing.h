@@ -14,12 +14,165 @@
 typedef enum {
   TIMING_SAMPLE = 0,
   TIMING_FRAME = 1,
+  TIMING_HISTORY = 2,
+  TIMING_RX_TRANSFER = 3,
+  TIMING_TX_TRANSFER = 4,
+  // Phases of each frame's processing (see timer_phase()). TIMING_HISTORY is
+  // also a phase.
+  TIMING_PHASE_RX = 5,        // Receiving the frame and preparing its samples
+  TIMING_PHASE_RESCALE = 6,   // Rescaling the frame and history to merge them
+  TIMING_PHASE_COMPUTE = 7,   // Computing the output frame
+  TIMING_PHASE_TX = 8,        // Converting and sending the output frame
 } timing_type_e;
 
+// Number of timing types in timing_type_e
+#define TIMING_BUILTIN_COUNT  (9)
+// Maximum number of additional phases registered with timer_phase()
+#define TIMING_MAX_PHASES     (8)
+// Maximum number of timing types
+#define TIMING_TYPE_COUNT     (TIMING_BUILTIN_COUNT + TIMING_MAX_PHASES)
+
+// As well as their average, the durations measured for each timing type are
+// counted in a histogram. The buckets are log-scaled: each power of 2 (in
+// reference clock ticks) is split into TIMING_HIST_SUB_BUCKETS buckets of equal
+// width, so no bucket is wider than a quarter of its lower bound, whether it
+// holds 100 ns samples or 10 ms frames.
+#define TIMING_HIST_SUB_BITS    (2)
+#define TIMING_HIST_SUB_BUCKETS (1 << TIMING_HIST_SUB_BITS)
+#define TIMING_HIST_BUCKETS     (TIMING_HIST_SUB_BUCKETS * (33 - TIMING_HIST_SUB_BITS))
+
 void timer_start(const timing_type_e type);
 void timer_stop(const timing_type_e type);
+void timer_stop_count(const timing_type_e type, const unsigned count);
 float timer_avg_ns(const timing_type_e type);
 
+// Forget every duration measured so far, and ignore the next `warmup_frames`
+// frames, as at startup. Registered phases and the deadline monitor's budget
+// are kept. This lets several runs be timed separately (see benchmark/).
+void timer_reset(const unsigned warmup_frames);
+
+// Maximum number of series which can be registered with timer_report_series()
+#define TIMING_MAX_SERIES     (8)
+// Maximum number of values in a single series
+#define TIMING_MAX_SERIES_LEN (64)
+// Maximum length of a series name, including the terminator
+#define TIMING_MAX_NAME_LEN   (32)
+
+// The deadline monitor checks each frame's TIMING_FRAME duration against the
+// time in which it must be processed to keep up in real time, i.e. the time
+// taken by TIMING_DEADLINE_FRAME_SIZE samples at TIMING_DEADLINE_SAMPLE_RATE.
+// A stage with a different sample rate or frame size should call
+// timer_deadline_config() before it starts processing.
+#ifndef TIMING_DEADLINE_SAMPLE_RATE
+# define TIMING_DEADLINE_SAMPLE_RATE  (16000)
+#endif
+#ifndef TIMING_DEADLINE_FRAME_SIZE
+# define TIMING_DEADLINE_FRAME_SIZE   (256)
+#endif
+
+// While a stage runs, tile[1] can print a line of live metrics for the frames
+// processed in each interval of TIMING_LIVE_INTERVAL_MS milliseconds, so that
+// long runs can be watched as they go (see script/live_metrics.py). This is
+// off (0) unless set with the LIVE_METRICS_MS CMake option or with
+// timer_live_config().
+#ifndef TIMING_LIVE_INTERVAL_MS
+# define TIMING_LIVE_INTERVAL_MS  (0)
+#endif
+
+#ifndef __XC__
+/**
+ * Results of the deadline monitor. Times are in reference clock ticks.
+ */
+typedef struct {
+  // Sample rate (Hz) and frame size the budget is based on
+  unsigned sample_rate;
+  unsigned frame_size;
+  // Time available to process each frame
+  uint32_t budget;
+  // Number of frames checked, and how many of them took longer than budget
+  unsigned frames;
+  unsigned misses;
+  // Smallest slack (budget minus frame time) of any frame. Negative if any
+  // frame missed its deadline.
+  int32_t min_slack;
+  // Sum of the slack of every frame
+  int64_t total_slack;
+  // Largest amount by which a frame missed its deadline (0 if none did)
+  uint32_t worst_overrun;
+} timing_deadline_t;
+
+// Set the sample rate (Hz) and frame size that the deadline monitor's budget
+// is based on, and forget any frames already checked.
+void timer_deadline_config(
+    const unsigned sample_rate, 
+    const unsigned frame_size);
+
+// Get the deadline monitor's results
+const timing_deadline_t* timer_deadline();
+
+/**
+ * Set the interval, in milliseconds, at which live metrics are printed, or turn
+ * them off with 0. The interval must be less than 42000 ms, the period of the
+ * 32-bit reference clock.
+ * 
+ * Each line starts with "live:", and has the number of frames processed in the
+ * interval, their average and longest TIMING_FRAME durations, the least slack
+ * (see timing_deadline_t) of any of them and how many missed their deadline,
+ * all in nanoseconds, and the number of samples per second processed over the
+ * interval. The lines are printed by timer_report_task() while it waits for
+ * tile[0] to finish, so printing takes no time from the filter thread. A line
+ * may be printed up to one interval after its interval ends. Nothing is printed
+ * if live metrics are off when timer_report_task() starts.
+ */
+void timer_live_config(
+    const unsigned interval_ms);
+
+/**
+ * Distribution of the durations measured for a timing type.
+ */
+typedef struct {
+  // Number of durations
+  unsigned count;
+  // Shortest and longest durations, in reference clock ticks
+  uint32_t min;
+  uint32_t max;
+  // Number of durations in each bucket (see timing_bucket_lower_ns())
+  unsigned bucket[TIMING_HIST_BUCKETS];
+} timing_dist_t;
+
+// Get the name of a timing type, e.g. "rx_transfer"
+const char* timer_type_name(const timing_type_e type);
+
+/**
+ * Get the timing type of the phase of each frame's processing named `name`,
+ * registering it as a new phase if there isn't one. A phase is timed with
+ * timer_start() and timer_stop() like any other timing type, and is reported
+ * along with the other phases, in the order they were registered.
+ * 
+ * The phases "rx", "rescale", "history", "compute" and "tx" are already
+ * registered. `name` must remain valid until the timing info is reported.
+ */
+timing_type_e timer_phase(const char* name);
+
+// Get the distribution of the durations measured for a timing type
+const timing_dist_t* timer_dist(const timing_type_e type);
+
+// Get the lower bound of a histogram bucket, and its width, in nanoseconds
+float timing_bucket_lower_ns(const unsigned bucket);
+float timing_bucket_width_ns(const unsigned bucket);
+
+// Estimate the duration, in nanoseconds, below which a fraction `fraction` of a
+// distribution's durations fall, e.g. 0.99 for the 99th percentile.
+float timing_dist_percentile_ns(
+    const timing_dist_t* dist, 
+    const float fraction);
+
+void timer_report_series(
+    const char* name, 
+    const float* values, 
+    const unsigned count);
+#endif
+
 #ifdef __XC__
 extern "C" {
 void timer_report_task(chanend c_timing);
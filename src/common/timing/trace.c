@@ -0,0 +1,49 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include "trace.h"
+
+#include <xcore/channel.h>
+
+#if TRACE_ENABLE
+
+trace_ring_t trace_rings[TRACE_MAX_THREADS];
+
+void trace_report(
+    chanend_t c_timing)
+{
+  unsigned used = 0;
+  for(int t = 0; t < TRACE_MAX_THREADS; t++)
+    used += (trace_rings[t].count != 0);
+
+  chan_out_word(c_timing, used);
+
+  for(int t = 0; t < TRACE_MAX_THREADS; t++){
+    const trace_ring_t* ring = &trace_rings[t];
+    if(ring->count == 0) continue;
+
+    // Once the ring has wrapped, its oldest record is the next to be replaced.
+    const unsigned len = (ring->count < TRACE_RING_LEN)? ring->count
+                                                      : TRACE_RING_LEN;
+    const unsigned first = ring->count - len;
+
+    chan_out_word(c_timing, t);
+    chan_out_word(c_timing, ring->count);
+    chan_out_word(c_timing, len);
+    for(int k = 0; k < len; k++){
+      const uint64_t rec = ring->record[(first + k) & (TRACE_RING_LEN-1)];
+      chan_out_word(c_timing, (uint32_t) rec);
+      chan_out_word(c_timing, (uint32_t) (rec >> 32));
+    }
+  }
+}
+
+#else
+
+void trace_report(
+    chanend_t c_timing)
+{
+  chan_out_word(c_timing, 0);
+}
+
+#endif // TRACE_ENABLE
@@ -0,0 +1,109 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "timing.h"
+
+#ifndef __XC__
+# include <xcore/hwtimer.h>
+# include <xcore/thread.h>
+#endif
+
+// Event tracing on tile[1].
+//
+// timer_start() and timer_stop() do enough work that timing every sample with
+// them noticeably slows the loop being timed. Instead, trace_begin() and
+// trace_end() just append a record (the event and a 32-bit reference clock
+// timestamp) to a ring buffer, with a single 64-bit store. Each hardware
+// thread has its own ring, so no locking is needed, and each ring keeps its
+// newest TRACE_RING_LEN records.
+//
+// After the run, the rings are sent to tile[0] by timer_report_task(), which
+// writes them to a binary trace file next to the stage's json file. Use
+// script/trace_to_json.py to convert it for chrome://tracing or Perfetto.
+//
+// Tracing is only compiled in if TRACE_ENABLE is set (with the TRACE CMake
+// option). Otherwise trace_begin() and trace_end() do nothing.
+
+#ifndef TRACE_ENABLE
+# define TRACE_ENABLE       (0)
+#endif
+
+// Largest number of hardware threads on a tile
+#define TRACE_MAX_THREADS   (8)
+
+// Number of records in each thread's ring. Must be a power of 2.
+#ifndef TRACE_RING_LEN
+# define TRACE_RING_LEN     (1024)
+#endif
+
+// Set in a record's event for the end of an event, and clear for its beginning.
+// The rest of the event is a timing type (see timing_type_e and timer_phase()),
+// which gives the event its name.
+#define TRACE_END           (0x80000000)
+
+#ifndef __XC__
+
+/**
+ * A thread's trace ring. Each record is (event << 32) | timestamp.
+ */
+typedef struct {
+  uint64_t record[TRACE_RING_LEN];
+  // Total number of records written, including any since overwritten
+  unsigned count;
+} trace_ring_t;
+
+#if TRACE_ENABLE
+
+extern trace_ring_t trace_rings[TRACE_MAX_THREADS];
+
+static inline
+void trace_record(
+    const uint32_t event)
+{
+  trace_ring_t* ring = &trace_rings[get_logical_core_id()];
+  ring->record[ring->count++ & (TRACE_RING_LEN-1)] =
+      (((uint64_t) event) << 32) | get_reference_time();
+}
+
+#else
+
+static inline
+void trace_record(
+    const uint32_t event)
+{
+  (void) event;
+}
+
+#endif // TRACE_ENABLE
+
+// Record the beginning of an event of the given timing type
+static inline
+void trace_begin(
+    const timing_type_e type)
+{
+  trace_record(type);
+}
+
+// Record the end of an event of the given timing type
+static inline
+void trace_end(
+    const timing_type_e type)
+{
+  trace_record(TRACE_END | type);
+}
+
+/**
+ * Send the trace rings to tile[0]. Called by timer_report_task().
+ *
+ * Sends the number of rings which have records, then for each of them its
+ * thread, its total record count, the number of records which follow, and
+ * those records, oldest first, each as its timestamp and then its event.
+ */
+void trace_report(
+    chanend_t c_timing);
+
+#endif // __XC__
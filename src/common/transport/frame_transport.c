@@ -0,0 +1,62 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include <string.h>
+
+#include "frame_transport.h"
+#include "timing.h"
+
+#define HEADER_WORDS  (sizeof(frame_header_t) / sizeof(uint32_t))
+
+
+void frame_send(
+    const chanend_t c,
+    const int32_t samples[],
+    const unsigned sample_count,
+    const exponent_t exp)
+{
+  frame_header_t header = { sample_count, exp };
+
+  timer_start(TIMING_TX_TRANSFER);
+
+  transacting_chanend_t tc = chan_init_transaction_master(c);
+  t_chan_out_buf_word(&tc, (uint32_t*) &header, HEADER_WORDS);
+  t_chan_out_buf_word(&tc, (uint32_t*) &samples[0], sample_count);
+  chan_complete_transaction(tc);
+
+  timer_stop(TIMING_TX_TRANSFER);
+}
+
+
+unsigned frame_receive(
+    const chanend_t c,
+    int32_t samples[],
+    const unsigned max_count,
+    exponent_t* exp)
+{
+  frame_header_t header;
+
+  transacting_chanend_t tc = chan_init_transaction_slave(c);
+  t_chan_in_buf_word(&tc, (uint32_t*) &header, HEADER_WORDS);
+
+  timer_start(TIMING_RX_TRANSFER);
+
+  // The whole frame must be read to complete the transaction, even if it holds
+  // more samples than the caller wants.
+  const unsigned keep = (header.sample_count < max_count)? header.sample_count 
+                                                         : max_count;
+  t_chan_in_buf_word(&tc, (uint32_t*) &samples[0], keep);
+  for(int k = keep; k < header.sample_count; k++)
+    t_chan_in_word(&tc);
+  chan_complete_transaction(tc);
+
+  timer_stop(TIMING_RX_TRANSFER);
+
+  if(keep < max_count)
+    memset(&samples[keep], 0, (max_count - keep) * sizeof(int32_t));
+
+  if(exp != NULL)
+    *exp = header.exp;
+
+  return header.sample_count;
+}
@@ -0,0 +1,56 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <xcore/channel.h>
+#include <xcore/chanend.h>
+#include <xcore/channel_transaction.h>
+
+#include "xmath/xmath.h"
+
+/**
+ * Header sent at the start of every frame.
+ */
+typedef struct {
+  // Number of samples in the frame
+  uint32_t sample_count;
+  // Exponent associated with the frame's samples
+  exponent_t exp;
+} frame_header_t;
+
+/**
+ * Send a frame of samples, preceded by its header, as a single channel
+ * transaction.
+ * 
+ * Sending a word with chan_out_word() costs a full synchronising handshake
+ * between the two channel ends. Within a transaction, there is one handshake
+ * when it starts and one when it completes, and every word in between is
+ * simply streamed.
+ * 
+ * The time taken is measured as `TIMING_TX_TRANSFER`.
+ */
+void frame_send(
+    const chanend_t c,
+    const int32_t samples[],
+    const unsigned sample_count,
+    const exponent_t exp);
+
+/**
+ * Receive a frame sent with frame_send().
+ * 
+ * At most `max_count` samples are kept. If the frame had fewer, the remainder
+ * of `samples[]` is filled with zeros. If `exp` is not NULL, the frame's
+ * exponent is written to it. Returns the number of samples in the frame.
+ * 
+ * The time taken, from the header's arrival, is measured as
+ * `TIMING_RX_TRANSFER`. Time spent waiting for the frame to be sent is not
+ * included.
+ */
+unsigned frame_receive(
+    const chanend_t c,
+    int32_t samples[],
+    const unsigned max_count,
+    exponent_t* exp);
@@ -2,79 +2,166 @@
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 
 #include "wav_io.h"
+#include "timing.h"
+#include "trace.h"
+#include "frame_transport.h"
+#include "wav_stream.h"
+#include "wav_convert.h"
 
 #define CHANNEL_COUNT   (1)
-#define BIT_DEPTH       (32)
 
 #define PRINTERVAL      (1024)
 #define FRAME_SIZE      (256)
 
-#define MAX_WAV_BYTES   (150000)
+static unsigned wav_channel_count = CHANNEL_COUNT;
 
-static int wav_input_bytes = 0;
-static uint8_t wav_input_buff[MAX_WAV_BYTES];
-static uint8_t wav_output_buff[MAX_WAV_BYTES];
+// The input and output wav files are streamed, so only one chunk of each is
+// held in memory at a time, however long the files are. Multichannel files
+// hold the samples of each channel interleaved. The input is read ahead by
+// wav_reader_thread() and the output is written by wav_writer_thread(), which
+// must run alongside whichever threads consume and produce them.
+static wav_reader_t wav_input;
+static wav_writer_t wav_output;
 
+// Whether the output wav file was verified as completely written
+static unsigned wav_output_ok = 0;
 
+// Sample format of both wav files. Samples are converted to Q1.31 as they are
+// read, and back as they are written.
+static wav_sample_format_e wav_format = WAV_SAMPLE_S32;
+
+// Samples as they are stored in the input and output files. int32_t only so
+// that they are word-aligned, as the vectorized conversions require.
+static int32_t raw_in[FRAME_SIZE * WAV_IO_MAX_CHANNELS];
+static int32_t raw_out[FRAME_SIZE * WAV_IO_MAX_CHANNELS];
+
+// Reference clock ticks spent converting samples, and number of conversions
+static uint64_t convert_in_ticks = 0;
+static unsigned convert_in_count = 0;
+static uint64_t convert_out_ticks = 0;
+static unsigned convert_out_count = 0;
+
+// Additional series of values reported by tile[1] (see timer_report_series())
+typedef struct {
+  char name[TIMING_MAX_NAME_LEN];
+  float values[TIMING_MAX_SERIES_LEN];
+  unsigned count;
+} perf_series_t;
+
+static perf_series_t perf_series[TIMING_MAX_SERIES];
+static unsigned perf_series_count = 0;
+
+// Each timing type's average and distribution, as reported by tile[1]
 typedef struct {
-  wav_header_t header;
-  int32_t data[];
-} wav_file_1chan_pcm32_t;
+  char name[TIMING_MAX_NAME_LEN];
+  float ave_ns;
+  timing_dist_t dist;
+} perf_timing_t;
+
+static perf_timing_t perf_timing[TIMING_TYPE_COUNT];
+static unsigned perf_timing_count = 0;
+
+// The phases of each frame's processing, as indices into perf_timing[], in the
+// order they happen
+static unsigned perf_phase[TIMING_TYPE_COUNT];
+static unsigned perf_phase_count = 0;
 
-static wav_file_1chan_pcm32_t* wav_input = 
-    (wav_file_1chan_pcm32_t*) &wav_input_buff[0];
+// Deadline monitor results reported by tile[1]
+static timing_deadline_t perf_deadline;
 
-static wav_file_1chan_pcm32_t* wav_output = 
-    (wav_file_1chan_pcm32_t*) &wav_output_buff[0];
+// Percentiles reported for each distribution, and their names
+static const float dist_fractions[] = {0.5f, 0.9f, 0.99f, 0.999f};
+static const char* dist_fraction_names[] = {"p50", "p90", "p99", "p99_9"};
+#define DIST_FRACTION_COUNT   (sizeof(dist_fractions) / sizeof(float))
 
 
 /**
- * 
- * 
+ * Write the distribution of a timing type's durations as a json member named
+ * `<type>_time_dist`.
  */
-static 
-int read_input_wav(
-    const char* input_file_name )
+static
+void write_dist(
+    file_t* json_output,
+    const char* name,
+    const timing_dist_t* dist)
 {
-  printf("Reading input: %s... ", input_file_name);
-
-  file_t wav_input;
-  const int ret = file_open(&wav_input, input_file_name, "rb");
-  if(ret != 0) return ret;
-
-  wav_input_bytes = get_file_size(&wav_input);
-  if( wav_input_bytes > sizeof(wav_input_buff) ){
-    printf("Input WAV file too large. (%d > %u)\n", 
-           wav_input_bytes, sizeof(wav_input_buff));
-    return 100;
+  char str_buff[100];
+  unsigned c = sprintf(str_buff, 
+      ",\n\"%s_time_dist\": {\n  \"count\": %u,\n  \"min\": %0.02f", 
+      name, dist->count, dist->min * 10.0f);
+  file_write(json_output, str_buff, c);
+
+  for(int k = 0; k < DIST_FRACTION_COUNT; k++){
+    c = sprintf(str_buff, ",\n  \"%s\": %0.02f", dist_fraction_names[k],
+                timing_dist_percentile_ns(dist, dist_fractions[k]));
+    file_write(json_output, str_buff, c);
   }
 
-  file_read(&wav_input, (void*) &wav_input_buff[0], wav_input_bytes);
+  // The histogram's non-empty buckets, each as [lower bound (ns), count]
+  c = sprintf(str_buff, ",\n  \"max\": %0.02f,\n  \"histogram\": [", 
+              dist->max * 10.0f);
+  file_write(json_output, str_buff, c);
+
+  unsigned first = 1;
+  for(int b = 0; b < TIMING_HIST_BUCKETS; b++){
+    if(dist->bucket[b] == 0) continue;
+    c = sprintf(str_buff, "%s[%0.02f, %u]", first? "" : ", ", 
+                timing_bucket_lower_ns(b), dist->bucket[b]);
+    file_write(json_output, str_buff, c);
+    first = 0;
+  }
 
-  printf("done.\n");
-  
-  return 0;
+  file_write(json_output, (void*) "]\n}", 3);
 }
 
+
 /**
+ * Write the deadline monitor's results as a json member named `deadline`.
  * 
- * 
+ * The frame time distribution gives the slack percentiles, and its maximum is
+ * taken as the time a frame needs, to estimate the highest sample rate the
+ * stage could keep up with and how many channels it could process within the
+ * budget.
  */
 static
-int write_output_wav(
-    const char* output_file_name)
+void write_deadline(
+    file_t* json_output,
+    const timing_deadline_t* dl,
+    const timing_dist_t* frame_dist)
 {
-  printf("Writing: %s... ", output_file_name);
+  const float budget_ns = dl->budget * 10.0f;
+  const float worst_ns = frame_dist->max * 10.0f;
+  const float ave_slack_ns = (10.0f * dl->total_slack) / dl->frames;
 
-  // This is the only way that seems to consistently write out the file.
-  FILE* tmp = fopen(output_file_name, "wb");
-  for(int k = 0; k < wav_input_bytes; k++){
-    fwrite(&wav_output_buff[k], 1, 1, tmp);
+  char str_buff[250];
+  unsigned c = sprintf(str_buff, 
+      ",\n\"deadline\": {\n  \"sample_rate\": %u,\n  \"frame_size\": %u,"
+      "\n  \"budget\": %0.02f,\n  \"frames\": %u,\n  \"misses\": %u,"
+      "\n  \"worst_overrun\": %0.02f",
+      dl->sample_rate, dl->frame_size, budget_ns, dl->frames, dl->misses, 
+      dl->worst_overrun * 10.0f);
+  file_write(json_output, str_buff, c);
+
+  c = sprintf(str_buff, 
+      ",\n  \"min_slack\": %0.02f,\n  \"ave_slack\": %0.02f", 
+      dl->min_slack * 10.0f, ave_slack_ns);
+  file_write(json_output, str_buff, c);
+
+  // slack_p99 is the slack which 99% of frames had at least, i.e. the budget
+  // minus the p99 frame time.
+  for(int k = 0; k < DIST_FRACTION_COUNT; k++){
+    c = sprintf(str_buff, ",\n  \"slack_%s\": %0.02f", dist_fraction_names[k],
+        budget_ns - timing_dist_percentile_ns(frame_dist, dist_fractions[k]));
+    file_write(json_output, str_buff, c);
   }
-  fclose(tmp);
 
-  printf("done.\n");
-  return 0;
+  c = sprintf(str_buff, 
+      ",\n  \"utilization\": %0.04f,\n  \"max_sample_rate\": %0.02f,"
+      "\n  \"channels\": %u\n}",
+      (budget_ns - ave_slack_ns) / budget_ns,
+      worst_ns? (1.0e9f * dl->frame_size) / worst_ns : 0.0f,
+      frame_dist->max? dl->budget / frame_dist->max : 0);
+  file_write(json_output, str_buff, c);
 }
 
 
@@ -85,7 +172,16 @@ int write_output_wav(
 int write_performance_info(
     const char* perf_file_name,
     const float ave_sample_time_ns,
-    const float ave_frame_time_ns)
+    const float ave_frame_time_ns,
+    const float ave_history_time_ns,
+    const float ave_rx_transfer_time_ns,
+    const float ave_tx_transfer_time_ns,
+    const float throughput,
+    const perf_timing_t timing[],
+    const unsigned timing_count,
+    const unsigned phase[],
+    const unsigned phase_count,
+    const timing_deadline_t* deadline)
 {
   file_t json_output;
   const int ret = file_open(&json_output, 
@@ -93,29 +189,167 @@ int write_performance_info(
                             "wb");
   if(ret != 0) return ret;
 
-  char str_buff[100] = {0};
-  unsigned c = sprintf(str_buff, 
-      "{\n\"sample_time\": %0.02f,\n\"tap_time\": %0.02f,\n\"frame_time\": %0.02f\n}\n", 
-      ave_sample_time_ns,
-      ave_sample_time_ns / 1024,
-      ave_frame_time_ns);
-      
-  file_write(&json_output, 
-             str_buff, 
-             c);
+  // Each value is written separately, so that str_buff[] only ever has to
+  // hold one of them.
+  const char* ave_names[] = {
+      "sample_time", "tap_time", "frame_time", "history_time",
+      "rx_transfer_time", "tx_transfer_time", "end_to_end_throughput" };
+  const float ave_values[] = {
+      ave_sample_time_ns, ave_sample_time_ns / 1024, ave_frame_time_ns,
+      ave_history_time_ns, ave_rx_transfer_time_ns, ave_tx_transfer_time_ns,
+      throughput };
+
+  char str_buff[250] = {0};
+  unsigned c;
+  for(int k = 0; k < sizeof(ave_values) / sizeof(ave_values[0]); k++){
+    c = sprintf(str_buff, "%s\n\"%s\": %0.02f", k? "," : "{", ave_names[k],
+                ave_values[k]);
+    file_write(&json_output, str_buff, c);
+  }
+
+  // Host builds (see src/host/) time things with the host's clock.
+#if HOST_BUILD
+  c = sprintf(str_buff, ",\n\"platform\": \"host\"");
+#else
+  c = sprintf(str_buff, ",\n\"platform\": \"xcore\"");
+#endif
+  file_write(&json_output, str_buff, c);
+
+  // Output file write throughput, in bytes per second of time spent writing.
+  const float write_throughput = wav_output.write_ticks?
+      (100.0e6f * wav_output.bytes_written) / wav_output.write_ticks : 0.0f;
+  c = sprintf(str_buff, 
+      ",\n\"write_throughput\": %0.02f,\n\"write_retries\": %u,\n\"write_verified\": %s",
+      write_throughput,
+      wav_output.retries,
+      wav_output_ok? "true" : "false");
+  file_write(&json_output, str_buff, c);
+
+  // Average time to convert each frame (of all channels) to and from the
+  // files' sample format
+  const float input_convert_ns = convert_in_count? 
+      (10.0f * convert_in_ticks) / convert_in_count : 0.0f;
+  const float output_convert_ns = convert_out_count? 
+      (10.0f * convert_out_ticks) / convert_out_count : 0.0f;
+  c = sprintf(str_buff, 
+      ",\n\"sample_format\": \"%s\",\n\"input_convert_time\": %0.02f,\n\"output_convert_time\": %0.02f",
+      wav_sample_format_name(wav_format),
+      input_convert_ns,
+      output_convert_ns);
+  file_write(&json_output, str_buff, c);
+
+  if(wav_channel_count != 1){
+    c = sprintf(str_buff, 
+        ",\n\"channel_count\": %u,\n\"end_to_end_channel_throughput\": %0.02f",
+        wav_channel_count,
+        throughput * wav_channel_count);
+    file_write(&json_output, str_buff, c);
+  }
+
+  // Timing types which weren't used have empty distributions. The averages of
+  // the original five types have already been written.
+  for(int t = 0; t < timing_count; t++){
+    if(timing[t].dist.count == 0) continue;
+    if(t > TIMING_TX_TRANSFER){
+      c = sprintf(str_buff, ",\n\"%s_time\": %0.02f", timing[t].name,
+                  timing[t].ave_ns);
+      file_write(&json_output, str_buff, c);
+    }
+    write_dist(&json_output, timing[t].name, &timing[t].dist);
+  }
+
+  // The names of the phases which were timed, in the order they happen
+  c = sprintf(str_buff, ",\n\"phases\": [");
+  file_write(&json_output, str_buff, c);
+  unsigned first = 1;
+  for(int k = 0; k < phase_count; k++){
+    const perf_timing_t* ph = &timing[phase[k]];
+    if(ph->dist.count == 0) continue;
+    c = sprintf(str_buff, "%s\"%s\"", first? "" : ", ", ph->name);
+    file_write(&json_output, str_buff, c);
+    first = 0;
+  }
+  file_write(&json_output, (void*) "]", 1);
+
+  if(deadline->frames)
+    write_deadline(&json_output, deadline, &timing[TIMING_FRAME].dist);
+
+  // Each series is written as a single value or as an array of values.
+  for(int k = 0; k < perf_series_count; k++){
+    const perf_series_t* ser = &perf_series[k];
+
+    c = sprintf(str_buff, ",\n\"%s\": %s", ser->name, 
+                (ser->count == 1)? "" : "[");
+    file_write(&json_output, str_buff, c);
+
+    for(int i = 0; i < ser->count; i++){
+      c = sprintf(str_buff, "%s%0.02f", i? ", " : "", ser->values[i]);
+      file_write(&json_output, str_buff, c);
+    }
+
+    if(ser->count != 1)
+      file_write(&json_output, (void*) "]", 1);
+  }
+
+  file_write(&json_output, (void*) "\n}\n", 3);
 
   file_close(&json_output);
 
   printf("Average sample time: %0.02f ns\n", ave_sample_time_ns);
   printf("Average tap time: %0.02f ns\n", ave_sample_time_ns / 1024);
   printf("Average frame time: %0.02f ns\n", ave_frame_time_ns);
+  printf("Average history update time: %0.02f ns\n", ave_history_time_ns);
+  printf("Average frame receive time: %0.02f ns\n", ave_rx_transfer_time_ns);
+  printf("Average frame send time: %0.02f ns\n", ave_tx_transfer_time_ns);
+  printf("End-to-end throughput: %0.02f samples/s\n", throughput);
+  for(int t = 0; t < timing_count; t++){
+    const timing_dist_t* dist = &timing[t].dist;
+    if(dist->count == 0) continue;
+    printf("%s time (ns): min %0.02f", timing[t].name, dist->min * 10.0f);
+    for(int k = 0; k < DIST_FRACTION_COUNT; k++)
+      printf(", %s %0.02f", dist_fraction_names[k], 
+             timing_dist_percentile_ns(dist, dist_fractions[k]));
+    printf(", max %0.02f\n", dist->max * 10.0f);
+  }
+  printf("Average frame phase times (ns):");
+  for(int k = 0; k < phase_count; k++)
+    if(timing[phase[k]].dist.count)
+      printf(" %s %0.02f", timing[phase[k]].name, timing[phase[k]].ave_ns);
+  printf("\n");
+  if(deadline->frames){
+    const timing_dist_t* dist = &timing[TIMING_FRAME].dist;
+    const float worst_ns = dist->max * 10.0f;
+    printf("Deadline: %u misses in %u frames (budget %0.02f ns, worst overrun "
+           "%0.02f ns, min slack %0.02f ns)\n", deadline->misses, 
+           deadline->frames, deadline->budget * 10.0f, 
+           deadline->worst_overrun * 10.0f, deadline->min_slack * 10.0f);
+    printf("Max sustainable sample rate: %0.02f Hz (%u channels fit at %u Hz)\n",
+           worst_ns? (1.0e9f * deadline->frame_size) / worst_ns : 0.0f, 
+           dist->max? deadline->budget / dist->max : 0, 
+           deadline->sample_rate);
+  }
+  printf("Output write throughput: %0.02f bytes/s (%u retries)\n", 
+         write_throughput, wav_output.retries);
+  printf("Average %s frame conversion time: %0.02f ns in, %0.02f ns out\n",
+         wav_sample_format_name(wav_format), input_convert_ns, 
+         output_convert_ns);
+  if(wav_channel_count != 1)
+    printf("End-to-end throughput: %0.02f channel-samples/s (%u channels)\n", 
+           throughput * wav_channel_count, wav_channel_count);
+  for(int k = 0; k < perf_series_count; k++){
+    printf("%s:", perf_series[k].name);
+    for(int i = 0; i < perf_series[k].count; i++)
+      printf(" %0.02f", perf_series[k].values[i]);
+    printf("\n");
+  }
   return 0;
 }
 
 
 /**
  * Sends a full frame to the next stage and gets the output.
- * The output samples will be placed in `frame`'s buffer.
+ * The output samples will be placed in `samples_out[]`, which must have room
+ * for FRAME_SIZE samples.
  */
 void send_frame(
     int32_t samples_out[],
@@ -123,54 +357,343 @@ void send_frame(
     const unsigned sample_count,
     const chanend_t c_audio)
 {
-  for(int s = 0; s < sample_count; s++)
-    chan_out_word(c_audio, samples_in[s]);
-  for(int s = sample_count; s < FRAME_SIZE; s++)
-    chan_out_word(c_audio, 0);
+  // A short frame is padded with zeros by the receiver.
+  frame_send(c_audio, samples_in, sample_count, -31);
 
-  // Use a temp buffer just to make sure we don't overrun wav_output_buff[].
-  int32_t out_buff[FRAME_SIZE];
+  exponent_t out_exp;
 
   // We expect to get FRAME_SIZE samples back from the pipeline.
-  for(int s = 0; s < FRAME_SIZE; s++)
-    out_buff[s] = chan_in_word(c_audio);
-  
-  memcpy(&samples_out[0], &out_buff[0], sizeof(int32_t) * sample_count);
+  frame_receive(c_audio, samples_out, FRAME_SIZE, &out_exp);
+
+  // The output wav file holds Q1.31 samples.
+  assert(out_exp == -31);
+}
+
+
+/**
+ * Read `count` samples (of all channels) from the input wav file, as Q1.31.
+ */
+static
+void read_samples(
+    int32_t samples[],
+    const unsigned count)
+{
+  // No conversion is needed for 32-bit PCM.
+  if(wav_format == WAV_SAMPLE_S32){
+    wav_reader_read(&wav_input, samples, count * sizeof(int32_t));
+    return;
+  }
+
+  wav_reader_read(&wav_input, raw_in, count * wav_sample_bytes(wav_format));
+
+  const uint32_t t_start = get_reference_time();
+  wav_samples_to_q31(samples, raw_in, count, wav_format);
+  convert_in_ticks += get_reference_time() - t_start;
+  convert_in_count++;
+}
+
+
+/**
+ * Write `count` Q1.31 samples (of all channels) to the output wav file.
+ */
+static
+void write_samples(
+    const int32_t samples[],
+    const unsigned count)
+{
+  if(wav_format == WAV_SAMPLE_S32){
+    wav_writer_write(&wav_output, samples, count * sizeof(int32_t));
+    return;
+  }
+
+  const uint32_t t_start = get_reference_time();
+  wav_samples_from_q31(raw_out, samples, count, wav_format);
+  convert_out_ticks += get_reference_time() - t_start;
+  convert_out_count++;
+
+  wav_writer_write(&wav_output, raw_out, count * wav_sample_bytes(wav_format));
+}
+
+
+/**
+ * Open the input wav file, and create the output wav file with the same
+ * format.
+ * 
+ * If `channel_count` is 0, the file may have any number of channels up to
+ * WAV_IO_MAX_CHANNELS. Returns the number of samples per channel to be
+ * processed.
+ */
+static
+unsigned load_input(
+  const char* input_file_name,
+  const char* output_file_name,
+  const unsigned channel_count)
+{
+  printf("Reading input: %s\n", input_file_name);
+  assert( !wav_reader_open(&wav_input, input_file_name) );
+
+  // Check that the wav file seems to contain what we expect.
+  assert( !wav_header_check_details(&wav_input.header, 
+              channel_count, 0, 0) );
+
+  wav_channel_count = wav_input.header.num_channels;
+  assert( wav_channel_count <= WAV_IO_MAX_CHANNELS );
+
+  wav_format = wav_sample_format(&wav_input.header);
+  printf("Input sample format: %s\n", wav_sample_format_name(wav_format));
+
+  printf("Writing: %s\n", output_file_name);
+  assert( !wav_writer_open(&wav_output, output_file_name, &wav_input.header) );
+
+  return wav_header_get_sample_count(&wav_input.header);
+}
+
+
+// Write a word to a trace file
+static inline
+void trace_file_word(
+    file_t* file,
+    uint32_t word)
+{
+  file_write(file, &word, sizeof(word));
 }
 
 
 /**
+ * Receive the trace rings sent by trace_report() and, if there are any, write
+ * them to a binary trace file, which is named after `perf_file_name` but with
+ * the extension `.trace`. (See script/trace_to_json.py.)
  * 
+ * All words in the file are little-endian uint32. It starts with "XTRC", the
+ * format version (1) and the timestamps' clock rate in Hz. Then the number of
+ * timing types, and each one's name as its length and its characters, so that
+ * events can be named. Then the number of rings, and each ring exactly as it
+ * was sent by trace_report().
+ */
+static
+void receive_trace(
+    chanend_t c_timing,
+    const char* perf_file_name)
+{
+  const unsigned ring_count = chan_in_word(c_timing);
+  if(ring_count == 0) return;
+
+  char trace_file_name[256];
+  const char* ext = strrchr(perf_file_name, '.');
+  const int base_len = ext? (ext - perf_file_name) : strlen(perf_file_name);
+  snprintf(trace_file_name, sizeof(trace_file_name), "%.*s.trace", 
+           base_len, perf_file_name);
+
+  file_t trace_output;
+  const int ret = file_open(&trace_output, trace_file_name, "wb");
+
+  if(ret == 0){
+    file_write(&trace_output, (void*) "XTRC", 4);
+    trace_file_word(&trace_output, 1);
+    trace_file_word(&trace_output, 100000000);
+
+    trace_file_word(&trace_output, perf_timing_count);
+    for(int t = 0; t < perf_timing_count; t++){
+      const unsigned len = strlen(perf_timing[t].name);
+      trace_file_word(&trace_output, len);
+      file_write(&trace_output, perf_timing[t].name, len);
+    }
+
+    trace_file_word(&trace_output, ring_count);
+  }
+
+  // The records are received (and written) in blocks, however many there are.
+  uint32_t block[2 * 64];
+  unsigned record_count = 0;
+  unsigned lost_count = 0;
+
+  for(int r = 0; r < ring_count; r++){
+    const unsigned thread = chan_in_word(c_timing);
+    const unsigned total = chan_in_word(c_timing);
+    const unsigned len = chan_in_word(c_timing);
+
+    if(ret == 0){
+      trace_file_word(&trace_output, thread);
+      trace_file_word(&trace_output, total);
+      trace_file_word(&trace_output, len);
+    }
+
+    for(unsigned k = 0; k < len; ){
+      const unsigned n = (len - k < 64)? (len - k) : 64;
+      for(int i = 0; i < 2 * n; i++)
+        block[i] = chan_in_word(c_timing);
+      if(ret == 0)
+        file_write(&trace_output, block, 2 * n * sizeof(uint32_t));
+      k += n;
+    }
+
+    record_count += len;
+    lost_count += total - len;
+  }
+
+  if(ret != 0){
+    printf("Couldn't write trace file %s\n", trace_file_name);
+    return;
+  }
+
+  file_close(&trace_output);
+  printf("Wrote %u trace records (%u overwritten) to %s\n", 
+         record_count, lost_count, trace_file_name);
+}
+
+
+/**
+ * Close the output wav file, collect the timing info from tile[1] and write the
+ * performance info. The reader's and writer's background threads must already
+ * have been stopped with wav_reader_finish() and wav_writer_finish().
  * 
+ * `throughput` is the number of samples processed per second, as seen from
+ * tile[0].
  */
-void wav_io_task(
-  chanend_t c_audio, 
+static
+void finish(
   chanend_t c_timing,
-  const char* input_file_name, 
   const char* output_file_name,
-  const char* perf_file_name)
+  const char* perf_file_name,
+  const float throughput)
 {
-  assert( !read_input_wav(input_file_name) );
+  printf("Finished processing audio data.\n");
 
-  // Check that the wav file seems to contain what we expect.
-  assert( !wav_header_check_details(&(wav_input->header), 
-              CHANNEL_COUNT, 0, BIT_DEPTH) );
+  // Patch the output wav file's header and check it was completely written
+  printf("Closing: %s... ", output_file_name);
+  wav_output_ok = !wav_writer_close(&wav_output);
+  wav_reader_close(&wav_input);
+  printf(wav_output_ok? "done.\n" : "FAILED: output file is incomplete.\n");
+
+  // Get the timing info from tile1.
+  chan_out_word(c_timing, 0);
+  chan_in_word(c_timing);
+
+  unsigned tmp = chan_in_word(c_timing);
+  float sample_timing_ns = ((float*)&tmp)[0];
+  tmp = chan_in_word(c_timing);
+  float frame_timing_ns = ((float*)&tmp)[0];
+  tmp = chan_in_word(c_timing);
+  float history_timing_ns = ((float*)&tmp)[0];
+  tmp = chan_in_word(c_timing);
+  float rx_transfer_ns = ((float*)&tmp)[0];
+  tmp = chan_in_word(c_timing);
+  float tx_transfer_ns = ((float*)&tmp)[0];
+
+  // See timer_report_task() for the format of the timing types.
+  perf_timing_count = chan_in_word(c_timing);
+  assert(perf_timing_count <= TIMING_TYPE_COUNT);
+  for(int t = 0; t < perf_timing_count; t++){
+    perf_timing_t* pt = &perf_timing[t];
+
+    const unsigned len = chan_in_word(c_timing);
+    for(int i = 0; i < len; i++)
+      pt->name[i] = chan_in_byte(c_timing);
+    pt->name[len] = '\0';
+
+    tmp = chan_in_word(c_timing);
+    pt->ave_ns = ((float*)&tmp)[0];
+
+    timing_dist_t* dist = &pt->dist;
+    memset(dist, 0, sizeof(timing_dist_t));
+    dist->count = chan_in_word(c_timing);
+    dist->min = chan_in_word(c_timing);
+    dist->max = chan_in_word(c_timing);
+
+    const unsigned used = chan_in_word(c_timing);
+    for(int k = 0; k < used; k++){
+      const unsigned b = chan_in_word(c_timing);
+      const unsigned count = chan_in_word(c_timing);
+      assert(b < TIMING_HIST_BUCKETS);
+      dist->bucket[b] = count;
+    }
+  }
+
+  perf_phase_count = chan_in_word(c_timing);
+  for(int k = 0; k < perf_phase_count; k++)
+    perf_phase[k] = chan_in_word(c_timing);
+
+  perf_deadline.sample_rate = chan_in_word(c_timing);
+  perf_deadline.frame_size = chan_in_word(c_timing);
+  perf_deadline.budget = chan_in_word(c_timing);
+  perf_deadline.frames = chan_in_word(c_timing);
+  perf_deadline.misses = chan_in_word(c_timing);
+  perf_deadline.min_slack = (int32_t) chan_in_word(c_timing);
+  perf_deadline.total_slack = chan_in_word(c_timing);
+  perf_deadline.total_slack |= ((uint64_t) chan_in_word(c_timing)) << 32;
+  perf_deadline.worst_overrun = chan_in_word(c_timing);
+
+  perf_series_count = chan_in_word(c_timing);
+  for(int k = 0; k < perf_series_count; k++){
+    perf_series_t* ser = &perf_series[k];
+
+    const unsigned len = chan_in_word(c_timing);
+    for(int i = 0; i < len; i++)
+      ser->name[i] = chan_in_byte(c_timing);
+    ser->name[len] = '\0';
+
+    ser->count = chan_in_word(c_timing);
+    for(int i = 0; i < ser->count; i++){
+      tmp = chan_in_word(c_timing);
+      ser->values[i] = ((float*)&tmp)[0];
+    }
+  }
 
-  // Copy the input header to the output header.
-  wav_output->header = wav_input->header;
+  receive_trace(c_timing, perf_file_name);
 
-  const unsigned sample_count = wav_header_get_sample_count(&(wav_input->header));
-  
+  write_performance_info(perf_file_name, 
+                         sample_timing_ns, 
+                         frame_timing_ns,
+                         history_timing_ns,
+                         rx_transfer_ns,
+                         tx_transfer_ns,
+                         throughput,
+                         perf_timing,
+                         perf_timing_count,
+                         perf_phase,
+                         perf_phase_count,
+                         &perf_deadline);
+}
+
+
+// Samples per second, given the reference clock ticks taken. The reference
+// clock is 100 MHz.
+static inline
+float samples_per_sec(
+  const unsigned sample_count,
+  const uint32_t ticks)
+{
+  return ticks? (100.0e6f * sample_count) / ticks : 0.0f;
+}
+
+
+/**
+ * Sends each input frame to tile[1] and writes the output frame it gets back,
+ * and reports the total time taken.
+ */
+DECLARE_JOB(send_frames, (chanend_t, unsigned, uint32_t*));
+void send_frames(
+  chanend_t c_audio,
+  const unsigned sample_count,
+  uint32_t* ticks)
+{
   unsigned next_sample = 0;
 
+  int32_t frame_in[FRAME_SIZE];
+  int32_t frame_out[FRAME_SIZE];
+
+  const uint32_t t_start = get_reference_time();
+
   while(next_sample < sample_count){
     const unsigned samples_left = sample_count - next_sample;
     const unsigned iter_samples = (samples_left >= FRAME_SIZE)? FRAME_SIZE 
                                                               : samples_left;
     
-    send_frame(&(wav_output->data[next_sample]), 
-               &(wav_input->data[next_sample]),
-               iter_samples, c_audio);
+    read_samples(frame_in, iter_samples);
+
+    send_frame(frame_out, frame_in, iter_samples, c_audio);
+
+    write_samples(frame_out, iter_samples);
                
     next_sample += iter_samples;
 
@@ -179,21 +702,224 @@ void wav_io_task(
     }
   }
 
-  printf("Finished processing audio data.\n");
+  *ticks = get_reference_time() - t_start;
 
-  // Write the output wav file
-  assert( !write_output_wav(output_file_name) );
+  wav_reader_finish(&wav_input);
+  wav_writer_finish(&wav_output);
+}
 
-  // Get the timing info from tile1.
-  chan_in_word(c_timing);
-  chan_out_word(c_timing, 0);
 
-  unsigned tmp = chan_in_word(c_timing);
-  float sample_timing_ns = ((float*)&tmp)[0];
-  tmp = chan_in_word(c_timing);
-  float frame_timing_ns = ((float*)&tmp)[0];
+/**
+ * 
+ * 
+ */
+void wav_io_task(
+  chanend_t c_audio, 
+  chanend_t c_timing,
+  const char* input_file_name, 
+  const char* output_file_name,
+  const char* perf_file_name)
+{
+  const unsigned sample_count = load_input(input_file_name, output_file_name,
+                                          CHANNEL_COUNT);
 
-  write_performance_info(perf_file_name, 
-                         sample_timing_ns, 
-                         frame_timing_ns);
+  uint32_t ticks = 0;
+
+  PAR_JOBS(
+    PJOB(send_frames, (c_audio, sample_count, &ticks)),
+    PJOB(wav_reader_thread, (&wav_input)),
+    PJOB(wav_writer_thread, (&wav_output))
+  );
+
+  finish(c_timing, output_file_name, perf_file_name, 
+         samples_per_sec(sample_count, ticks));
+}
+
+
+// Time at which streaming began
+static uint32_t stream_start_time;
+
+
+/**
+ * Streaming mode sender. Sends every input frame to tile[1] without waiting
+ * for any output. The last frame may be short; the receiver pads it with
+ * zeros.
+ */
+DECLARE_JOB(stream_send, (chanend_t, unsigned));
+void stream_send(
+  chanend_t c_audio_in,
+  const unsigned sample_count)
+{
+  for(int next_sample = 0; next_sample < sample_count; next_sample += FRAME_SIZE){
+    const unsigned samples_left = sample_count - next_sample;
+    const unsigned iter_samples = (samples_left >= FRAME_SIZE)? FRAME_SIZE 
+                                                              : samples_left;
+
+    int32_t frame_in[FRAME_SIZE];
+    read_samples(frame_in, iter_samples);
+
+    frame_send(c_audio_in, frame_in, iter_samples, -31);
+  }
+
+  wav_reader_finish(&wav_input);
+}
+
+
+/**
+ * Streaming mode receiver. Receives every output frame from tile[1], and
+ * reports the total time taken since streaming began.
+ */
+DECLARE_JOB(stream_receive, (chanend_t, unsigned, uint32_t*));
+void stream_receive(
+  chanend_t c_audio_out,
+  const unsigned sample_count,
+  uint32_t* ticks)
+{
+  for(int next_sample = 0; next_sample < sample_count; next_sample += FRAME_SIZE){
+    const unsigned samples_left = sample_count - next_sample;
+    const unsigned iter_samples = (samples_left >= FRAME_SIZE)? FRAME_SIZE 
+                                                              : samples_left;
+
+    // We expect to get FRAME_SIZE samples back from the pipeline, but only
+    // iter_samples of them are kept.
+    int32_t frame_out[FRAME_SIZE];
+    exponent_t out_exp;
+    frame_receive(c_audio_out, frame_out, FRAME_SIZE, &out_exp);
+    assert(out_exp == -31);
+
+    write_samples(frame_out, iter_samples);
+
+    if((next_sample + iter_samples) % PRINTERVAL == 0){
+      printf("Processed %u samples..\n", next_sample + iter_samples);
+    }
+  }
+
+  *ticks = get_reference_time() - stream_start_time;
+
+  wav_writer_finish(&wav_output);
+}
+
+
+/**
+ * Like wav_io_task(), except that input and output frames use separate
+ * channels, and are sent and received by separate threads. Input frames are
+ * sent as fast as tile[1] will accept them, so a pipelined filter task can be
+ * receiving new frames while it is still sending earlier ones.
+ */
+void wav_io_stream_task(
+  chanend_t c_audio_in, 
+  chanend_t c_audio_out, 
+  chanend_t c_timing,
+  const char* input_file_name, 
+  const char* output_file_name,
+  const char* perf_file_name)
+{
+  const unsigned sample_count = load_input(input_file_name, output_file_name,
+                                          CHANNEL_COUNT);
+
+  uint32_t ticks = 0;
+
+  stream_start_time = get_reference_time();
+
+  PAR_JOBS(
+    PJOB(stream_send, (c_audio_in, sample_count)),
+    PJOB(stream_receive, (c_audio_out, sample_count, &ticks)),
+    PJOB(wav_reader_thread, (&wav_input)),
+    PJOB(wav_writer_thread, (&wav_output))
+  );
+
+  finish(c_timing, output_file_name, perf_file_name, 
+         samples_per_sec(sample_count, ticks));
+}
+
+
+/**
+ * Multichannel counterpart of send_frames().
+ * 
+ * The channel count is sent to tile[1] before any audio. Then, for each block
+ * of FRAME_SIZE samples, the interleaved input is split into one frame per
+ * channel, and the frames are sent in channel order. The same number of output
+ * frames is then received and interleaved into the output wav file.
+ */
+DECLARE_JOB(send_blocks, (chanend_t, unsigned, uint32_t*));
+void send_blocks(
+  chanend_t c_audio,
+  const unsigned sample_count,
+  uint32_t* ticks)
+{
+  const unsigned chans = wav_channel_count;
+
+  // One block of FRAME_SIZE samples of every channel, interleaved
+  static int32_t block_in[FRAME_SIZE * WAV_IO_MAX_CHANNELS];
+  static int32_t block_out[FRAME_SIZE * WAV_IO_MAX_CHANNELS];
+
+  printf("Input has %u channels.\n", chans);
+
+  const uint32_t t_start = get_reference_time();
+
+  chan_out_word(c_audio, chans);
+
+  for(int next_sample = 0; next_sample < sample_count; next_sample += FRAME_SIZE){
+    const unsigned samples_left = sample_count - next_sample;
+    const unsigned iter_samples = (samples_left >= FRAME_SIZE)? FRAME_SIZE 
+                                                              : samples_left;
+
+    read_samples(block_in, iter_samples * chans);
+
+    int32_t frame[FRAME_SIZE];
+
+    for(int ch = 0; ch < chans; ch++){
+      for(int s = 0; s < iter_samples; s++)
+        frame[s] = block_in[s * chans + ch];
+      frame_send(c_audio, frame, iter_samples, -31);
+    }
+
+    for(int ch = 0; ch < chans; ch++){
+      exponent_t out_exp;
+      frame_receive(c_audio, frame, FRAME_SIZE, &out_exp);
+      assert(out_exp == -31);
+      for(int s = 0; s < iter_samples; s++)
+        block_out[s * chans + ch] = frame[s];
+    }
+
+    write_samples(block_out, iter_samples * chans);
+
+    if((next_sample + iter_samples) % PRINTERVAL == 0){
+      printf("Processed %u samples..\n", next_sample + iter_samples);
+    }
+  }
+
+  *ticks = get_reference_time() - t_start;
+
+  wav_reader_finish(&wav_input);
+  wav_writer_finish(&wav_output);
+}
+
+
+/**
+ * Like wav_io_task(), except that the input wav file may have up to
+ * WAV_IO_MAX_CHANNELS channels. See send_blocks().
+ */
+void wav_io_multichan_task(
+  chanend_t c_audio, 
+  chanend_t c_timing,
+  const char* input_file_name, 
+  const char* output_file_name,
+  const char* perf_file_name)
+{
+  const unsigned sample_count = load_input(input_file_name, output_file_name,
+                                          0);
+
+  uint32_t ticks = 0;
+
+  PAR_JOBS(
+    PJOB(send_blocks, (c_audio, sample_count, &ticks)),
+    PJOB(wav_reader_thread, (&wav_input)),
+    PJOB(wav_writer_thread, (&wav_output))
+  );
+
+  // The reported throughput is per channel. write_performance_info() also
+  // reports it in channel-samples per second.
+  finish(c_timing, output_file_name, perf_file_name, 
+         samples_per_sec(sample_count, ticks));
 }
@@ -9,8 +9,13 @@
 # include <xcore/channel.h>
 # include <xcore/chanend.h>
 # include <xcore/channel_transaction.h>
+# include <xcore/parallel.h>
+# include <xcore/hwtimer.h>
 #endif
 
+// Maximum number of channels in the input wav file of wav_io_multichan_task()
+#define WAV_IO_MAX_CHANNELS   (16)
+
 #ifdef __XC__
 extern "C" {
   void wav_io_task(
@@ -19,6 +24,21 @@ extern "C" {
       const char* input_file_name, 
       const char* output_file_name,
       const char* perf_file_name);
+
+  void wav_io_stream_task(
+      chanend c_audio_in, 
+      chanend c_audio_out, 
+      chanend c_timing,
+      const char* input_file_name, 
+      const char* output_file_name,
+      const char* perf_file_name);
+
+  void wav_io_multichan_task(
+      chanend c_audio, 
+      chanend c_timing,
+      const char* input_file_name, 
+      const char* output_file_name,
+      const char* perf_file_name);
 }
 #else
   void wav_io_task(
@@ -28,4 +48,19 @@ extern "C" {
       const char* output_file_name,
       const char* perf_file_name);
 
+  void wav_io_stream_task(
+      chanend_t c_audio_in, 
+      chanend_t c_audio_out, 
+      chanend_t c_timing,
+      const char* input_file_name, 
+      const char* output_file_name,
+      const char* perf_file_name);
+
+  void wav_io_multichan_task(
+      chanend_t c_audio, 
+      chanend_t c_timing,
+      const char* input_file_name, 
+      const char* output_file_name,
+      const char* perf_file_name);
+
 #endif
\ No newline at end of file
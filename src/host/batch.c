@@ -0,0 +1,686 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <limits.h>
+#include <assert.h>
+#include <time.h>
+#include <dirent.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <xcore/channel.h>
+#include <xcore/parallel.h>
+
+#include "common.h"
+#include "wav_stream.h"
+#include "wav_convert.h"
+#include "batch.h"
+
+DECLARE_JOB(filter_task, (chanend_t));
+
+// Output samples are written to the output file this many frames at a time.
+#define WRITE_FRAMES    (32)
+
+
+// An input file and its results
+typedef struct {
+  char in_path[PATH_MAX];
+  char out_path[PATH_MAX];
+  wav_sample_format_e format;
+  // Samples in the file
+  unsigned sample_count;
+  // The file's chunks are chunk[chunk_first] onwards
+  unsigned chunk_first;
+  unsigned chunk_count;
+  // Why the file wasn't processed (NULL if it was)
+  const char* skipped;
+  // Whether every chunk was processed and the output file is complete
+  unsigned ok;
+} batch_file_t;
+
+
+// A run of whole frames of one file.
+typedef struct {
+  unsigned file;
+  // Output samples [start, end) are written by this chunk
+  unsigned start;
+  unsigned end;
+  // Number of samples before `start` which are processed, but whose output is
+  // discarded
+  unsigned preroll;
+  // Written by the worker which processed the chunk
+  unsigned worker;
+  int status;
+  uint64_t start_ns;
+  uint64_t end_ns;
+} batch_chunk_t;
+
+
+// A worker's queue of chunks, task[head] to task[tail-1]. The worker takes
+// chunks from the head, in file order; idle workers steal from the tail.
+typedef struct {
+  pthread_mutex_t lock;
+  unsigned head;
+  unsigned tail;
+  // Written by the worker: chunks processed, and how many of those were stolen
+  unsigned processed;
+  unsigned stolen;
+} batch_deque_t;
+
+
+// Shared by all of the worker processes
+typedef struct {
+  unsigned worker_count;
+  batch_deque_t deque[BATCH_MAX_WORKERS];
+} batch_sched_t;
+
+
+static batch_file_t* files = NULL;
+static unsigned file_count = 0;
+static unsigned file_cap = 0;
+
+static batch_chunk_t* chunk = NULL;
+static unsigned chunk_count = 0;
+static unsigned* task = NULL;
+static batch_sched_t* sched = NULL;
+
+
+static
+uint64_t now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+// Memory shared with the worker processes, which are forked after it is
+// allocated
+static
+void* shared_alloc(
+    const size_t bytes)
+{
+  void* p = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  assert(p != MAP_FAILED);
+  memset(p, 0, bytes);
+  return p;
+}
+
+
+/**
+ * Process one chunk, read through `reader`, sending its frames to filter_task()
+ * over `c_audio`, and exit the process.
+ *
+ * The chunk's process also runs filter_task(), which never returns, so this
+ * exits rather than returning.
+ */
+DECLARE_JOB(run_chunk, (chanend_t, wav_reader_t*, const batch_file_t*, 
+                        const batch_chunk_t*));
+void run_chunk(
+    chanend_t c_audio,
+    wav_reader_t* reader,
+    const batch_file_t* file,
+    const batch_chunk_t* chk)
+{
+  static int32_t raw_in[FRAME_SIZE];
+  static int32_t raw_out[WRITE_FRAMES * FRAME_SIZE];
+
+  const unsigned bytes = wav_sample_bytes(file->format);
+  const unsigned first = chk->start - chk->preroll;
+
+  wav_reader_skip(reader, first * bytes);
+
+  file_t out;
+  if(file_open(&out, file->out_path, "r+b")) _exit(2);
+  file_seek(&out, WAV_HEADER_BYTES + chk->start * bytes, SEEK_SET);
+
+  unsigned pending = 0;
+  size_t written = 0;
+
+  for(unsigned s = first; s < chk->end; s += FRAME_SIZE){
+    const unsigned n = MIN(FRAME_SIZE, chk->end - s);
+
+    int32_t frame_in[FRAME_SIZE];
+    if(wav_reader_read(reader, raw_in, n * bytes) != n * bytes) _exit(3);
+    wav_samples_to_q31(frame_in, raw_in, n, file->format);
+
+    int32_t frame_out[FRAME_SIZE];
+    exponent_t out_exp;
+    frame_send(c_audio, frame_in, n, -31);
+    frame_receive(c_audio, frame_out, FRAME_SIZE, &out_exp);
+    assert(out_exp == -31);
+
+    if(s < chk->start) continue;
+
+    // pending is a whole number of frames, so this stays word-aligned.
+    wav_samples_from_q31(&((uint8_t*) raw_out)[pending * bytes], frame_out, n,
+                         file->format);
+    pending += n;
+
+    if(pending == WRITE_FRAMES * FRAME_SIZE || s + n == chk->end){
+      written += file_write_all(&out, raw_out, pending * bytes, NULL);
+      pending = 0;
+    }
+  }
+
+  file_close(&out);
+  wav_reader_finish(reader);
+  wav_reader_close(reader);
+
+  _exit((written == (chk->end - chk->start) * bytes)? 0 : 3);
+}
+
+
+// Process a chunk in a new process, so that filter_task() starts from scratch.
+// Returns 0 on success.
+static
+int process_chunk(
+    const batch_chunk_t* chk)
+{
+  const pid_t pid = fork();
+  if(pid < 0) return -1;
+
+  if(pid == 0){
+    // Many chunks are processed at once, so their live metrics would be noise.
+    timer_live_config(0);
+
+    // The reader's background thread needs it open before it starts.
+    static wav_reader_t reader;
+    if(wav_reader_open(&reader, files[chk->file].in_path)) _exit(2);
+
+    channel_t c_audio = chan_alloc();
+    PAR_JOBS(
+      PJOB(run_chunk, (c_audio.end_a, &reader, &files[chk->file], chk)),
+      PJOB(wav_reader_thread, (&reader)),
+      PJOB(filter_task, (c_audio.end_b))
+    );
+    _exit(1);
+  }
+
+  int status;
+  if(waitpid(pid, &status, 0) != pid) return -1;
+  return (WIFEXITED(status) && WEXITSTATUS(status) == 0)? 0 : -1;
+}
+
+
+// Take the next chunk for worker w: from the head of its own queue or, if that
+// is empty, from the tail of the queue with the most chunks left. Returns 0 if
+// there are no chunks left anywhere.
+static
+unsigned take_chunk(
+    const unsigned w,
+    unsigned* chk,
+    unsigned* stolen)
+{
+  batch_deque_t* own = &sched->deque[w];
+  pthread_mutex_lock(&own->lock);
+  if(own->head < own->tail){
+    *chk = task[own->head++];
+    *stolen = 0;
+    pthread_mutex_unlock(&own->lock);
+    return 1;
+  }
+  pthread_mutex_unlock(&own->lock);
+
+  while(1){
+    // The queue lengths are only a hint until the victim is locked.
+    unsigned victim = w;
+    unsigned most = 0;
+    for(int k = 0; k < sched->worker_count; k++){
+      const batch_deque_t* dq = &sched->deque[k];
+      const unsigned left = __atomic_load_n(&dq->tail, __ATOMIC_RELAXED)
+                          - __atomic_load_n(&dq->head, __ATOMIC_RELAXED);
+      if(k != w && (int) left > (int) most){
+        victim = k;
+        most = left;
+      }
+    }
+    if(victim == w) return 0;
+
+    batch_deque_t* dq = &sched->deque[victim];
+    pthread_mutex_lock(&dq->lock);
+    const unsigned got = (dq->head < dq->tail);
+    if(got) *chk = task[--dq->tail];
+    pthread_mutex_unlock(&dq->lock);
+
+    if(got){
+      *stolen = 1;
+      return 1;
+    }
+  }
+}
+
+
+// Worker process main loop
+static
+void worker(
+    const unsigned w)
+{
+  unsigned c, stolen;
+  while(take_chunk(w, &c, &stolen)){
+    batch_chunk_t* chk = &chunk[c];
+    chk->worker = w;
+    chk->start_ns = now_ns();
+    chk->status = process_chunk(chk);
+    chk->end_ns = now_ns();
+
+    sched->deque[w].processed++;
+    sched->deque[w].stolen += stolen;
+  }
+}
+
+
+static
+void add_file(
+    const char* path)
+{
+  if(file_count == file_cap){
+    file_cap = file_cap? 2 * file_cap : 64;
+    files = (batch_file_t*) realloc(files, file_cap * sizeof(batch_file_t));
+    assert(files);
+  }
+  batch_file_t* f = &files[file_count++];
+  memset(f, 0, sizeof(batch_file_t));
+  snprintf(f->in_path, sizeof(f->in_path), "%s", path);
+}
+
+
+static
+int is_wav(
+    const struct dirent* ent)
+{
+  const size_t len = strlen(ent->d_name);
+  return (len > 4) && !strcasecmp(&ent->d_name[len-4], ".wav");
+}
+
+
+// Add a file, or every wav file in a directory (in name order)
+static
+void add_path(
+    const char* path)
+{
+  struct stat st;
+  if(stat(path, &st) != 0 || !S_ISDIR(st.st_mode)){
+    add_file(path);
+    return;
+  }
+
+  struct dirent** list;
+  const int n = scandir(path, &list, is_wav, alphasort);
+  for(int k = 0; k < n; k++){
+    char full[PATH_MAX];
+    snprintf(full, sizeof(full), "%s/%s", path, list[k]->d_name);
+    add_file(full);
+    free(list[k]);
+  }
+  if(n >= 0) free(list);
+}
+
+
+// Add each path listed, one per line, in a text file
+static
+int add_list(
+    const char* list_path)
+{
+  FILE* fp = fopen(list_path, "r");
+  if(!fp) return -1;
+
+  char line[PATH_MAX];
+  while(fgets(line, sizeof(line), fp)){
+    line[strcspn(line, "\r\n")] = '\0';
+    if(line[0]) add_path(line);
+  }
+  fclose(fp);
+  return 0;
+}
+
+
+// Check an input file, and create its output file with the same format and a
+// complete header, so that the chunks can be written at their own offsets.
+static
+void prepare_file(
+    batch_file_t* f,
+    const char* out_dir)
+{
+  static wav_reader_t reader;
+  if(wav_reader_open(&reader, f->in_path)){
+    f->skipped = "cannot be read";
+    return;
+  }
+
+  // The stages all process a single channel.
+  wav_header_t header = reader.header;
+  wav_reader_close(&reader);
+  if(wav_header_check_details(&header, 1, 0, 0)){
+    f->skipped = "not a mono file in a supported format";
+    return;
+  }
+
+  f->format = wav_sample_format(&header);
+  f->sample_count = wav_header_get_sample_count(&header);
+
+  const char* base = strrchr(f->in_path, '/');
+  base = base? base + 1 : f->in_path;
+  snprintf(f->out_path, sizeof(f->out_path), "%s/%s", out_dir, base);
+
+  char in_real[PATH_MAX], out_real[PATH_MAX];
+  if(realpath(f->in_path, in_real) && realpath(f->out_path, out_real)
+      && !strcmp(in_real, out_real)){
+    f->skipped = "output would overwrite it";
+    return;
+  }
+
+  header.data_bytes = f->sample_count * wav_sample_bytes(f->format);
+  header.wav_size = header.data_bytes + WAV_HEADER_BYTES - 8;
+
+  file_t out;
+  if(file_open(&out, f->out_path, "wb")
+      || file_write_all(&out, &header, WAV_HEADER_BYTES, NULL)
+          != WAV_HEADER_BYTES){
+    f->skipped = "output file cannot be created";
+    return;
+  }
+  file_close(&out);
+}
+
+
+// Split each file into chunks, and give each worker an even share of the
+// samples. Files are dealt out largest first, each to the worker with the
+// fewest samples so far, and all of a file's chunks start off in the same
+// queue.
+static
+void plan_chunks(
+    const unsigned chunk_samples,
+    const unsigned preroll,
+    const unsigned worker_count)
+{
+  // Chunks are whole frames, so that each chunk's filter sees the same frames
+  // as it would if the whole file were processed in one go.
+  const unsigned chunk_len = chunk_samples?
+      ((chunk_samples + FRAME_SIZE - 1) / FRAME_SIZE) * FRAME_SIZE : UINT_MAX;
+  const unsigned preroll_len = ((preroll + FRAME_SIZE - 1) / FRAME_SIZE)
+                             * FRAME_SIZE;
+
+  unsigned total = 0;
+  for(int k = 0; k < file_count; k++){
+    batch_file_t* f = &files[k];
+    f->chunk_count = 0;
+    if(f->skipped || f->sample_count == 0) continue;
+    f->chunk_count = 1 + (f->sample_count - 1) / MIN(chunk_len, f->sample_count);
+    total += f->chunk_count;
+  }
+
+  chunk = (batch_chunk_t*) shared_alloc(MAX(total, 1) * sizeof(batch_chunk_t));
+  task = (unsigned*) malloc(MAX(total, 1) * sizeof(unsigned));
+  unsigned* owner = (unsigned*) malloc(MAX(file_count, 1) * sizeof(unsigned));
+  uint64_t* load = (uint64_t*) calloc(worker_count, sizeof(uint64_t));
+  unsigned* count = (unsigned*) calloc(worker_count, sizeof(unsigned));
+  assert(task && owner && load && count);
+
+  chunk_count = 0;
+  for(int k = 0; k < file_count; k++){
+    batch_file_t* f = &files[k];
+    f->chunk_first = chunk_count;
+    for(int i = 0; i < f->chunk_count; i++){
+      batch_chunk_t* chk = &chunk[chunk_count++];
+      chk->file = k;
+      chk->start = i * chunk_len;
+      chk->end = (i == f->chunk_count - 1)? f->sample_count
+                                          : chk->start + chunk_len;
+      chk->preroll = MIN(chk->start, preroll_len);
+      chk->status = -1;
+    }
+  }
+
+  // Largest remaining file to the least loaded worker
+  unsigned* done = (unsigned*) calloc(MAX(file_count, 1), sizeof(unsigned));
+  assert(done);
+  for(int n = 0; n < file_count; n++){
+    int big = -1;
+    for(int k = 0; k < file_count; k++)
+      if(!done[k] && (big < 0 || files[k].sample_count > files[big].sample_count))
+        big = k;
+    done[big] = 1;
+
+    unsigned w = 0;
+    for(int k = 1; k < worker_count; k++)
+      if(load[k] < load[w]) w = k;
+    owner[big] = w;
+    load[w] += files[big].sample_count;
+    count[w] += files[big].chunk_count;
+  }
+
+  unsigned pos = 0;
+  for(int w = 0; w < worker_count; w++){
+    sched->deque[w].head = pos;
+    sched->deque[w].tail = pos;
+    pos += count[w];
+  }
+  for(int k = 0; k < file_count; k++){
+    batch_deque_t* dq = &sched->deque[owner[k]];
+    for(int i = 0; i < files[k].chunk_count; i++)
+      task[dq->tail++] = files[k].chunk_first + i;
+  }
+
+  free(done);
+  free(count);
+  free(load);
+  free(owner);
+}
+
+
+static
+void write_report(
+    const char* report_path,
+    const unsigned worker_count,
+    const uint64_t wall_ns,
+    const uint64_t total_samples,
+    const unsigned chunk_samples)
+{
+  FILE* fp = fopen(report_path, "w");
+  if(!fp){
+    fprintf(stderr, "Cannot write %s\n", report_path);
+    return;
+  }
+
+  fprintf(fp, "{\n\"stage\": \"%s\",\n\"workers\": %u,\n\"chunk_samples\": %u,\n",
+          APP_NAME, worker_count, chunk_samples);
+  fprintf(fp, "\"wall_time\": %0.06f,\n\"samples\": %llu,\n\"throughput\": %0.02f,\n",
+          wall_ns * 1e-9, (unsigned long long) total_samples,
+          wall_ns? (1e9 * total_samples) / wall_ns : 0.0);
+
+  fprintf(fp, "\"worker_chunks\": [");
+  for(int w = 0; w < worker_count; w++)
+    fprintf(fp, "%s%u", w? ", " : "", sched->deque[w].processed);
+  fprintf(fp, "],\n\"worker_steals\": [");
+  for(int w = 0; w < worker_count; w++)
+    fprintf(fp, "%s%u", w? ", " : "", sched->deque[w].stolen);
+  fprintf(fp, "],\n\"files\": [");
+
+  for(int k = 0; k < file_count; k++){
+    const batch_file_t* f = &files[k];
+    fprintf(fp, "%s\n  {\"input\": \"%s\", ", k? "," : "", f->in_path);
+    if(f->skipped){
+      fprintf(fp, "\"skipped\": \"%s\"}", f->skipped);
+      continue;
+    }
+
+    uint64_t busy = 0, first = UINT64_MAX, last = 0;
+    for(int i = 0; i < f->chunk_count; i++){
+      const batch_chunk_t* chk = &chunk[f->chunk_first + i];
+      busy += chk->end_ns - chk->start_ns;
+      first = MIN(first, chk->start_ns);
+      last = MAX(last, chk->end_ns);
+    }
+    fprintf(fp, "\"output\": \"%s\", \"ok\": %s, \"samples\": %u, \"chunks\": %u, "
+                "\"busy_time\": %0.06f, \"elapsed_time\": %0.06f, \"throughput\": %0.02f}",
+            f->out_path, f->ok? "true" : "false", f->sample_count, f->chunk_count,
+            busy * 1e-9, f->chunk_count? (last - first) * 1e-9 : 0.0,
+            busy? (1e9 * f->sample_count) / busy : 0.0);
+  }
+  fprintf(fp, "\n]\n}\n");
+  fclose(fp);
+}
+
+
+static
+void usage(
+    const char* prog)
+{
+  printf("Usage: %s -o <output dir> [options] <wav file or dir>...\n"
+         "Filters mono wav files with %s, several at a time.\n"
+         "  -o DIR    directory for the output files (same names as the inputs)\n"
+         "  -l FILE   also process the files or dirs listed in FILE, one per line\n"
+         "  -j N      number of worker processes (default: one per CPU)\n"
+         "  -c N      samples per chunk, 0 for whole files (default: %u)\n"
+         "  -p N      pre-roll samples before each chunk (default: %u)\n"
+         "  -r FILE   write a json report to FILE\n",
+         prog, APP_NAME, BATCH_CHUNK_SAMPLES, 2 * HISTORY_SIZE);
+}
+
+
+int batch_main(
+    int argc,
+    char* argv[])
+{
+  const char* out_dir = NULL;
+  const char* report_path = NULL;
+  unsigned worker_count = sysconf(_SC_NPROCESSORS_ONLN);
+  unsigned chunk_samples = BATCH_CHUNK_SAMPLES;
+  // Enough for the filter history to be filled twice over
+  unsigned preroll = 2 * HISTORY_SIZE;
+
+  int opt;
+  while((opt = getopt(argc, argv, "o:l:j:c:p:r:h")) != -1){
+    switch(opt){
+      case 'o': out_dir = optarg; break;
+      case 'l':
+        if(add_list(optarg)){
+          fprintf(stderr, "Cannot read %s\n", optarg);
+          return 2;
+        }
+        break;
+      case 'j': worker_count = strtoul(optarg, NULL, 0); break;
+      case 'c': chunk_samples = strtoul(optarg, NULL, 0); break;
+      case 'p': preroll = strtoul(optarg, NULL, 0); break;
+      case 'r': report_path = optarg; break;
+      case 'h': usage(argv[0]); return 0;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  for(int k = optind; k < argc; k++)
+    add_path(argv[k]);
+
+  if(!out_dir || file_count == 0){
+    usage(argv[0]);
+    return 2;
+  }
+  worker_count = MIN(MAX(worker_count, 1), BATCH_MAX_WORKERS);
+
+  for(int k = 0; k < file_count; k++)
+    prepare_file(&files[k], out_dir);
+
+  sched = (batch_sched_t*) shared_alloc(sizeof(batch_sched_t));
+  sched->worker_count = worker_count;
+  for(int w = 0; w < worker_count; w++){
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init(&sched->deque[w].lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+  }
+
+  plan_chunks(chunk_samples, preroll, worker_count);
+
+  printf("Running batch: %s, %u files, %u chunks, %u workers\n",
+         APP_NAME, file_count, chunk_count, worker_count);
+  fflush(stdout);
+
+  const uint64_t t_start = now_ns();
+
+  pid_t pid[BATCH_MAX_WORKERS];
+  for(int w = 0; w < worker_count; w++){
+    pid[w] = fork();
+    assert(pid[w] >= 0);
+    if(pid[w] == 0){
+      worker(w);
+      _exit(0);
+    }
+  }
+  for(int w = 0; w < worker_count; w++)
+    waitpid(pid[w], NULL, 0);
+
+  const uint64_t wall_ns = now_ns() - t_start;
+
+  // Per-file results
+  uint64_t total_samples = 0;
+  unsigned failed = 0;
+
+  printf("%-40s %10s %7s %10s %10s %14s\n", "File", "Samples", "Chunks",
+         "Busy(s)", "Span(s)", "Samples/s");
+  for(int k = 0; k < file_count; k++){
+    batch_file_t* f = &files[k];
+    const char* base = strrchr(f->in_path, '/');
+    base = base? base + 1 : f->in_path;
+
+    if(f->skipped){
+      printf("%-40s skipped: %s\n", base, f->skipped);
+      failed++;
+      continue;
+    }
+
+    uint64_t busy = 0, first = UINT64_MAX, last = 0;
+    f->ok = 1;
+    for(int i = 0; i < f->chunk_count; i++){
+      const batch_chunk_t* chk = &chunk[f->chunk_first + i];
+      f->ok = f->ok && (chk->status == 0);
+      busy += chk->end_ns - chk->start_ns;
+      first = MIN(first, chk->start_ns);
+      last = MAX(last, chk->end_ns);
+    }
+
+    // Check the output file is the expected size.
+    file_t out;
+    if(file_open(&out, f->out_path, "rb") == 0){
+      const unsigned expected = WAV_HEADER_BYTES
+                              + f->sample_count * wav_sample_bytes(f->format);
+      f->ok = f->ok && (get_file_size(&out) == expected);
+      file_close(&out);
+    } else {
+      f->ok = 0;
+    }
+
+    if(!f->ok) failed++;
+    total_samples += f->sample_count;
+
+    printf("%-40s %10u %7u %10.03f %10.03f %14.0f%s\n", base, f->sample_count,
+           f->chunk_count, busy * 1e-9, f->chunk_count? (last - first) * 1e-9 : 0.0,
+           busy? (1e9 * f->sample_count) / busy : 0.0,
+           f->ok? "" : "  FAILED");
+  }
+
+  unsigned steals = 0;
+  for(int w = 0; w < worker_count; w++)
+    steals += sched->deque[w].stolen;
+
+  printf("Total: %llu samples in %0.03f s: %0.0f samples/s (%u chunks stolen)\n",
+         (unsigned long long) total_samples, wall_ns * 1e-9,
+         wall_ns? (1e9 * total_samples) / wall_ns : 0.0, steals);
+  if(failed)
+    printf("%u of %u files failed.\n", failed, file_count);
+
+  if(report_path)
+    write_report(report_path, worker_count, wall_ns, total_samples,
+                 chunk_samples);
+
+  return failed? 1 : 0;
+}
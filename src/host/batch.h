@@ -0,0 +1,30 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+// Host builds only. Offline batch processing of many wav files with one stage.
+//
+// Each file is split into chunks of whole frames, and the chunks are processed
+// concurrently by a pool of worker processes which balance the load between
+// them by work stealing. Every chunk is processed by a fresh instance of the
+// stage's filter_task(), which first sees a pre-roll of the audio before the
+// chunk, so that its filter history is already full when the chunk starts.
+
+// Default number of samples per chunk
+#ifndef BATCH_CHUNK_SAMPLES
+# define BATCH_CHUNK_SAMPLES    (1 << 18)
+#endif
+
+// Largest number of worker processes
+#define BATCH_MAX_WORKERS       (256)
+
+/**
+ * Entry point of a stage's executable when it is given command line arguments
+ * (see main.c). Returns the process's exit status.
+ *
+ * Usage: <stage> -o <output dir> [options] <wav file or dir>...
+ */
+int batch_main(
+    int argc,
+    char* argv[]);
@@ -0,0 +1,41 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+
+// Host builds only. Front end for batch processing (see batch.h) which takes the
+// stage as its first argument, and runs that stage's executable, which is
+// expected to be installed alongside this one.
+//
+// Usage: batch <stage> -o <output dir> [options] <wav file or dir>...
+//    e.g. batch part3B -o out/batch -j 8 wav/captures
+
+int main(int argc, char* argv[])
+{
+  if(argc < 2 || strchr(argv[1], '/')){
+    printf("Usage: %s <stage> -o <output dir> [options] <wav file or dir>...\n"
+           "Run '%s <stage>' for the options.\n", argv[0], argv[0]);
+    return 2;
+  }
+
+  // The stage's executable is in the same directory as this one.
+  char stage_path[PATH_MAX];
+  const char* slash = strrchr(argv[0], '/');
+  const int dir_len = slash? (int) (slash - argv[0]) + 1 : 0;
+  snprintf(stage_path, sizeof(stage_path), "%.*s%s", dir_len, argv[0], 
+           argv[1]);
+
+  // Without any arguments the stage would process its usual input file instead,
+  // so ask it for its options.
+  char help[] = "-h";
+  char* help_args[] = {stage_path, help, NULL};
+
+  argv[1] = stage_path;
+  execv(stage_path, (argc == 2)? help_args : &argv[1]);
+
+  perror(stage_path);
+  return 2;
+}
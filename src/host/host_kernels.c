@@ -0,0 +1,171 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_kernels_impl.h"
+
+// Only the declarations are wanted here; the redirections would replace the
+// lib_xcore_math calls which the kernels are checked against.
+#include "host_kernels.h"
+#undef vect_s32_dot
+#undef vect_f32_dot
+
+#if defined(__x86_64__) || defined(__i386__)
+# define HK_X86   (1)
+#else
+# define HK_X86   (0)
+#endif
+
+// Number of random vectors each kernel set is checked against lib_xcore_math
+// with before it is used.
+#define SELF_TEST_VECTORS   (200)
+
+
+#if HK_X86
+
+static
+int64_t s32_dot_sse4(
+    const int32_t b[],
+    const int32_t c[],
+    const unsigned length,
+    const right_shift_t b_shr,
+    const right_shift_t c_shr)
+{
+  unsigned fallback = 0;
+  const int64_t res = hk_s32_dot_sse4(b, c, length, b_shr, c_shr, &fallback);
+  return fallback? vect_s32_dot(b, c, length, b_shr, c_shr) : res;
+}
+
+static
+int64_t s32_dot_avx2(
+    const int32_t b[],
+    const int32_t c[],
+    const unsigned length,
+    const right_shift_t b_shr,
+    const right_shift_t c_shr)
+{
+  unsigned fallback = 0;
+  const int64_t res = hk_s32_dot_avx2(b, c, length, b_shr, c_shr, &fallback);
+  return fallback? vect_s32_dot(b, c, length, b_shr, c_shr) : res;
+}
+
+const host_kernels_t host_kernels_sse4 = {
+  "sse4", s32_dot_sse4, hk_f32_dot_sse4, hk_fft_butterflies_sse4 };
+
+const host_kernels_t host_kernels_avx2 = {
+  "avx2", s32_dot_avx2, hk_f32_dot_avx2, hk_fft_butterflies_avx2 };
+
+#else
+
+const host_kernels_t host_kernels_sse4 = { "sse4", NULL, NULL, NULL };
+const host_kernels_t host_kernels_avx2 = { "avx2", NULL, NULL, NULL };
+
+#endif // HK_X86
+
+
+const host_kernels_t host_kernels_scalar = {
+  "scalar", vect_s32_dot, vect_f32_dot, hk_fft_butterflies_scalar };
+
+host_kernels_t host_kernels = {
+  "scalar", vect_s32_dot, vect_f32_dot, hk_fft_butterflies_scalar };
+
+
+void hk_fft_butterflies_scalar(
+    complex_float_t x[],
+    const unsigned b,
+    const unsigned a,
+    const complex_float_t w[4],
+    const unsigned conjugate)
+{
+  for(int j = 0; j < a; j++){
+    for(int i = 0; i < 4; i++){
+      const complex_float_t vD = x[b+i];
+      const complex_float_t tmp = x[i];
+      const float w_im = conjugate? -w[i].im : w[i].im;
+      const complex_float_t vR = {
+        vD.re * w[i].re - vD.im * w_im,
+        vD.re * w_im + vD.im * w[i].re };
+      x[i].re = tmp.re + vR.re;
+      x[i].im = tmp.im + vR.im;
+      x[b+i].re = tmp.re - vR.re;
+      x[b+i].im = tmp.im - vR.im;
+    }
+    x = &x[2*b];
+  }
+}
+
+
+// Check a kernel set's s32_dot against lib_xcore_math. The vectors have
+// varying amounts of headroom, and some of the shifts are left shifts which
+// saturate, so the fallback path is checked too.
+static
+unsigned self_test(
+    const host_kernels_t* kernels)
+{
+  static int32_t b[300];
+  static int32_t c[300];
+
+  srand(0x4B45524E);
+
+  for(int v = 0; v < SELF_TEST_VECTORS; v++){
+    const unsigned length = 1 + (rand() % 300);
+    const unsigned b_hr = rand() % 8;
+    const unsigned c_hr = rand() % 8;
+    for(int k = 0; k < length; k++){
+      b[k] = ((int32_t) (((uint32_t) rand() << 16) ^ rand())) >> b_hr;
+      c[k] = ((int32_t) (((uint32_t) rand() << 16) ^ rand())) >> c_hr;
+    }
+    const right_shift_t b_shr = (rand() % 12) - 2;
+    const right_shift_t c_shr = (rand() % 12) - 2;
+
+    if(kernels->s32_dot(b, c, length, b_shr, c_shr) 
+        != vect_s32_dot(b, c, length, b_shr, c_shr))
+      return 1;
+  }
+  return 0;
+}
+
+
+static
+unsigned cpu_supports(
+    const host_kernels_t* kernels)
+{
+  if(kernels->s32_dot == NULL) return 0;
+#if HK_X86
+  if(kernels == &host_kernels_avx2) return __builtin_cpu_supports("avx2");
+  if(kernels == &host_kernels_sse4) return __builtin_cpu_supports("sse4.2");
+#endif
+  return 1;
+}
+
+
+// Choose the kernel set before main() runs.
+__attribute__((constructor))
+static
+void host_kernels_select(void)
+{
+  const host_kernels_t* candidates[] = {
+    &host_kernels_avx2, &host_kernels_sse4, &host_kernels_scalar };
+  const char* requested = getenv("HOST_KERNELS");
+
+  for(int k = 0; k < sizeof(candidates)/sizeof(candidates[0]); k++){
+    const host_kernels_t* kernels = candidates[k];
+
+    if(requested && strcmp(requested, kernels->name) 
+        && kernels != &host_kernels_scalar)
+      continue;
+    if(!cpu_supports(kernels))
+      continue;
+    if(kernels != &host_kernels_scalar && self_test(kernels)){
+      fprintf(stderr, "host_kernels: '%s' kernels don't match lib_xcore_math."
+                      " Not using them.\n", kernels->name);
+      continue;
+    }
+
+    host_kernels = *kernels;
+    return;
+  }
+}
@@ -0,0 +1,61 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+// Host builds only. Hot lib_xcore_math operations with SIMD implementations for
+// the host CPU.
+//
+// The kernel set is chosen when the program starts, according to what the CPU
+// supports (or the HOST_KERNELS environment variable: "scalar", "sse4" or
+// "avx2"). The fixed-point kernels give bit-exactly the same results as
+// lib_xcore_math; a kernel set which fails a check against lib_xcore_math at
+// startup is not used.
+
+#include <stdint.h>
+
+#include "xmath/xmath.h"
+
+typedef struct {
+  // Name of the kernel set, e.g. "avx2"
+  const char* name;
+
+  // Same as vect_s32_dot()
+  int64_t (*s32_dot)(
+      const int32_t b[],
+      const int32_t c[],
+      const unsigned length,
+      const right_shift_t b_shr,
+      const right_shift_t c_shr);
+
+  // Same as vect_f32_dot() (up to rounding, as the sums are reordered)
+  float (*f32_dot)(
+      const float b[],
+      const float c[],
+      const unsigned length);
+
+  // The `a` radix-2 butterflies between x[j*2*b + i] and x[j*2*b + b + i], for
+  // i in [0, 4), with twiddle factors w[i] (conjugated if `conjugate` is
+  // non-zero). This is the inner loop of flt_fft_forward_float() and
+  // flt_fft_inverse_float().
+  void (*fft_butterflies)(
+      complex_float_t x[],
+      const unsigned b,
+      const unsigned a,
+      const complex_float_t w[4],
+      const unsigned conjugate);
+} host_kernels_t;
+
+// The selected kernel set
+extern host_kernels_t host_kernels;
+
+// Kernel sets. Those the CPU doesn't support have NULL function pointers.
+extern const host_kernels_t host_kernels_scalar;
+extern const host_kernels_t host_kernels_sse4;
+extern const host_kernels_t host_kernels_avx2;
+
+// Calls to these operations use the selected kernels instead.
+#define vect_s32_dot(B, C, LENGTH, B_SHR, C_SHR) \
+    host_kernels.s32_dot(B, C, LENGTH, B_SHR, C_SHR)
+#define vect_f32_dot(B, C, LENGTH) \
+    host_kernels.f32_dot(B, C, LENGTH)
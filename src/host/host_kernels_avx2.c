@@ -0,0 +1,182 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#include "host_kernels_impl.h"
+
+// These functions are only called if the CPU supports AVX2 (see
+// host_kernels.c), so the rest of the program needn't be built for it.
+#define HK_AVX2   __attribute__((target("avx2")))
+
+
+// Shift 8 elements as VLASHR does. Lanes where a left shift saturated are set
+// in `*sat_mask`.
+HK_AVX2
+static inline
+__m256i vlashr_avx2(
+    const __m256i x,
+    const right_shift_t shr,
+    __m256i* sat_mask)
+{
+  if(shr >= 0)
+    return _mm256_sra_epi32(x, _mm_cvtsi32_si128(shr));
+
+  // The shift saturated wherever shifting back doesn't give the original.
+  const __m128i shl = _mm_cvtsi32_si128(-shr);
+  const __m256i y = _mm256_sll_epi32(x, shl);
+  const __m256i back = _mm256_sra_epi32(y, shl);
+  *sat_mask = _mm256_or_si256(*sat_mask, 
+                  _mm256_xor_si256(_mm256_cmpeq_epi32(back, x), 
+                                   _mm256_set1_epi32(-1)));
+  return y;
+}
+
+
+// Shift 4 signed 64-bit products right 30 bits with rounding. AVX2 has no
+// 64-bit arithmetic right shift, so the sign bit is flipped to make the values
+// unsigned, shifted logically, and the offset removed again.
+HK_AVX2
+static inline
+__m256i round_shr30_avx2(
+    const __m256i p)
+{
+  const __m256i bias = _mm256_set1_epi64x((int64_t) ((UINT64_C(1) << 63) 
+                                                   + (UINT64_C(1) << 29)));
+  const __m256i unbias = _mm256_set1_epi64x(INT64_C(1) << 33);
+  return _mm256_sub_epi64(_mm256_srli_epi64(_mm256_add_epi64(p, bias), 30), 
+                          unbias);
+}
+
+
+HK_AVX2
+static inline
+__m256i abs_epi64_avx2(
+    const __m256i x)
+{
+  const __m256i neg = _mm256_cmpgt_epi64(_mm256_setzero_si256(), x);
+  return _mm256_sub_epi64(_mm256_xor_si256(x, neg), neg);
+}
+
+
+HK_AVX2
+int64_t hk_s32_dot_avx2(
+    const int32_t b[],
+    const int32_t c[],
+    const unsigned length,
+    const right_shift_t b_shr,
+    const right_shift_t c_shr,
+    unsigned* fallback)
+{
+  __m256i acc = _mm256_setzero_si256();
+  __m256i mag = _mm256_setzero_si256();
+  __m256i sat = _mm256_setzero_si256();
+
+  unsigned k = 0;
+  for(; k + 8 <= length; k += 8){
+    const __m256i B = vlashr_avx2(_mm256_loadu_si256((const __m256i*) &b[k]), 
+                                  b_shr, &sat);
+    const __m256i C = vlashr_avx2(_mm256_loadu_si256((const __m256i*) &c[k]), 
+                                  c_shr, &sat);
+
+    // _mm256_mul_epi32() multiplies the even elements, so the odd ones are
+    // moved down for a second multiply.
+    const __m256i p_even = round_shr30_avx2(_mm256_mul_epi32(B, C));
+    const __m256i p_odd = round_shr30_avx2(_mm256_mul_epi32(
+        _mm256_srli_epi64(B, 32), _mm256_srli_epi64(C, 32)));
+
+    acc = _mm256_add_epi64(acc, _mm256_add_epi64(p_even, p_odd));
+    mag = _mm256_add_epi64(mag, _mm256_add_epi64(abs_epi64_avx2(p_even), 
+                                                 abs_epi64_avx2(p_odd)));
+  }
+
+  int64_t lanes[4];
+  _mm256_storeu_si256((__m256i*) lanes, acc);
+  int64_t total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  _mm256_storeu_si256((__m256i*) lanes, mag);
+  int64_t total_mag = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+  unsigned saturated = !_mm256_testz_si256(sat, sat);
+  for(; k < length; k++){
+    const int64_t term = hk_s32_dot_term(b[k], c[k], b_shr, c_shr, &saturated);
+    total += term;
+    total_mag += (term < 0)? -term : term;
+  }
+
+  // Without saturation anywhere, the order of the additions doesn't matter.
+  *fallback = saturated || (total_mag > HK_ACC_LIMIT);
+  return total;
+}
+
+
+HK_AVX2
+float hk_f32_dot_avx2(
+    const float b[],
+    const float c[],
+    const unsigned length)
+{
+  __m256 acc = _mm256_setzero_ps();
+
+  unsigned k = 0;
+  for(; k + 8 <= length; k += 8)
+    acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(&b[k]), 
+                                           _mm256_loadu_ps(&c[k])));
+
+  float lanes[8];
+  _mm256_storeu_ps(lanes, acc);
+  float total = 0.0f;
+  for(int i = 0; i < 8; i++)
+    total += lanes[i];
+
+  for(; k < length; k++)
+    total += b[k] * c[k];
+  return total;
+}
+
+
+// Complex multiply of 4 interleaved complex values. The products are formed
+// and combined just as in hk_fft_butterflies_scalar(), so the results are the
+// same.
+HK_AVX2
+static inline
+__m256 complex_mul_avx2(
+    const __m256 x,
+    const __m256 w)
+{
+  const __m256 w_re = _mm256_moveldup_ps(w);
+  const __m256 w_im = _mm256_movehdup_ps(w);
+  const __m256 x_swap = _mm256_permute_ps(x, 0xB1);
+  // {x.re*w.re - x.im*w.im, x.im*w.re + x.re*w.im}
+  return _mm256_addsub_ps(_mm256_mul_ps(x, w_re), _mm256_mul_ps(x_swap, w_im));
+}
+
+
+HK_AVX2
+void hk_fft_butterflies_avx2(
+    complex_float_t x[],
+    const unsigned b,
+    const unsigned a,
+    const complex_float_t w[4],
+    const unsigned conjugate)
+{
+  __m256 W = _mm256_loadu_ps((const float*) &w[0]);
+  if(conjugate)
+    W = _mm256_xor_ps(W, _mm256_setr_ps(0.0f, -0.0f, 0.0f, -0.0f, 
+                                        0.0f, -0.0f, 0.0f, -0.0f));
+
+  for(int j = 0; j < a; j++){
+    float* top = (float*) &x[0];
+    float* bottom = (float*) &x[b];
+
+    const __m256 tmp = _mm256_loadu_ps(top);
+    const __m256 vR = complex_mul_avx2(_mm256_loadu_ps(bottom), W);
+    _mm256_storeu_ps(top, _mm256_add_ps(tmp, vR));
+    _mm256_storeu_ps(bottom, _mm256_sub_ps(tmp, vR));
+
+    x = &x[2*b];
+  }
+}
+
+#endif // defined(__x86_64__) || defined(__i386__)
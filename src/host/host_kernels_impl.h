@@ -0,0 +1,64 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+// Shared by the kernel implementations. Not to be included elsewhere, as it
+// needs the real lib_xcore_math declarations rather than host_kernels.h's
+// redirections.
+
+#include <stdint.h>
+
+#include "xmath/xmath.h"
+
+// A 40-bit accumulator can't saturate if the sum of the magnitudes of
+// everything added to it stays below this.
+#define HK_ACC_LIMIT    ((INT64_C(1) << 39) - 1)
+
+/**
+ * One term of vect_s32_dot(): both elements are shifted as the VPU's VLASHR
+ * does (arithmetic right shift, or left shift for a negative shift), and their
+ * product is shifted right 30 bits with rounding, as VLMACC does.
+ * 
+ * `*saturated` is set if a left shift saturates. The saturated value isn't
+ * modelled; callers hand such vectors to lib_xcore_math instead.
+ */
+static inline
+int64_t hk_s32_dot_term(
+    const int32_t b,
+    const int32_t c,
+    const right_shift_t b_shr,
+    const right_shift_t c_shr,
+    unsigned* saturated)
+{
+  int64_t B = b, C = c;
+
+  if(b_shr >= 0) B = b >> ((b_shr > 31)? 31 : b_shr);
+  else           B = (int64_t) b * (INT64_C(1) << ((-b_shr > 32)? 32 : -b_shr));
+  if(c_shr >= 0) C = c >> ((c_shr > 31)? 31 : c_shr);
+  else           C = (int64_t) c * (INT64_C(1) << ((-c_shr > 32)? 32 : -c_shr));
+
+  if(B != (int32_t) B || C != (int32_t) C)
+    *saturated = 1;
+
+  return ((B * C) + (1 << 29)) >> 30;
+}
+
+// The xmath-style kernels for each instruction set. `*fallback` is set if the
+// result couldn't be computed exactly and the reference must be used instead.
+int64_t hk_s32_dot_sse4(const int32_t b[], const int32_t c[], 
+    const unsigned length, const right_shift_t b_shr, const right_shift_t c_shr,
+    unsigned* fallback);
+int64_t hk_s32_dot_avx2(const int32_t b[], const int32_t c[], 
+    const unsigned length, const right_shift_t b_shr, const right_shift_t c_shr,
+    unsigned* fallback);
+
+float hk_f32_dot_sse4(const float b[], const float c[], const unsigned length);
+float hk_f32_dot_avx2(const float b[], const float c[], const unsigned length);
+
+void hk_fft_butterflies_scalar(complex_float_t x[], const unsigned b, 
+    const unsigned a, const complex_float_t w[4], const unsigned conjugate);
+void hk_fft_butterflies_sse4(complex_float_t x[], const unsigned b, 
+    const unsigned a, const complex_float_t w[4], const unsigned conjugate);
+void hk_fft_butterflies_avx2(complex_float_t x[], const unsigned b, 
+    const unsigned a, const complex_float_t w[4], const unsigned conjugate);
@@ -0,0 +1,169 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#include "host_kernels_impl.h"
+
+// These functions are only called if the CPU supports SSE4.2 (see
+// host_kernels.c), so the rest of the program needn't be built for it.
+#define HK_SSE4   __attribute__((target("sse4.2")))
+
+// See host_kernels_avx2.c, which these mirror 4 lanes at a time.
+
+HK_SSE4
+static inline
+__m128i vlashr_sse4(
+    const __m128i x,
+    const right_shift_t shr,
+    __m128i* sat_mask)
+{
+  if(shr >= 0)
+    return _mm_sra_epi32(x, _mm_cvtsi32_si128(shr));
+
+  const __m128i shl = _mm_cvtsi32_si128(-shr);
+  const __m128i y = _mm_sll_epi32(x, shl);
+  const __m128i back = _mm_sra_epi32(y, shl);
+  *sat_mask = _mm_or_si128(*sat_mask, 
+                  _mm_xor_si128(_mm_cmpeq_epi32(back, x), _mm_set1_epi32(-1)));
+  return y;
+}
+
+
+HK_SSE4
+static inline
+__m128i round_shr30_sse4(
+    const __m128i p)
+{
+  const __m128i bias = _mm_set1_epi64x((int64_t) ((UINT64_C(1) << 63) 
+                                                + (UINT64_C(1) << 29)));
+  const __m128i unbias = _mm_set1_epi64x(INT64_C(1) << 33);
+  return _mm_sub_epi64(_mm_srli_epi64(_mm_add_epi64(p, bias), 30), unbias);
+}
+
+
+HK_SSE4
+static inline
+__m128i abs_epi64_sse4(
+    const __m128i x)
+{
+  const __m128i neg = _mm_cmpgt_epi64(_mm_setzero_si128(), x);
+  return _mm_sub_epi64(_mm_xor_si128(x, neg), neg);
+}
+
+
+HK_SSE4
+int64_t hk_s32_dot_sse4(
+    const int32_t b[],
+    const int32_t c[],
+    const unsigned length,
+    const right_shift_t b_shr,
+    const right_shift_t c_shr,
+    unsigned* fallback)
+{
+  __m128i acc = _mm_setzero_si128();
+  __m128i mag = _mm_setzero_si128();
+  __m128i sat = _mm_setzero_si128();
+
+  unsigned k = 0;
+  for(; k + 4 <= length; k += 4){
+    const __m128i B = vlashr_sse4(_mm_loadu_si128((const __m128i*) &b[k]), 
+                                  b_shr, &sat);
+    const __m128i C = vlashr_sse4(_mm_loadu_si128((const __m128i*) &c[k]), 
+                                  c_shr, &sat);
+
+    const __m128i p_even = round_shr30_sse4(_mm_mul_epi32(B, C));
+    const __m128i p_odd = round_shr30_sse4(_mm_mul_epi32(
+        _mm_srli_epi64(B, 32), _mm_srli_epi64(C, 32)));
+
+    acc = _mm_add_epi64(acc, _mm_add_epi64(p_even, p_odd));
+    mag = _mm_add_epi64(mag, _mm_add_epi64(abs_epi64_sse4(p_even), 
+                                           abs_epi64_sse4(p_odd)));
+  }
+
+  int64_t lanes[2];
+  _mm_storeu_si128((__m128i*) lanes, acc);
+  int64_t total = lanes[0] + lanes[1];
+  _mm_storeu_si128((__m128i*) lanes, mag);
+  int64_t total_mag = lanes[0] + lanes[1];
+
+  unsigned saturated = !_mm_testz_si128(sat, sat);
+  for(; k < length; k++){
+    const int64_t term = hk_s32_dot_term(b[k], c[k], b_shr, c_shr, &saturated);
+    total += term;
+    total_mag += (term < 0)? -term : term;
+  }
+
+  *fallback = saturated || (total_mag > HK_ACC_LIMIT);
+  return total;
+}
+
+
+HK_SSE4
+float hk_f32_dot_sse4(
+    const float b[],
+    const float c[],
+    const unsigned length)
+{
+  __m128 acc = _mm_setzero_ps();
+
+  unsigned k = 0;
+  for(; k + 4 <= length; k += 4)
+    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(&b[k]), _mm_loadu_ps(&c[k])));
+
+  float lanes[4];
+  _mm_storeu_ps(lanes, acc);
+  float total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+  for(; k < length; k++)
+    total += b[k] * c[k];
+  return total;
+}
+
+
+HK_SSE4
+static inline
+__m128 complex_mul_sse4(
+    const __m128 x,
+    const __m128 w)
+{
+  const __m128 w_re = _mm_moveldup_ps(w);
+  const __m128 w_im = _mm_movehdup_ps(w);
+  const __m128 x_swap = _mm_shuffle_ps(x, x, 0xB1);
+  return _mm_addsub_ps(_mm_mul_ps(x, w_re), _mm_mul_ps(x_swap, w_im));
+}
+
+
+HK_SSE4
+void hk_fft_butterflies_sse4(
+    complex_float_t x[],
+    const unsigned b,
+    const unsigned a,
+    const complex_float_t w[4],
+    const unsigned conjugate)
+{
+  const __m128 conj = conjugate? _mm_setr_ps(0.0f, -0.0f, 0.0f, -0.0f)
+                               : _mm_setzero_ps();
+  const __m128 W0 = _mm_xor_ps(_mm_loadu_ps((const float*) &w[0]), conj);
+  const __m128 W1 = _mm_xor_ps(_mm_loadu_ps((const float*) &w[2]), conj);
+
+  for(int j = 0; j < a; j++){
+    float* top = (float*) &x[0];
+    float* bottom = (float*) &x[b];
+
+    const __m128 tmp0 = _mm_loadu_ps(&top[0]);
+    const __m128 tmp1 = _mm_loadu_ps(&top[4]);
+    const __m128 vR0 = complex_mul_sse4(_mm_loadu_ps(&bottom[0]), W0);
+    const __m128 vR1 = complex_mul_sse4(_mm_loadu_ps(&bottom[4]), W1);
+    _mm_storeu_ps(&top[0], _mm_add_ps(tmp0, vR0));
+    _mm_storeu_ps(&top[4], _mm_add_ps(tmp1, vR1));
+    _mm_storeu_ps(&bottom[0], _mm_sub_ps(tmp0, vR0));
+    _mm_storeu_ps(&bottom[4], _mm_sub_ps(tmp1, vR1));
+
+    x = &x[2*b];
+  }
+}
+
+#endif // defined(__x86_64__) || defined(__i386__)
@@ -0,0 +1,6 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+// Host shim. Nothing in platform.h is used by the C sources.
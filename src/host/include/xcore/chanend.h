@@ -0,0 +1,13 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+// Host shim for lib_xcore's chanend.h. See xcore_shim.c.
+
+#include <stdint.h>
+
+typedef uint32_t resource_t;
+
+// On the host a chanend is one end of a local socket pair.
+typedef resource_t chanend_t;
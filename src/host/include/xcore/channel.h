@@ -0,0 +1,78 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+// Host shim for lib_xcore's channel.h. See xcore_shim.c.
+//
+// Unlike an xcore channel, a host channel is buffered, so an output doesn't
+// wait for the matching input. Nothing in this application relies on that.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "xcore/chanend.h"
+
+typedef struct {
+  chanend_t end_a;
+  chanend_t end_b;
+} channel_t;
+
+channel_t chan_alloc(void);
+void chan_free(channel_t c);
+
+// Send or receive `bytes` bytes. Every other input and output is built on these.
+void xcore_shim_chan_out(chanend_t c, const void* buf, size_t bytes);
+void xcore_shim_chan_in(chanend_t c, void* buf, size_t bytes);
+
+static inline
+void chan_out_word(chanend_t c, uint32_t data)
+{
+  xcore_shim_chan_out(c, &data, sizeof(data));
+}
+
+static inline
+uint32_t chan_in_word(chanend_t c)
+{
+  uint32_t data;
+  xcore_shim_chan_in(c, &data, sizeof(data));
+  return data;
+}
+
+static inline
+void chan_out_byte(chanend_t c, uint8_t data)
+{
+  xcore_shim_chan_out(c, &data, sizeof(data));
+}
+
+static inline
+uint8_t chan_in_byte(chanend_t c)
+{
+  uint8_t data;
+  xcore_shim_chan_in(c, &data, sizeof(data));
+  return data;
+}
+
+static inline
+void chan_out_buf_word(chanend_t c, const uint32_t buf[], size_t n)
+{
+  xcore_shim_chan_out(c, buf, n * sizeof(uint32_t));
+}
+
+static inline
+void chan_in_buf_word(chanend_t c, uint32_t buf[], size_t n)
+{
+  xcore_shim_chan_in(c, buf, n * sizeof(uint32_t));
+}
+
+static inline
+void chan_out_buf_byte(chanend_t c, const uint8_t buf[], size_t n)
+{
+  xcore_shim_chan_out(c, buf, n);
+}
+
+static inline
+void chan_in_buf_byte(chanend_t c, uint8_t buf[], size_t n)
+{
+  xcore_shim_chan_in(c, buf, n);
+}
@@ -0,0 +1,47 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+// Host shim for lib_xcore's channel_streaming.h. Host channels are always
+// buffered, so a streaming channel is just a channel.
+
+#include "xcore/channel.h"
+
+typedef channel_t streaming_channel_t;
+
+static inline
+streaming_channel_t s_chan_alloc(void)
+{
+  return chan_alloc();
+}
+
+static inline
+void s_chan_free(streaming_channel_t c)
+{
+  chan_free(c);
+}
+
+static inline
+void s_chan_out_word(chanend_t c, uint32_t data)
+{
+  chan_out_word(c, data);
+}
+
+static inline
+uint32_t s_chan_in_word(chanend_t c)
+{
+  return chan_in_word(c);
+}
+
+static inline
+void s_chan_out_buf_word(chanend_t c, const uint32_t buf[], size_t n)
+{
+  chan_out_buf_word(c, buf, n);
+}
+
+static inline
+void s_chan_in_buf_word(chanend_t c, uint32_t buf[], size_t n)
+{
+  chan_in_buf_word(c, buf, n);
+}
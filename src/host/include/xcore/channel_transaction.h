@@ -0,0 +1,70 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+// Host shim for lib_xcore's channel_transaction.h. A transaction only saves
+// synchronisation on the xcore, so on the host it is an ordinary sequence of
+// inputs or outputs.
+
+#include "xcore/channel.h"
+
+typedef struct {
+  chanend_t c;
+} transacting_chanend_t;
+
+static inline
+transacting_chanend_t chan_init_transaction_master(chanend_t c)
+{
+  transacting_chanend_t tc = {c};
+  return tc;
+}
+
+static inline
+transacting_chanend_t chan_init_transaction_slave(chanend_t c)
+{
+  transacting_chanend_t tc = {c};
+  return tc;
+}
+
+static inline
+chanend_t chan_complete_transaction(transacting_chanend_t tc)
+{
+  return tc.c;
+}
+
+static inline
+void t_chan_out_word(transacting_chanend_t* tc, uint32_t data)
+{
+  chan_out_word(tc->c, data);
+}
+
+static inline
+uint32_t t_chan_in_word(transacting_chanend_t* tc)
+{
+  return chan_in_word(tc->c);
+}
+
+static inline
+void t_chan_out_byte(transacting_chanend_t* tc, uint8_t data)
+{
+  chan_out_byte(tc->c, data);
+}
+
+static inline
+uint8_t t_chan_in_byte(transacting_chanend_t* tc)
+{
+  return chan_in_byte(tc->c);
+}
+
+static inline
+void t_chan_out_buf_word(transacting_chanend_t* tc, const uint32_t buf[], size_t n)
+{
+  chan_out_buf_word(tc->c, buf, n);
+}
+
+static inline
+void t_chan_in_buf_word(transacting_chanend_t* tc, uint32_t buf[], size_t n)
+{
+  chan_in_buf_word(tc->c, buf, n);
+}
@@ -0,0 +1,22 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+// Host shim for lib_xcore's hwtimer.h.
+
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * Get the time in ticks of a 100 MHz clock, like the xcore's reference clock,
+ * so that tick counts can be converted to time the same way on both. The host
+ * time comes from the monotonic clock.
+ */
+static inline
+uint32_t get_reference_time(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t) (((uint64_t) ts.tv_sec * 100000000u) + (ts.tv_nsec / 10));
+}
@@ -0,0 +1,77 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+// Host shim for lib_xcore's parallel.h. Each job of a PAR_JOBS() runs on its own
+// pthread (the first on the calling thread), and PAR_JOBS() returns once they
+// have all returned, as on the xcore.
+//
+// DECLARE_JOB() declares the job function, a struct to hold its arguments, and a
+// thunk which unpacks them. Jobs may take up to 8 arguments.
+
+#include <stddef.h>
+
+typedef struct {
+  void* (*thunk)(void*);
+  void* args;
+} xcore_shim_job_t;
+
+void xcore_shim_par_jobs(
+    const xcore_shim_job_t jobs[],
+    const unsigned count);
+
+#define XCORE_SHIM_CAT_(A, B)   A##B
+#define XCORE_SHIM_CAT(A, B)    XCORE_SHIM_CAT_(A, B)
+#define XCORE_SHIM_UNPAREN(...) __VA_ARGS__
+
+#define XCORE_SHIM_NARGS(...) \
+    XCORE_SHIM_NARGS_(__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define XCORE_SHIM_NARGS_(_1, _2, _3, _4, _5, _6, _7, _8, N, ...) N
+
+#define XCORE_SHIM_FIELDS_1(A)      A a0;
+#define XCORE_SHIM_FIELDS_2(A, ...) A a1; XCORE_SHIM_FIELDS_1(__VA_ARGS__)
+#define XCORE_SHIM_FIELDS_3(A, ...) A a2; XCORE_SHIM_FIELDS_2(__VA_ARGS__)
+#define XCORE_SHIM_FIELDS_4(A, ...) A a3; XCORE_SHIM_FIELDS_3(__VA_ARGS__)
+#define XCORE_SHIM_FIELDS_5(A, ...) A a4; XCORE_SHIM_FIELDS_4(__VA_ARGS__)
+#define XCORE_SHIM_FIELDS_6(A, ...) A a5; XCORE_SHIM_FIELDS_5(__VA_ARGS__)
+#define XCORE_SHIM_FIELDS_7(A, ...) A a6; XCORE_SHIM_FIELDS_6(__VA_ARGS__)
+#define XCORE_SHIM_FIELDS_8(A, ...) A a7; XCORE_SHIM_FIELDS_7(__VA_ARGS__)
+
+#define XCORE_SHIM_CALL_1(P)  P->a0
+#define XCORE_SHIM_CALL_2(P)  P->a1, XCORE_SHIM_CALL_1(P)
+#define XCORE_SHIM_CALL_3(P)  P->a2, XCORE_SHIM_CALL_2(P)
+#define XCORE_SHIM_CALL_4(P)  P->a3, XCORE_SHIM_CALL_3(P)
+#define XCORE_SHIM_CALL_5(P)  P->a4, XCORE_SHIM_CALL_4(P)
+#define XCORE_SHIM_CALL_6(P)  P->a5, XCORE_SHIM_CALL_5(P)
+#define XCORE_SHIM_CALL_7(P)  P->a6, XCORE_SHIM_CALL_6(P)
+#define XCORE_SHIM_CALL_8(P)  P->a7, XCORE_SHIM_CALL_7(P)
+
+#define XCORE_SHIM_FIELDS(...) \
+    XCORE_SHIM_CAT(XCORE_SHIM_FIELDS_, XCORE_SHIM_NARGS(__VA_ARGS__))(__VA_ARGS__)
+#define XCORE_SHIM_CALL(P, ...) \
+    XCORE_SHIM_CAT(XCORE_SHIM_CALL_, XCORE_SHIM_NARGS(__VA_ARGS__))(P)
+
+#define DECLARE_JOB(NAME, ARG_TYPES)                                          \
+  void NAME ARG_TYPES;                                                        \
+  typedef struct {                                                            \
+    XCORE_SHIM_FIELDS ARG_TYPES                                               \
+  } xcore_shim_args_##NAME;                                                   \
+  static inline                                                               \
+  void* xcore_shim_thunk_##NAME(void* p_)                                     \
+  {                                                                           \
+    xcore_shim_args_##NAME* p = (xcore_shim_args_##NAME*) p_;                 \
+    NAME(XCORE_SHIM_CALL(p, XCORE_SHIM_UNPAREN ARG_TYPES));                   \
+    return NULL;                                                              \
+  }
+
+#define PJOB(NAME, ARGS)                                                      \
+  { xcore_shim_thunk_##NAME,                                                  \
+    &(xcore_shim_args_##NAME){ XCORE_SHIM_UNPAREN ARGS } }
+
+#define PAR_JOBS(...)                                                         \
+  do {                                                                        \
+    const xcore_shim_job_t xcore_shim_jobs_[] = { __VA_ARGS__ };              \
+    xcore_shim_par_jobs(xcore_shim_jobs_,                                     \
+        sizeof(xcore_shim_jobs_) / sizeof(xcore_shim_jobs_[0]));              \
+  } while(0)
@@ -0,0 +1,17 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+// Host shim for lib_xcore's thread.h.
+
+// Largest number of threads of a tile which may run at once
+#define XCORE_SHIM_MAX_THREADS  (8)
+
+/**
+ * Get the calling thread's id within its tile, from 0 to 7. As on the xcore,
+ * no two threads of a tile which are running at the same time have the same
+ * id, but a thread started once another has finished may reuse its id. A
+ * tile's first thread is thread 0.
+ */
+unsigned get_logical_core_id(void);
@@ -0,0 +1,69 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <xcore/channel.h>
+#include <xcore/parallel.h>
+
+#include "wav_io.h"
+#include "timing.h"
+#include "batch.h"
+
+// Host replacement for main.xc.
+//
+// Each tile is a separate process, so that, as on the xcore, the tiles share no
+// memory and only communicate over channels. Each of a tile's threads is a
+// pthread.
+//
+// Given any command line arguments, the application instead processes a batch
+// of wav files (see batch.h).
+
+DECLARE_JOB(timer_report_task, (chanend_t));
+DECLARE_JOB(filter_task, (chanend_t));
+
+//// +main
+int main(int argc, char* argv[]){
+  if(argc > 1)
+    return batch_main(argc, argv);
+
+  // Channel used for communicating audio data between tile[0] and tile[1].
+  channel_t c_audio_data = chan_alloc();
+  // Channel used for reporting timing info from tile[1] after the signal has
+  // been processed.
+  channel_t c_timing = chan_alloc();
+
+  fflush(stdout);
+  const pid_t tile1 = fork();
+  assert(tile1 >= 0);
+
+  // Two threads on tile[1].
+  if(tile1 == 0){
+    PAR_JOBS(
+      PJOB(timer_report_task, (c_timing.end_b)),
+      PJOB(filter_task, (c_audio_data.end_b))
+    );
+    return 0;
+  }
+
+  // One thread (plus any it starts) on tile[0]
+  printf("Running Application: %s (host)\n", APP_NAME);
+
+  wav_io_task(c_audio_data.end_a, 
+              c_timing.end_a, 
+              INPUT_WAV,    // These three macros are defined per-target
+              OUTPUT_WAV,   // in the CMake project.
+              OUTPUT_JSON);
+
+  // Once wav_io_task() returns we are done. filter_task() never returns, so
+  // tile[1] has to be stopped.
+  kill(tile1, SIGTERM);
+  waitpid(tile1, NULL, 0);
+  return 0;
+}
+//// -main
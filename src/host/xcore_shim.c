@@ -0,0 +1,165 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "xcore/channel.h"
+#include "xcore/parallel.h"
+#include "xcore/thread.h"
+
+// Host implementation of the parts of lib_xcore used by the application.
+//
+// A channel is a pair of connected local stream sockets. Sockets (rather than a
+// queue in memory) are used so that a channel allocated before the tiles are
+// split into separate processes (see main.c) still connects them.
+
+// Largest number of jobs in one PAR_JOBS()
+#define MAX_JOBS    (16)
+
+
+channel_t chan_alloc(void)
+{
+  int fds[2];
+  const int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+  assert(ret == 0);
+  (void) ret;
+
+  channel_t c = {(chanend_t) fds[0], (chanend_t) fds[1]};
+  return c;
+}
+
+
+void chan_free(channel_t c)
+{
+  close((int) c.end_a);
+  close((int) c.end_b);
+}
+
+
+void xcore_shim_chan_out(
+    chanend_t c,
+    const void* buf,
+    size_t bytes)
+{
+  const uint8_t* p = (const uint8_t*) buf;
+  while(bytes){
+    const ssize_t n = write((int) c, p, bytes);
+    if(n < 0 && errno == EINTR) continue;
+    if(n <= 0){
+      perror("chan_out");
+      exit(1);
+    }
+    p += n;
+    bytes -= n;
+  }
+}
+
+
+void xcore_shim_chan_in(
+    chanend_t c,
+    void* buf,
+    size_t bytes)
+{
+  uint8_t* p = (uint8_t*) buf;
+  while(bytes){
+    const ssize_t n = read((int) c, p, bytes);
+    if(n < 0 && errno == EINTR) continue;
+    // The other end has gone away, which only happens when the application is
+    // shutting down, so this thread has nothing left to do.
+    if(n == 0) pthread_exit(NULL);
+    if(n < 0){
+      perror("chan_in");
+      exit(1);
+    }
+    p += n;
+    bytes -= n;
+  }
+}
+
+
+// Thread ids of the tile's running threads (see get_logical_core_id()). Each
+// tile is a separate process, so each has its own. The tile's first thread is
+// thread 0, which is never released.
+static pthread_mutex_t thread_id_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned thread_ids_used = 1;
+static __thread unsigned thread_id = 0;
+
+
+static
+unsigned thread_id_alloc(void)
+{
+  pthread_mutex_lock(&thread_id_lock);
+  unsigned id = 0;
+  while(id < XCORE_SHIM_MAX_THREADS && (thread_ids_used & (1u << id)))
+    id++;
+  // Like the xcore, a tile can't run any more threads than this.
+  assert(id < XCORE_SHIM_MAX_THREADS);
+  thread_ids_used |= (1u << id);
+  pthread_mutex_unlock(&thread_id_lock);
+  return id;
+}
+
+
+static
+void thread_id_free(
+    const unsigned id)
+{
+  pthread_mutex_lock(&thread_id_lock);
+  thread_ids_used &= ~(1u << id);
+  pthread_mutex_unlock(&thread_id_lock);
+}
+
+
+unsigned get_logical_core_id(void)
+{
+  return thread_id;
+}
+
+
+// A job to be run on a new thread, and the id of that thread
+typedef struct {
+  xcore_shim_job_t job;
+  unsigned id;
+} thread_start_t;
+
+
+static
+void* thread_start(
+    void* arg)
+{
+  const thread_start_t* start = (const thread_start_t*) arg;
+  thread_id = start->id;
+  return start->job.thunk(start->job.args);
+}
+
+
+void xcore_shim_par_jobs(
+    const xcore_shim_job_t jobs[],
+    const unsigned count)
+{
+  pthread_t threads[MAX_JOBS];
+  thread_start_t starts[MAX_JOBS];
+  assert(count <= MAX_JOBS);
+
+  for(int k = 1; k < count; k++){
+    starts[k].job = jobs[k];
+    starts[k].id = thread_id_alloc();
+    const int ret = pthread_create(&threads[k], NULL, thread_start, 
+                                   &starts[k]);
+    assert(ret == 0);
+    (void) ret;
+  }
+
+  jobs[0].thunk(jobs[0].args);
+
+  for(int k = 1; k < count; k++){
+    pthread_join(threads[k], NULL);
+    thread_id_free(starts[k].id);
+  }
+}
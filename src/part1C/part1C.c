@@ -17,20 +17,27 @@ void rx_frame(
     float buff[],
     const chanend_t c_audio)
 {    
-  // The exponent associated with the input samples
-  const exponent_t input_exp = -31;
+  timer_start(TIMING_PHASE_RX);
+
+  // Receive a whole frame of PCM samples, along with the exponent associated
+  // with them
+  int32_t frame_in[FRAME_SIZE];
+  exponent_t input_exp;
+  frame_receive(c_audio, frame_in, FRAME_SIZE, &input_exp);
 
   for(int k = 0; k < FRAME_SIZE; k++){
-    // Read PCM sample from channel
-    const int32_t sample_in = (int32_t) chan_in_word(c_audio);
+    // Get PCM sample from the received frame
+    const int32_t sample_in = frame_in[k];
     // Convert PCM sample to floating-point
     const float samp_f = ldexpf(sample_in, input_exp);
-    // Place at beginning of history buffer in reverse order (to match the
+    // Place in the history's next frame slot in reverse order (to match the
     // order of filter coefficients).
     buff[FRAME_SIZE-k-1] = samp_f;
   }
 
   timer_start(TIMING_FRAME);
+
+  timer_stop(TIMING_PHASE_RX);
 }
 //// -rx_frame
 
@@ -46,6 +53,9 @@ void tx_frame(
   const exponent_t output_exp = -31;
 
   timer_stop(TIMING_FRAME);
+  timer_start(TIMING_PHASE_TX);
+
+  q1_31 frame_out[FRAME_SIZE];
 
   // Send FRAME_SIZE new output samples at the end of each frame.
   for(int k = 0; k < FRAME_SIZE; k++){
@@ -53,9 +63,13 @@ void tx_frame(
     const float samp_f = buff[k];
     // Convert float sample back to PCM using the output exponent.
     const q1_31 sample_out = roundf(ldexpf(samp_f, -output_exp));
-    // Put PCM sample in output channel
-    chan_out_word(c_audio, sample_out);
+    // Put PCM sample in output frame
+    frame_out[k] = sample_out;
   }
+
+  // Send the whole frame at once
+  frame_send(c_audio, frame_out, FRAME_SIZE, output_exp);
+  timer_stop(TIMING_PHASE_TX);
 }
 //// -tx_frame
 
@@ -84,7 +98,11 @@ void filter_task(
     chanend_t c_audio)
 {
   // History of received input samples, stored in reverse-chronological order
-  float sample_history[HISTORY_SIZE] = {0};
+  // in a mirrored ring buffer, so no samples need to be moved each frame.
+  static float history_buff[HISTORY_BUFFER_LENGTH(HISTORY_SIZE)];
+  history_t sample_history;
+  history_init(&sample_history, &history_buff[0], HISTORY_SIZE, FRAME_SIZE,
+               sizeof(float));
 
   // Buffer used to hold output samples
   float frame_output[FRAME_SIZE] = {0};
@@ -92,21 +110,27 @@ void filter_task(
   // Loop forever
   while(1) {
 
-    // Read in a new frame
-    rx_frame(&sample_history[0], 
+    // Read in a new frame. It is placed in reverse order in the history's
+    // next frame slot.
+    rx_frame((float*) history_next_frame(&sample_history), 
              c_audio);
 
+    // Add the new frame to the history
+    timer_start(TIMING_HISTORY);
+    history_commit_frame(&sample_history);
+    timer_stop(TIMING_HISTORY);
+
+    // The newest HISTORY_SIZE samples, newest first
+    const float* history = (const float*) history_window(&sample_history);
+
     // Compute FRAME_SIZE output samples
+    timer_start(TIMING_PHASE_COMPUTE);
     for(int s = 0; s < FRAME_SIZE; s++){
       timer_start(TIMING_SAMPLE);
-      frame_output[s] = filter_sample(&sample_history[FRAME_SIZE-s-1]);
+      frame_output[s] = filter_sample(&history[FRAME_SIZE-s-1]);
       timer_stop(TIMING_SAMPLE);
     }
-
-    // Make room for new samples at the front of the vector
-    memmove(&sample_history[FRAME_SIZE], 
-            &sample_history[0], 
-            TAP_COUNT * sizeof(float));
+    timer_stop(TIMING_PHASE_COMPUTE);
 
     // Send out the processed frame
     tx_frame(c_audio, 
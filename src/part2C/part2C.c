@@ -17,10 +17,17 @@ void rx_frame(
     q1_31 buff[],
     const chanend_t c_audio)
 {    
+  timer_start(TIMING_PHASE_RX);
+
+  q1_31 frame_in[FRAME_SIZE];
+  frame_receive(c_audio, frame_in, FRAME_SIZE, NULL);
+
   for(int k = 0; k < FRAME_SIZE; k++)
-    buff[FRAME_SIZE-k-1] = (q1_31) chan_in_word(c_audio);
+    buff[FRAME_SIZE-k-1] = frame_in[k];
 
   timer_start(TIMING_FRAME);
+
+  timer_stop(TIMING_PHASE_RX);
 }
 //// -rx_frame
 
@@ -33,9 +40,10 @@ void tx_frame(
     const q1_31 buff[])
 {    
   timer_stop(TIMING_FRAME);
-  
-  for(int k = 0; k < FRAME_SIZE; k++)
-    chan_out_word(c_audio, buff[k]);
+  timer_start(TIMING_PHASE_TX);
+
+  frame_send(c_audio, buff, FRAME_SIZE, -31);
+  timer_stop(TIMING_PHASE_TX);
 }
 //// -tx_frame
 
@@ -82,30 +90,39 @@ q1_31 filter_sample(
 void filter_task(
     chanend_t c_audio)
 {
-  // Buffer used for storing input sample history
-  q1_31 sample_history[HISTORY_SIZE] = {0};
+  // History of received input samples, stored in reverse-chronological order
+  // in a mirrored ring buffer, so no samples need to be moved each frame.
+  static q1_31 history_buff[HISTORY_BUFFER_LENGTH(HISTORY_SIZE)];
+  history_t sample_history;
+  history_init(&sample_history, &history_buff[0], HISTORY_SIZE, FRAME_SIZE,
+               sizeof(q1_31));
 
   // Buffer used to hold output samples
   q1_31 frame_output[FRAME_SIZE] = {0};
 
   // Loop forever
   while(1) {
-    // Read in a new frame. It is placed in reverse order at the beginning of
-    // sample_history[]
-    rx_frame(&sample_history[0], 
+    // Read in a new frame. It is placed in reverse order in the history's
+    // next frame slot.
+    rx_frame((q1_31*) history_next_frame(&sample_history), 
              c_audio);
 
+    // Add the new frame to the history
+    timer_start(TIMING_HISTORY);
+    history_commit_frame(&sample_history);
+    timer_stop(TIMING_HISTORY);
+
+    // The newest HISTORY_SIZE samples, newest first
+    const q1_31* history = (const q1_31*) history_window(&sample_history);
+
     // Compute FRAME_SIZE output samples
+    timer_start(TIMING_PHASE_COMPUTE);
     for(int s = 0; s < FRAME_SIZE; s++){
       timer_start(TIMING_SAMPLE);
-      frame_output[s] = filter_sample(&sample_history[FRAME_SIZE-s-1]);
+      frame_output[s] = filter_sample(&history[FRAME_SIZE-s-1]);
       timer_stop(TIMING_SAMPLE);
     }
-
-    // Make room for new samples at the front of the vector
-    memmove(&sample_history[FRAME_SIZE], 
-            &sample_history[0], 
-            TAP_COUNT * sizeof(int32_t));
+    timer_stop(TIMING_PHASE_COMPUTE);
 
     // Send out the processed frame
     tx_frame(c_audio, 
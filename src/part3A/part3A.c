@@ -40,18 +40,18 @@ void rx_frame(
     headroom_t* frame_in_hr,
     const chanend_t c_audio)
 {
-  // We happen to know a priori that samples coming in will have a fixed 
-  // exponent of input_exp, and there's no reason to change it, so we'll just
-  // use that.
-  *frame_in_exp = -31;
+  timer_start(TIMING_PHASE_RX);
 
-  for(int k = 0; k < FRAME_SIZE; k++)
-    frame_in[k] = chan_in_word(c_audio);
+  // The exponent of the incoming samples is sent along with them, so there's
+  // no need to assume one.
+  frame_receive(c_audio, frame_in, FRAME_SIZE, frame_in_exp);
 
   timer_start(TIMING_FRAME);
   
   // Make sure the headroom is correct
   *frame_in_hr = calc_headroom(frame_in, FRAME_SIZE);
+
+  timer_stop(TIMING_PHASE_RX);
 }
 //// -rx_frame
 
@@ -60,7 +60,7 @@ void rx_frame(
 // Accept a frame of new audio data and merge it into sample_history
 static inline 
 void rx_and_merge_frame(
-    int32_t sample_history[HISTORY_SIZE],
+    history_t* sample_history,
     exponent_t* sample_history_exp,
     headroom_t* sample_history_hr,
     const chanend_t c_audio)
@@ -78,6 +78,7 @@ void rx_and_merge_frame(
            &frame_in.hr, 
            c_audio);
 
+  timer_start(TIMING_PHASE_RESCALE);
   // Rescale BFP vectors if needed so they can be merged
   const exponent_t min_frame_in_exp = frame_in.exp - frame_in.hr;
   const exponent_t min_history_exp = *sample_history_exp - *sample_history_hr;
@@ -86,9 +87,11 @@ void rx_and_merge_frame(
   const right_shift_t hist_shr = new_exp - *sample_history_exp;
   const right_shift_t frame_in_shr = new_exp - frame_in.exp;
 
+  // Both copies of every sample in the ring buffer must be rescaled.
   if(hist_shr) {
-    for(int k = FRAME_SIZE; k < HISTORY_SIZE; k++)
-      sample_history[k] = ashr32(sample_history[k], hist_shr);
+    int32_t* history_buff = (int32_t*) sample_history->data;
+    for(int k = 0; k < history_buffer_length(sample_history); k++)
+      history_buff[k] = ashr32(history_buff[k], hist_shr);
     *sample_history_exp = new_exp;
   }
 
@@ -97,12 +100,20 @@ void rx_and_merge_frame(
       frame_in.data[k] = ashr32(frame_in.data[k], frame_in_shr);
   }
   
+  timer_stop(TIMING_PHASE_RESCALE);
+
   // Now we can merge the new frame in (reversing order)
+  int32_t* next_frame = (int32_t*) history_next_frame(sample_history);
   for(int k = 0; k < FRAME_SIZE; k++)
-    sample_history[FRAME_SIZE-k-1] = frame_in.data[k];
+    next_frame[FRAME_SIZE-k-1] = frame_in.data[k];
+
+  timer_start(TIMING_HISTORY);
+  history_commit_frame(sample_history);
+  timer_stop(TIMING_HISTORY);
 
   // And just ensure the headroom is correct
-  *sample_history_hr = calc_headroom(sample_history, HISTORY_SIZE);
+  *sample_history_hr = calc_headroom(
+      (int32_t*) history_window(sample_history), HISTORY_SIZE);
 }
 //// -rx_and_merge_frame
 
@@ -126,12 +137,17 @@ void tx_frame(
   const right_shift_t samp_shr = output_exp - frame_out_exp;  
 
   timer_stop(TIMING_FRAME);
+  timer_start(TIMING_PHASE_TX);
 
+  int32_t samples[FRAME_SIZE];
   for(int k = 0; k < frame_size; k++){
     int32_t sample = frame_out[k];
     sample = ashr32(sample, samp_shr);
-    chan_out_word(c_audio, sample);
+    samples[k] = sample;
   }
+
+  frame_send(c_audio, samples, frame_size, output_exp);
+  timer_stop(TIMING_PHASE_TX);
 }
 //// -tx_frame
 
@@ -209,13 +225,19 @@ void filter_task(
     chanend_t c_audio)
 {
 
+  // Storage for the sample history's mirrored ring buffer
+  static int32_t history_buff[HISTORY_BUFFER_LENGTH(HISTORY_SIZE)];
+
   // Represents the sample history as a BFP vector
   struct {
-    int32_t data[HISTORY_SIZE]; // Sample data
+    history_t data;             // Sample data
     exponent_t exp;             // Exponent
     headroom_t hr;              // Headroom
   } sample_history = {{0},-200,0};
 
+  history_init(&sample_history.data, &history_buff[0], HISTORY_SIZE, 
+               FRAME_SIZE, sizeof(int32_t));
+
   // Represents output frame as a BFP vector
   struct {
     int32_t data[FRAME_SIZE];   // Sample data
@@ -227,23 +249,20 @@ void filter_task(
   while(1) {
 
     // Read in a new frame
-    rx_and_merge_frame(&sample_history.data[0], 
+    rx_and_merge_frame(&sample_history.data, 
                        &sample_history.exp,
                        &sample_history.hr, 
                        c_audio);
 
     // Calc output frame
+    timer_start(TIMING_PHASE_COMPUTE);
     filter_frame(&frame_output.data[0], 
                  &frame_output.exp, 
                  &frame_output.hr,
-                 &sample_history.data[0], 
+                 (int32_t*) history_window(&sample_history.data), 
                  sample_history.exp, 
                  sample_history.hr);
-
-    // Make room for new samples at the front of the vector.
-    memmove(&sample_history.data[FRAME_SIZE], 
-            &sample_history.data[0], 
-            TAP_COUNT * sizeof(int32_t));
+    timer_stop(TIMING_PHASE_COMPUTE);
 
     // Send out the processed frame
     tx_frame(c_audio, 
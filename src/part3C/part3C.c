@@ -27,27 +27,31 @@ void rx_frame(
     bfp_s32_t* frame_in,
     const chanend_t c_audio)
 {
-  // We happen to know a priori that samples coming in will have a fixed 
-  // exponent of input_exp, and there's no reason to change it, so we'll just
-  // use that.
-  frame_in->exp = -31;
+  timer_start(TIMING_PHASE_RX);
 
-  for(int k = 0; k < FRAME_SIZE; k++)
-    frame_in->data[k] = chan_in_word(c_audio);
+  // The exponent of the incoming samples is sent along with them, so there's
+  // no need to assume one.
+  frame_receive(c_audio, frame_in->data, FRAME_SIZE, &frame_in->exp);
 
   timer_start(TIMING_FRAME);
   
   // Make sure the headroom is correct
   calc_headroom(frame_in);
+
+  timer_stop(TIMING_PHASE_RX);
 }
 //// -rx_frame
 
 
 //// +rx_and_merge_frame
 // Accept a frame of new audio data and merge it into sample history
+//
+// sample_history is a BFP vector spanning the whole of history_ring's buffer,
+// so that rescaling it rescales both copies of every sample.
 static inline 
 void rx_and_merge_frame(
     bfp_s32_t* sample_history,
+    history_t* history_ring,
     const chanend_t c_audio)
 {    
   // BFP vector into which new frame will be placed.
@@ -58,6 +62,7 @@ void rx_and_merge_frame(
   // Accept a new input frame
   rx_frame(&frame_in, c_audio);
 
+  timer_start(TIMING_PHASE_RESCALE);
   // Rescale BFP vectors if needed so they can be merged
   const exponent_t min_frame_in_exp = frame_in.exp - frame_in.hr;
   const exponent_t min_history_exp = sample_history->exp - sample_history->hr;
@@ -66,9 +71,16 @@ void rx_and_merge_frame(
   bfp_s32_use_exponent(sample_history, new_exp);
   bfp_s32_use_exponent(&frame_in, new_exp);
   
+  timer_stop(TIMING_PHASE_RESCALE);
+
   // Now we can merge the new frame in (reversing order)
+  int32_t* next_frame = (int32_t*) history_next_frame(history_ring);
   for(int k = 0; k < FRAME_SIZE; k++)
-    sample_history->data[FRAME_SIZE-1-k] = frame_in.data[k];
+    next_frame[FRAME_SIZE-1-k] = frame_in.data[k];
+
+  timer_start(TIMING_HISTORY);
+  history_commit_frame(history_ring);
+  timer_stop(TIMING_HISTORY);
 
   // And just ensure the headroom is correct
   calc_headroom(sample_history);
@@ -91,11 +103,11 @@ void tx_frame(
   bfp_s32_use_exponent(frame_out, output_exp);
 
   timer_stop(TIMING_FRAME);
+  timer_start(TIMING_PHASE_TX);
 
   // And send the samples
-  for(int k = 0; k < FRAME_SIZE; k++)
-    chan_out_word(c_audio, frame_out->data[k]);
-  
+  frame_send(c_audio, frame_out->data, FRAME_SIZE, frame_out->exp);
+  timer_stop(TIMING_PHASE_TX);
 }
 //// -tx_frame
 
@@ -171,11 +183,16 @@ void filter_task(
   bfp_s32_init(&bfp_filter_coef, (int32_t*) &filter_coef[0], 
                coef_exp, TAP_COUNT, 1);
 
-  // Represents the sample history as a BFP vector
-  int32_t sample_history_buff[HISTORY_SIZE] = {0};
+  // The sample history is kept in a mirrored ring buffer. It is represented as
+  // a BFP vector spanning the entire buffer, so that rescaling applies to both
+  // copies of each sample.
+  static int32_t sample_history_buff[HISTORY_BUFFER_LENGTH(HISTORY_SIZE)];
+  history_t history_ring;
+  history_init(&history_ring, &sample_history_buff[0], HISTORY_SIZE,
+               FRAME_SIZE, sizeof(int32_t));
   bfp_s32_t sample_history;
   bfp_s32_init(&sample_history, &sample_history_buff[0], -200, 
-               HISTORY_SIZE, 0);
+               HISTORY_BUFFER_LENGTH(HISTORY_SIZE), 0);
 
   // Represents output frame as a BFP vector
   int32_t frame_output_buff[FRAME_SIZE] = {0};
@@ -188,16 +205,21 @@ void filter_task(
 
     // Read in a new frame
     rx_and_merge_frame(&sample_history, 
+                       &history_ring,
                        c_audio);
 
+    // BFP view of the newest HISTORY_SIZE samples
+    bfp_s32_t history_window_bfp;
+    bfp_s32_init(&history_window_bfp, 
+                 (int32_t*) history_window(&history_ring),
+                 sample_history.exp, HISTORY_SIZE, 0);
+    history_window_bfp.hr = sample_history.hr;
+
     // Calc output frame
+    timer_start(TIMING_PHASE_COMPUTE);
     filter_frame(&frame_output, 
-                 &sample_history);
-
-    // Make room for new samples at the front of the vector.
-    memmove(&sample_history.data[FRAME_SIZE], 
-            &sample_history.data[0], 
-            TAP_COUNT * sizeof(int32_t));
+                 &history_window_bfp);
+    timer_stop(TIMING_PHASE_COMPUTE);
 
     // Send out the processed frame
     tx_frame(c_audio,
@@ -0,0 +1,83 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+// C equivalent of part4A.xc, used for host builds (which have no XC compiler).
+// Each XC `par` becomes a PAR_JOBS() with one job per output sample.
+
+#include <xcore/parallel.h>
+
+#include "common.h"
+
+// The number of threads that will be used to compute the result. There is one
+// PJOB() per thread below.
+#define THREADS     4
+
+// Represents the filter coefficients as a BFP vector
+extern struct {
+  int32_t* data;
+  exponent_t exp;
+  headroom_t hr; 
+} filter_bfp; 
+
+// Apply the filter to produce a single output sample.
+// Defined in part4A.c
+int64_t filter_sample(
+    const int32_t sample_history[TAP_COUNT],
+    const right_shift_t b_shr,
+    const right_shift_t c_shr);
+
+
+// Compute one output sample. This is the body of the XC `par`.
+DECLARE_JOB(filter_output, 
+    (int32_t*, const int32_t*, right_shift_t, right_shift_t, right_shift_t));
+void filter_output(
+    int32_t* sample_out,
+    const int32_t* sample_history,
+    const right_shift_t b_shr,
+    const right_shift_t c_shr,
+    const right_shift_t s_shr)
+{
+  *sample_out = sat32(ashr64(filter_sample(sample_history, b_shr, c_shr), 
+                             s_shr));
+}
+
+
+// Calculate entire output frame
+void filter_frame(
+    int32_t frame_out[FRAME_SIZE],
+    exponent_t* frame_out_exp,
+    headroom_t* frame_out_hr,
+    const int32_t history_in[HISTORY_SIZE],
+    const exponent_t history_in_exp,
+    const headroom_t history_in_hr)
+{
+  // First, determine output exponent and required shifts.
+  right_shift_t b_shr, c_shr;
+  vect_s32_dot_prepare(frame_out_exp, &b_shr, &c_shr, 
+                       history_in_exp, filter_bfp.exp,
+                       history_in_hr, filter_bfp.hr, 
+                       TAP_COUNT);
+  // vect_s32_dot_prepare() ensures the result doesn't overflow the 40-bit VPU
+  // accumulators, but we need it in a 32-bit value.
+  right_shift_t s_shr = 8;
+  *frame_out_exp += s_shr;
+
+  // Compute FRAME_SIZE output samples.
+  for(int s = 0; s < FRAME_SIZE; s+=THREADS){
+    timer_start(TIMING_SAMPLE);
+    PAR_JOBS(
+      PJOB(filter_output, (&frame_out[s+0], &history_in[FRAME_SIZE-(s+0)-1],
+                           b_shr, c_shr, s_shr)),
+      PJOB(filter_output, (&frame_out[s+1], &history_in[FRAME_SIZE-(s+1)-1],
+                           b_shr, c_shr, s_shr)),
+      PJOB(filter_output, (&frame_out[s+2], &history_in[FRAME_SIZE-(s+2)-1],
+                           b_shr, c_shr, s_shr)),
+      PJOB(filter_output, (&frame_out[s+3], &history_in[FRAME_SIZE-(s+3)-1],
+                           b_shr, c_shr, s_shr))
+    );
+    timer_stop(TIMING_SAMPLE);
+  }
+
+  //Finally, calculate the headroom of the output frame.
+  *frame_out_hr = vect_s32_headroom(frame_out, FRAME_SIZE);
+}
@@ -17,10 +17,13 @@ void rx_frame(
     int32_t buff[],
     const chanend_t c_audio)
 {    
-  for(int k = 0; k < FRAME_SIZE; k++)
-    buff[k] = (q1_31) chan_in_word(c_audio);
+  timer_start(TIMING_PHASE_RX);
+
+  frame_receive(c_audio, buff, FRAME_SIZE, NULL);
 
   timer_start(TIMING_FRAME);
+
+  timer_stop(TIMING_PHASE_RX);
 }
 //// -rx_frame
 
@@ -33,9 +36,10 @@ void tx_frame(
     const int32_t buff[])
 {    
   timer_stop(TIMING_FRAME);
+  timer_start(TIMING_PHASE_TX);
 
-  for(int k = 0; k < FRAME_SIZE; k++)
-    chan_out_word(c_audio, buff[k]);
+  frame_send(c_audio, buff, FRAME_SIZE, -31);
+  timer_stop(TIMING_PHASE_TX);
 }
 //// -tx_frame
 
@@ -68,6 +72,7 @@ void filter_task(
              c_audio);
     
     // Compute FRAME_SIZE output samples.
+    timer_start(TIMING_PHASE_COMPUTE);
     for(int s = 0; s < FRAME_SIZE; s++){
       timer_start(TIMING_SAMPLE);
       // userFilter() is the generated function to add a new input sample and get
@@ -75,6 +80,7 @@ void filter_task(
       sample_buffer[s] = userFilter(sample_buffer[s]);
       timer_stop(TIMING_SAMPLE);
     }
+    timer_stop(TIMING_PHASE_COMPUTE);
 
     // Send out the processed frame
     tx_frame(c_audio, 
@@ -0,0 +1,323 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include "common.h"
+
+// The number of adjacent output samples computed by each call to
+// block_fir_s32(). This is fixed by the number of 32-bit VPU accumulators.
+#define BLOCK_OUTPUTS   (8)
+
+// When non-zero, each output sample is also computed the way Part 3B computes
+// it, with vect_s32_dot() (outside of the timed region). Any output which
+// differs by more than 1 (block_fir_s32() rounds its final shift, where Part 3B
+// truncates) is counted and reported as "part3B_mismatches".
+#ifndef VERIFY_PART3B
+# define VERIFY_PART3B  (0)
+#endif
+
+extern 
+const q2_30 filter_coef[TAP_COUNT];
+
+
+// Represents the filter coefficients as a BFP vector
+struct {
+  int32_t* data;
+  exponent_t exp;
+  headroom_t hr; 
+} filter_bfp = {(int32_t*) &filter_coef[0], -30, 10};
+
+
+//// +calc_headroom
+// Compute headroom of int32 vector.
+static inline
+headroom_t calc_headroom(
+    const int32_t vec[],
+    const unsigned length)
+{
+  return vect_s32_headroom(vec, length);
+}
+//// -calc_headroom
+
+
+//// +rx_frame
+// Accept a frame of new audio data 
+static inline 
+void rx_frame(
+    int32_t frame_in[FRAME_SIZE],
+    exponent_t* frame_in_exp,
+    headroom_t* frame_in_hr,
+    const chanend_t c_audio)
+{
+  timer_start(TIMING_PHASE_RX);
+
+  // The exponent of the incoming samples is sent along with them, so there's
+  // no need to assume one.
+  frame_receive(c_audio, frame_in, FRAME_SIZE, frame_in_exp);
+
+  timer_start(TIMING_FRAME);
+  
+  // Make sure the headroom is correct
+  calc_headroom(frame_in, FRAME_SIZE);
+
+  timer_stop(TIMING_PHASE_RX);
+}
+//// -rx_frame
+
+
+//// +rx_and_merge_frame
+// Accept a frame of new audio data and merge it into sample_history
+static inline 
+void rx_and_merge_frame(
+    history_t* sample_history,
+    exponent_t* sample_history_exp,
+    headroom_t* sample_history_hr,
+    const chanend_t c_audio)
+{
+  // BFP vector into which new frame will be placed.
+  struct {
+    int32_t data[FRAME_SIZE];   // Sample data
+    exponent_t exp;             // Exponent
+    headroom_t hr;              // Headroom
+  } frame_in = {{0},0,0};
+
+  // Accept a new input frame
+  rx_frame(frame_in.data, 
+           &frame_in.exp, 
+           &frame_in.hr, 
+           c_audio);
+
+  timer_start(TIMING_PHASE_RESCALE);
+  // Rescale BFP vectors if needed so they can be merged
+  const exponent_t min_frame_in_exp = frame_in.exp - frame_in.hr;
+  const exponent_t min_history_exp = *sample_history_exp - *sample_history_hr;
+  const exponent_t new_exp = MAX(min_frame_in_exp, min_history_exp);
+
+  const right_shift_t hist_shr = new_exp - *sample_history_exp;
+  const right_shift_t frame_in_shr = new_exp - frame_in.exp;
+
+  // Both copies of every sample in the ring buffer must be rescaled.
+  if(hist_shr) {
+    vect_s32_shr((int32_t*) sample_history->data, 
+                 (int32_t*) sample_history->data, 
+                 history_buffer_length(sample_history),
+                 hist_shr);
+    *sample_history_exp = new_exp;
+  }
+
+  if(frame_in_shr){
+    vect_s32_shr(&frame_in.data[0],
+                 &frame_in.data[0],
+                 FRAME_SIZE,
+                 frame_in_shr);
+  }
+  
+  timer_stop(TIMING_PHASE_RESCALE);
+
+  // Now we can merge the new frame in (reversing order)
+  int32_t* next_frame = (int32_t*) history_next_frame(sample_history);
+  for(int k = 0; k < FRAME_SIZE; k++)
+    next_frame[FRAME_SIZE-k-1] = frame_in.data[k];
+
+  timer_start(TIMING_HISTORY);
+  history_commit_frame(sample_history);
+  timer_stop(TIMING_HISTORY);
+
+  // And just ensure the headroom is correct
+  *sample_history_hr = calc_headroom(
+      (int32_t*) history_window(sample_history), HISTORY_SIZE);
+}
+//// -rx_and_merge_frame
+
+
+//// +tx_frame
+// Send a frame of new audio data
+static inline 
+void tx_frame(
+    const chanend_t c_audio,
+    const int32_t frame_out[],
+    const exponent_t frame_out_exp,
+    const headroom_t frame_out_hr,
+    const unsigned frame_size)
+{
+  const exponent_t output_exp = -31;
+  
+  // The output channel is expecting PCM samples with a *fixed* exponent of
+  // output_exp, so we'll need to convert samples to use the correct exponent
+  // before sending.
+
+  const right_shift_t samp_shr = output_exp - frame_out_exp;  
+
+  timer_stop(TIMING_FRAME);
+  timer_start(TIMING_PHASE_TX);
+  
+  int32_t samples[FRAME_SIZE];
+  for(int k = 0; k < frame_size; k++){
+    int32_t sample = frame_out[k];
+    sample = ashr32(sample, samp_shr);
+    samples[k] = sample;
+  }
+
+  frame_send(c_audio, samples, frame_size, output_exp);
+  timer_stop(TIMING_PHASE_TX);
+}
+//// -tx_frame
+
+
+//// +block_fir_s32
+/**
+ * Computes `BLOCK_OUTPUTS` adjacent output samples with a single call.
+ * 
+ * The history window for output `y[j]` begins at `&x[-j]`. Each group of 8
+ * filter coefficients is loaded into the VPU only once, and then reused against
+ * all `BLOCK_OUTPUTS` history windows before moving on to the next group. The
+ * 40-bit accumulators are then shifted right by `shr[]` (with rounding) and
+ * saturated to 32 bits.
+ * 
+ * This function is implemented directly in assembly in `block_fir_s32.S`.
+ */
+void block_fir_s32(
+    int32_t y[BLOCK_OUTPUTS],
+    const int32_t x[],
+    const int32_t b[],
+    const unsigned tap_count,
+    const int32_t shr[BLOCK_OUTPUTS]);
+//// -block_fir_s32
+
+
+//// +filter_frame
+// Calculate entire output frame
+void filter_frame(
+    int32_t frame_out[FRAME_SIZE],
+    exponent_t* frame_out_exp,
+    headroom_t* frame_out_hr,
+    const int32_t history_in[HISTORY_SIZE],
+    const exponent_t history_in_exp,
+    const headroom_t history_in_hr,
+    unsigned* mismatches)
+{
+  // Scaled copies of the sample history and filter coefficients. vect_s32_dot()
+  // applies b_shr and c_shr as it loads each vector, but block_fir_s32() reuses
+  // each load for several outputs, so the shifts are applied up front instead.
+  static int32_t WORD_ALIGNED history_scaled[HISTORY_SIZE];
+  static int32_t WORD_ALIGNED coef_scaled[TAP_COUNT];
+  // The coefficients only need to be rescaled when c_shr changes.
+  static right_shift_t coef_scaled_shr = INT32_MIN;
+
+  // First, determine output exponent and required shifts. Each of
+  // block_fir_s32()'s accumulators sums the same TAP_COUNT products that
+  // vect_s32_dot() would for its output, so the shifts are exactly those of
+  // Part 3B.
+  right_shift_t b_shr, c_shr;
+  vect_s32_dot_prepare(frame_out_exp, &b_shr, &c_shr, 
+                       history_in_exp, filter_bfp.exp,
+                       history_in_hr, filter_bfp.hr, 
+                       TAP_COUNT);
+  // vect_s32_dot_prepare() ensures the result doesn't overflow the 40-bit VPU
+  // accumulators, but we need it in a 32-bit value.
+  right_shift_t s_shr = 8;
+  *frame_out_exp += s_shr;
+
+  // block_fir_s32() takes its final shift as a vector, one per accumulator.
+  const int32_t s_shr_vec[BLOCK_OUTPUTS] = 
+      { s_shr, s_shr, s_shr, s_shr, s_shr, s_shr, s_shr, s_shr };
+
+  vect_s32_shr(&history_scaled[0], &history_in[0], HISTORY_SIZE, b_shr);
+
+  if(c_shr != coef_scaled_shr){
+    vect_s32_shr(&coef_scaled[0], &filter_bfp.data[0], TAP_COUNT, c_shr);
+    coef_scaled_shr = c_shr;
+  }
+
+  // Compute FRAME_SIZE output samples, BLOCK_OUTPUTS at a time.
+  for(int s = 0; s < FRAME_SIZE; s += BLOCK_OUTPUTS){
+    timer_start(TIMING_SAMPLE);
+    block_fir_s32(&frame_out[s], 
+                  &history_scaled[FRAME_SIZE-s-1],
+                  &coef_scaled[0], TAP_COUNT,
+                  s_shr_vec);
+    timer_stop_count(TIMING_SAMPLE, BLOCK_OUTPUTS);
+
+    if(VERIFY_PART3B){
+      for(int k = 0; k < BLOCK_OUTPUTS; k++){
+        int64_t ref = vect_s32_dot(&history_in[FRAME_SIZE-s-k-1], 
+                                   &filter_bfp.data[0], TAP_COUNT,
+                                   b_shr, c_shr);
+        int64_t diff = (int64_t) sat32(ashr64(ref, s_shr)) - frame_out[s+k];
+        if(diff > 1 || diff < -1)
+          (*mismatches)++;
+      }
+    }
+  }
+
+  //Finally, calculate the headroom of the output frame.
+  *frame_out_hr = calc_headroom(frame_out, FRAME_SIZE);
+}
+//// -filter_frame
+
+
+//// +filter_task
+/**
+ * This is the thread entry point for the hardware thread which will actually 
+ * be applying the FIR filter.
+ * 
+ * `c_audio` is the channel over which PCM audio data is exchanged with tile[0].
+ */
+void filter_task(
+    chanend_t c_audio)
+{
+
+  // Storage for the sample history's mirrored ring buffer
+  static int32_t history_buff[HISTORY_BUFFER_LENGTH(HISTORY_SIZE)];
+
+  // Represents the sample history as a BFP vector
+  struct {
+    history_t data;             // Sample data
+    exponent_t exp;             // Exponent
+    headroom_t hr;              // Headroom
+  } sample_history = {{0},-200,0};
+
+  history_init(&sample_history.data, &history_buff[0], HISTORY_SIZE, 
+               FRAME_SIZE, sizeof(int32_t));
+
+  // Represents output frame as a BFP vector
+  struct {
+    int32_t data[FRAME_SIZE];   // Sample data
+    exponent_t exp;             // Exponent
+    headroom_t hr;              // Headroom
+  } frame_output;
+
+  static float mismatch_count = 0.0f;
+  unsigned mismatches = 0;
+  if(VERIFY_PART3B)
+    timer_report_series("part3B_mismatches", &mismatch_count, 1);
+
+  // Loop forever
+  while(1) {
+
+    // Read in a new frame
+    rx_and_merge_frame(&sample_history.data, 
+                       &sample_history.exp,
+                       &sample_history.hr, 
+                       c_audio);
+
+    // Calc output frame
+    timer_start(TIMING_PHASE_COMPUTE);
+    filter_frame(&frame_output.data[0], 
+                 &frame_output.exp, 
+                 &frame_output.hr,
+                 (int32_t*) history_window(&sample_history.data), 
+                 sample_history.exp, 
+                 sample_history.hr,
+                 &mismatches);
+    mismatch_count = mismatches;
+    timer_stop(TIMING_PHASE_COMPUTE);
+
+    // Send out the processed frame
+    tx_frame(c_audio, 
+             &frame_output.data[0], 
+             frame_output.exp, 
+             frame_output.hr, 
+             FRAME_SIZE);
+  }
+}
+//// -filter_task
\ No newline at end of file
@@ -0,0 +1,218 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include "common.h"
+
+// Length of the FFT used for the overlap-save convolution. This must be a power
+// of 2 which is at least (TAP_COUNT + FRAME_SIZE - 1).
+#define FFT_N       (2048)
+
+#if (TAP_COUNT + FRAME_SIZE - 1) > FFT_N
+# error "FFT_N is too short for TAP_COUNT and FRAME_SIZE."
+#endif
+
+// Number of frequency bins (DC through Nyquist) in the unpacked spectrum of a
+// real FFT_N-point signal.
+#define FFT_BINS    ((FFT_N/2) + 1)
+
+extern
+const q2_30 filter_coef[TAP_COUNT];
+
+
+// Frequency-domain representation of the filter coefficients. This is computed
+// once by filter_init(). The buffer is also used as the time-domain buffer for
+// the coefficients' FFT, so it must be DWORD_ALIGNED.
+complex_s32_t DWORD_ALIGNED filter_spectrum_buff[FFT_BINS];
+bfp_complex_s32_t filter_spectrum;
+
+
+//// +calc_headroom
+// Compute headroom of int32 vector.
+static inline
+headroom_t calc_headroom(
+    const int32_t vec[],
+    const unsigned length)
+{
+  return vect_s32_headroom(vec, length);
+}
+//// -calc_headroom
+
+
+//// +rx_frame
+// Accept a frame of new audio data
+static inline
+void rx_frame(
+    int32_t frame_in[FRAME_SIZE],
+    const chanend_t c_audio)
+{
+  timer_start(TIMING_PHASE_RX);
+
+  // Unlike in the time-domain stages, new samples are stored in chronological
+  // order, because that is the order the FFT expects.
+  frame_receive(c_audio, frame_in, FRAME_SIZE, NULL);
+
+  timer_start(TIMING_FRAME);
+
+  timer_stop(TIMING_PHASE_RX);
+}
+//// -rx_frame
+
+
+//// +tx_frame
+// Send a frame of new audio data
+static inline
+void tx_frame(
+    const chanend_t c_audio,
+    const int32_t frame_out[],
+    const exponent_t frame_out_exp,
+    const unsigned frame_size)
+{
+  const exponent_t output_exp = -31;
+
+  // The output channel is expecting PCM samples with a *fixed* exponent of
+  // output_exp, so we'll need to convert samples to use the correct exponent
+  // before sending.
+
+  const right_shift_t samp_shr = output_exp - frame_out_exp;
+
+  timer_stop(TIMING_FRAME);
+  timer_start(TIMING_PHASE_TX);
+
+  int32_t samples[FRAME_SIZE];
+  for(int k = 0; k < frame_size; k++){
+    int32_t sample = frame_out[k];
+    sample = ashr32(sample, samp_shr);
+    samples[k] = sample;
+  }
+
+  frame_send(c_audio, samples, frame_size, output_exp);
+  timer_stop(TIMING_PHASE_TX);
+}
+//// -tx_frame
+
+
+//// +filter_init
+// Compute the spectrum of the filter coefficients.
+void filter_init()
+{
+  // The coefficients are zero-padded out to FFT_N samples and transformed in
+  // place within filter_spectrum_buff[].
+  int32_t* coef_buff = (int32_t*) &filter_spectrum_buff[0];
+  memset(coef_buff, 0, sizeof(filter_spectrum_buff));
+  memcpy(coef_buff, &filter_coef[0], TAP_COUNT * sizeof(int32_t));
+
+  bfp_s32_t coef_bfp;
+  bfp_s32_init(&coef_bfp, coef_buff, -30, FFT_N, 1);
+
+  bfp_complex_s32_t* spectrum = bfp_fft_forward_mono(&coef_bfp);
+
+  // The mono FFT packs the (real) Nyquist component into the imaginary part of
+  // the DC bin. It must be unpacked before it can be multiplied element-wise.
+  bfp_fft_unpack_mono(spectrum);
+
+  filter_spectrum = *spectrum;
+}
+//// -filter_init
+
+
+//// +filter_frame
+// Calculate entire output frame
+void filter_frame(
+    int32_t frame_out[FRAME_SIZE],
+    exponent_t* frame_out_exp,
+    headroom_t* frame_out_hr,
+    const int32_t history_in[FFT_N],
+    const exponent_t history_in_exp)
+{
+  // The FFT operates in-place, so the history is first copied into a work
+  // buffer. Two extra words are needed to hold the unpacked Nyquist bin.
+  static int32_t DWORD_ALIGNED work_buff[FFT_N + 2];
+  memcpy(&work_buff[0], &history_in[0], FFT_N * sizeof(int32_t));
+
+  bfp_s32_t work;
+  bfp_s32_init(&work, &work_buff[0], history_in_exp, FFT_N, 1);
+
+  // Transform the most recent FFT_N input samples
+  bfp_complex_s32_t* spectrum = bfp_fft_forward_mono(&work);
+  bfp_fft_unpack_mono(spectrum);
+
+  // Multiplication in the frequency domain is circular convolution in the time
+  // domain.
+  bfp_complex_s32_mul(spectrum, spectrum, &filter_spectrum);
+
+  // And back to the time domain.
+  bfp_fft_pack_mono(spectrum);
+  bfp_s32_t* result = bfp_fft_inverse_mono(spectrum);
+
+  // Only the final FRAME_SIZE samples of the circular convolution are free of
+  // wrap-around, and those are exactly the outputs for the newest frame.
+  memcpy(&frame_out[0], &result->data[FFT_N-FRAME_SIZE],
+         FRAME_SIZE * sizeof(int32_t));
+  *frame_out_exp = result->exp;
+
+  //Finally, calculate the headroom of the output frame.
+  *frame_out_hr = calc_headroom(frame_out, FRAME_SIZE);
+}
+//// -filter_frame
+
+
+//// +filter_task
+/**
+ * This is the thread entry point for the hardware thread which will actually
+ * be applying the FIR filter.
+ *
+ * `c_audio` is the channel over which PCM audio data is exchanged with tile[0].
+ */
+void filter_task(
+    chanend_t c_audio)
+{
+  // Represents the most recent FFT_N input samples, in chronological order. The
+  // input samples all have a fixed exponent, so no rescaling is ever needed.
+  struct {
+    int32_t data[FFT_N];        // Sample data
+    exponent_t exp;             // Exponent
+  } sample_history = {{0},-31};
+
+  // Represents output frame as a BFP vector
+  struct {
+    int32_t data[FRAME_SIZE];   // Sample data
+    exponent_t exp;             // Exponent
+    headroom_t hr;              // Headroom
+  } frame_output;
+
+  filter_init();
+
+  // Loop forever
+  while(1) {
+
+    // Read in a new frame at the end of the history
+    rx_frame(&sample_history.data[FFT_N-FRAME_SIZE],
+             c_audio);
+
+    // Calc output frame. There is no per-sample work in this stage, so the
+    // time for the whole frame is attributed to its FRAME_SIZE samples.
+    timer_start(TIMING_PHASE_COMPUTE);
+    timer_start(TIMING_SAMPLE);
+    filter_frame(&frame_output.data[0],
+                 &frame_output.exp,
+                 &frame_output.hr,
+                 &sample_history.data[0],
+                 sample_history.exp);
+    timer_stop_count(TIMING_SAMPLE, FRAME_SIZE);
+    timer_stop(TIMING_PHASE_COMPUTE);
+
+    // Discard the oldest frame to make room for new samples at the end
+    timer_start(TIMING_HISTORY);
+    memmove(&sample_history.data[0],
+            &sample_history.data[FRAME_SIZE],
+            (FFT_N-FRAME_SIZE) * sizeof(int32_t));
+    timer_stop(TIMING_HISTORY);
+
+    // Send out the processed frame
+    tx_frame(c_audio,
+             &frame_output.data[0],
+             frame_output.exp,
+             FRAME_SIZE);
+  }
+}
+//// -filter_task
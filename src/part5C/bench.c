@@ -0,0 +1,130 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+#include <platform.h>
+#include <xs1.h>
+#include <stdio.h>
+#include <xscope.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <xcore/hwtimer.h>
+
+#include "upols.h"
+
+// Samples per block (and taps per partition)
+#define BLOCK_SIZE      (256)
+
+// The partition counts to be benchmarked are 1, 2, 4, ..., MAX_PARTITIONS. The
+// filter and input spectra take (2 * 8 * (BLOCK_SIZE+1)) bytes per partition, so
+// 64 partitions (16384 taps) is about as much as fits in a tile's memory.
+#define MAX_PARTITIONS  (64)
+#define SWEEP_COUNT     (7)
+
+// Number of blocks processed before timing begins, so that the frequency-domain
+// delay line has been filled.
+#define WARMUP_BLOCKS   (MAX_PARTITIONS)
+// Number of blocks timed for each partition count.
+#define TIMED_BLOCKS    (16)
+
+static unsigned t_start = 0;
+
+/**
+ * Start timer using 100MHz reference clock
+ */
+static inline
+void timer_start()
+{
+  t_start = get_reference_time();
+}
+
+/**
+ * Stop timer and get elapsed time in reference clock ticks
+ */
+static inline
+unsigned timer_stop()
+{
+  unsigned t_stop = get_reference_time();
+  return t_stop - t_start;
+}
+
+static inline
+void rand_vect(
+    int32_t vec[],
+    const unsigned length)
+{
+  for(int k = 0; k < length; k++)
+    vec[k] = rand() - (RAND_MAX >> 1);
+}
+
+int main()
+{
+  xscope_config_io(XSCOPE_IO_BASIC);
+
+  printf("Now running part5C_bench.\n");
+
+  srand(0x5C5C5C5C);
+
+  int32_t block_in[BLOCK_SIZE];
+  int32_t block_out[BLOCK_SIZE];
+  exponent_t block_out_exp;
+  headroom_t block_out_hr;
+
+  float ave_block_us[SWEEP_COUNT] = {0.0f};
+
+  unsigned dex = 0;
+  for(unsigned partitions = 1; partitions <= MAX_PARTITIONS; partitions *= 2){
+    const unsigned tap_count = partitions * BLOCK_SIZE;
+    printf("tap_count: %u\n", tap_count);
+
+    int32_t* coef = (int32_t*) malloc(tap_count * sizeof(int32_t));
+    assert(coef);
+    rand_vect(coef, tap_count);
+
+    // The coefficient exponent only affects the output exponent, not the
+    // amount of work done.
+    upols_t conv;
+    upols_init(&conv, coef, -45, tap_count, BLOCK_SIZE);
+
+    // The coefficient spectra have been computed, so the time-domain
+    // coefficients are no longer needed.
+    free(coef);
+
+    uint64_t total_ticks = 0UL;
+
+    for(int blk = 0; blk < WARMUP_BLOCKS + TIMED_BLOCKS; blk++){
+      rand_vect(block_in, BLOCK_SIZE);
+
+      timer_start();
+      upols_process(&conv, block_out, &block_out_exp, &block_out_hr,
+                    block_in, -31);
+      const unsigned ticks = timer_stop();
+
+      if(blk >= WARMUP_BLOCKS)
+        total_ticks += ticks;
+    }
+
+    upols_deinit(&conv);
+
+    const float ave_ticks = (1.0f * total_ticks) / (TIMED_BLOCKS);
+    ave_block_us[dex++] = ave_ticks * 0.01f; // Reference clock is 100 MHz
+  }
+
+  printf("\n");
+  printf("+------------+--------+----------------+---------------+---------------+\n");
+  printf("| Partitions |  Taps  | Block Time(us) | Sample Time   | Tap Time      |\n");
+  printf("+------------+--------+----------------+---------------+---------------+\n");
+  for(int k = 0; k < SWEEP_COUNT; k++){
+    const unsigned partitions = 1 << k;
+    const unsigned tap_count = partitions * BLOCK_SIZE;
+    const float sample_ns = ave_block_us[k] * 1000.0f / BLOCK_SIZE;
+
+    printf("|   % 6u   ", partitions);
+    printf("| % 6u ", tap_count);
+    printf("|   % 10.02f   ", ave_block_us[k]);
+    printf("| % 9.02f ns  ", sample_ns);
+    printf("| % 9.04f ns  |", sample_ns / tap_count);
+    printf("\n");
+  }
+  printf("+------------+--------+----------------+---------------+---------------+\n");
+
+  return 0;
+}
@@ -0,0 +1,118 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include "common.h"
+#include "upols.h"
+
+extern
+const q2_30 filter_coef[TAP_COUNT];
+
+
+//// +rx_frame
+// Accept a frame of new audio data
+static inline
+void rx_frame(
+    int32_t frame_in[FRAME_SIZE],
+    const chanend_t c_audio)
+{
+  timer_start(TIMING_PHASE_RX);
+
+  // Unlike in the time-domain stages, new samples are stored in chronological
+  // order, because that is the order the FFT expects.
+  frame_receive(c_audio, frame_in, FRAME_SIZE, NULL);
+
+  timer_start(TIMING_FRAME);
+
+  timer_stop(TIMING_PHASE_RX);
+}
+//// -rx_frame
+
+
+//// +tx_frame
+// Send a frame of new audio data
+static inline
+void tx_frame(
+    const chanend_t c_audio,
+    const int32_t frame_out[],
+    const exponent_t frame_out_exp,
+    const unsigned frame_size)
+{
+  const exponent_t output_exp = -31;
+
+  // The output channel is expecting PCM samples with a *fixed* exponent of
+  // output_exp, so we'll need to convert samples to use the correct exponent
+  // before sending.
+
+  const right_shift_t samp_shr = output_exp - frame_out_exp;
+
+  timer_stop(TIMING_FRAME);
+  timer_start(TIMING_PHASE_TX);
+
+  int32_t samples[FRAME_SIZE];
+  for(int k = 0; k < frame_size; k++){
+    int32_t sample = frame_out[k];
+    sample = ashr32(sample, samp_shr);
+    samples[k] = sample;
+  }
+
+  frame_send(c_audio, samples, frame_size, output_exp);
+  timer_stop(TIMING_PHASE_TX);
+}
+//// -tx_frame
+
+
+//// +filter_task
+/**
+ * This is the thread entry point for the hardware thread which will actually
+ * be applying the FIR filter.
+ *
+ * `c_audio` is the channel over which PCM audio data is exchanged with tile[0].
+ */
+void filter_task(
+    chanend_t c_audio)
+{
+  // The convolver keeps its own (frequency-domain) sample history, so only a
+  // single frame of input is needed here.
+  int32_t frame_input[FRAME_SIZE] = {0};
+  const exponent_t input_exp = -31;
+
+  // Represents output frame as a BFP vector
+  struct {
+    int32_t data[FRAME_SIZE];   // Sample data
+    exponent_t exp;             // Exponent
+    headroom_t hr;              // Headroom
+  } frame_output;
+
+  // Each partition of the impulse response is FRAME_SIZE taps long, so each
+  // frame needs exactly one FFT/IFFT pair.
+  upols_t conv;
+  upols_init(&conv, &filter_coef[0], -30, TAP_COUNT, FRAME_SIZE);
+
+  // Loop forever
+  while(1) {
+
+    // Read in a new frame
+    rx_frame(&frame_input[0],
+             c_audio);
+
+    // Calc output frame. There is no per-sample work in this stage, so the
+    // time for the whole frame is attributed to its FRAME_SIZE samples.
+    timer_start(TIMING_PHASE_COMPUTE);
+    timer_start(TIMING_SAMPLE);
+    upols_process(&conv,
+                  &frame_output.data[0],
+                  &frame_output.exp,
+                  &frame_output.hr,
+                  &frame_input[0],
+                  input_exp);
+    timer_stop_count(TIMING_SAMPLE, FRAME_SIZE);
+    timer_stop(TIMING_PHASE_COMPUTE);
+
+    // Send out the processed frame
+    tx_frame(c_audio,
+             &frame_output.data[0],
+             frame_output.exp,
+             FRAME_SIZE);
+  }
+}
+//// -filter_task
@@ -0,0 +1,185 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "upols.h"
+
+
+void upols_init(
+    upols_t* conv,
+    const int32_t coef[],
+    const exponent_t coef_exp,
+    const unsigned tap_count,
+    const unsigned block_size)
+{
+  const unsigned bins = block_size + 1;
+  const unsigned fft_n = 2 * block_size;
+  const unsigned partitions = (tap_count + block_size - 1) / block_size;
+
+  conv->block_size = block_size;
+  conv->partitions = partitions;
+  conv->newest = 0;
+  conv->acc_valid = 0;
+
+  // Each spectrum buffer must be able to hold fft_n real samples before the
+  // FFT and (block_size + 1) complex bins after it is unpacked.
+  complex_s32_t* filter_buff =
+      (complex_s32_t*) malloc(partitions * bins * sizeof(complex_s32_t));
+  complex_s32_t* input_buff =
+      (complex_s32_t*) malloc(partitions * bins * sizeof(complex_s32_t));
+  complex_s32_t* acc_buff =
+      (complex_s32_t*) malloc(bins * sizeof(complex_s32_t));
+
+  conv->filter_spectra =
+      (bfp_complex_s32_t*) malloc(partitions * sizeof(bfp_complex_s32_t));
+  conv->input_spectra =
+      (bfp_complex_s32_t*) malloc(partitions * sizeof(bfp_complex_s32_t));
+  conv->prev_block = (int32_t*) calloc(block_size, sizeof(int32_t));
+
+  assert(filter_buff && input_buff && acc_buff);
+  assert(conv->filter_spectra && conv->input_spectra && conv->prev_block);
+
+  // The exponent here is arbitrary, because the block is all zeros.
+  conv->prev_block_exp = -31;
+
+  for(int p = 0; p < partitions; p++){
+    // Zero-pad this partition's taps out to fft_n samples and transform them
+    // in-place.
+    int32_t* time_buff = (int32_t*) &filter_buff[p * bins];
+    memset(time_buff, 0, bins * sizeof(complex_s32_t));
+
+    const unsigned first_tap = p * block_size;
+    const unsigned taps = MIN(block_size, tap_count - first_tap);
+    memcpy(time_buff, &coef[first_tap], taps * sizeof(int32_t));
+
+    bfp_s32_t h;
+    bfp_s32_init(&h, time_buff, coef_exp, fft_n, 1);
+
+    bfp_complex_s32_t* H = bfp_fft_forward_mono(&h);
+    // The mono FFT packs the Nyquist component into the DC bin. Unpacked
+    // spectra can be multiplied element-wise.
+    bfp_fft_unpack_mono(H);
+    conv->filter_spectra[p] = *H;
+
+    // The delay line starts out silent.
+    memset(&input_buff[p * bins], 0, bins * sizeof(complex_s32_t));
+    bfp_complex_s32_init(&conv->input_spectra[p], &input_buff[p * bins],
+                         0, bins, 1);
+  }
+
+  bfp_complex_s32_init(&conv->acc, acc_buff, 0, bins, 0);
+}
+
+
+void upols_deinit(
+    upols_t* conv)
+{
+  // The spectra were transformed in-place, so their data pointers are still the
+  // start of the allocated buffers.
+  free(conv->filter_spectra[0].data);
+  free(conv->input_spectra[0].data);
+  free(conv->acc.data);
+  free(conv->filter_spectra);
+  free(conv->input_spectra);
+  free(conv->prev_block);
+
+  conv->filter_spectra = NULL;
+  conv->input_spectra = NULL;
+  conv->prev_block = NULL;
+}
+
+
+void upols_push_block(
+    upols_t* conv,
+    const int32_t block_in[],
+    const exponent_t block_in_exp)
+{
+  const unsigned block_size = conv->block_size;
+
+  // The newest spectrum replaces the oldest one. Partition p is always paired
+  // with input_spectra[(newest + p) % partitions].
+  conv->newest = (conv->newest == 0)? conv->partitions - 1 : conv->newest - 1;
+  bfp_complex_s32_t* X = &conv->input_spectra[conv->newest];
+  int32_t* time_buff = (int32_t*) X->data;
+
+  // The FFT input is the previous block followed by the new one. Both halves
+  // must share an exponent.
+  const exponent_t exp = MAX(conv->prev_block_exp, block_in_exp);
+  vect_s32_shr(&time_buff[0], &conv->prev_block[0], block_size,
+               exp - conv->prev_block_exp);
+  vect_s32_shr(&time_buff[block_size], &block_in[0], block_size,
+               exp - block_in_exp);
+
+  memcpy(&conv->prev_block[0], &block_in[0], block_size * sizeof(int32_t));
+  conv->prev_block_exp = block_in_exp;
+
+  bfp_s32_t x;
+  bfp_s32_init(&x, time_buff, exp, 2 * block_size, 1);
+
+  bfp_complex_s32_t* spectrum = bfp_fft_forward_mono(&x);
+  bfp_fft_unpack_mono(spectrum);
+  *X = *spectrum;
+
+  // Start a new accumulation. The inverse FFT in upols_finish() works in-place
+  // on the accumulator, so its length must also be restored.
+  bfp_complex_s32_init(&conv->acc, conv->acc.data, 0, block_size + 1, 0);
+  conv->acc_valid = 0;
+}
+
+
+void upols_macc(
+    upols_t* conv,
+    const unsigned first,
+    const unsigned count)
+{
+  for(int p = first; p < first + count; p++){
+    const bfp_complex_s32_t* X =
+        &conv->input_spectra[(conv->newest + p) % conv->partitions];
+    const bfp_complex_s32_t* H = &conv->filter_spectra[p];
+
+    if(conv->acc_valid){
+      bfp_complex_s32_macc(&conv->acc, X, H);
+    } else {
+      bfp_complex_s32_mul(&conv->acc, X, H);
+      conv->acc_valid = 1;
+    }
+  }
+}
+
+
+void upols_finish(
+    upols_t* conv,
+    int32_t block_out[],
+    exponent_t* block_out_exp,
+    headroom_t* block_out_hr)
+{
+  const unsigned block_size = conv->block_size;
+
+  assert(conv->acc_valid);
+
+  bfp_fft_pack_mono(&conv->acc);
+  bfp_s32_t* y = bfp_fft_inverse_mono(&conv->acc);
+
+  // The first half of the result is corrupted by circular wrap-around. The
+  // second half is the filter output for the newest block.
+  memcpy(&block_out[0], &y->data[block_size], block_size * sizeof(int32_t));
+  *block_out_exp = y->exp;
+  *block_out_hr = vect_s32_headroom(&block_out[0], block_size);
+}
+
+
+void upols_process(
+    upols_t* conv,
+    int32_t block_out[],
+    exponent_t* block_out_exp,
+    headroom_t* block_out_hr,
+    const int32_t block_in[],
+    const exponent_t block_in_exp)
+{
+  upols_push_block(conv, block_in, block_in_exp);
+  upols_macc(conv, 0, conv->partitions);
+  upols_finish(conv, block_out, block_out_exp, block_out_hr);
+}
@@ -0,0 +1,109 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "xmath/xmath.h"
+
+/**
+ * Uniformly partitioned overlap-save (UPOLS) convolution engine.
+ *
+ * The filter's impulse response is split into `partitions` blocks of
+ * `block_size` taps each. The spectrum of each block is computed once, at
+ * initialization. Each call then transforms one new block of input samples
+ * (using a `2*block_size`-point real FFT), stores its spectrum in a
+ * frequency-domain delay line, multiply-accumulates every partition against
+ * the delay line, and transforms the result back to the time domain.
+ *
+ * The cost per block is therefore one FFT/IFFT pair plus `partitions` complex
+ * multiply-accumulates, and the memory required grows only with the filter
+ * length.
+ *
+ * The work done for each block is exposed as three steps, upols_push_block(),
+ * upols_macc() and upols_finish(), so callers can spread it across time.
+ * upols_process() simply performs all three.
+ */
+typedef struct {
+  // Number of samples consumed and produced on each block
+  unsigned block_size;
+  // Number of partitions the impulse response is split into
+  unsigned partitions;
+  // Spectra of the filter's partitions, each with (block_size+1) bins
+  bfp_complex_s32_t* filter_spectra;
+  // Frequency-domain delay line of input spectra, each with (block_size+1) bins
+  bfp_complex_s32_t* input_spectra;
+  // Index into input_spectra[] of the most recent input spectrum
+  unsigned newest;
+  // Frequency-domain accumulator. Also used in-place for the inverse FFT.
+  bfp_complex_s32_t acc;
+  // Non-zero once acc holds at least one product for the current block
+  unsigned acc_valid;
+  // The previous block of input samples, which makes up the first half of the
+  // next FFT's input.
+  int32_t* prev_block;
+  exponent_t prev_block_exp;
+} upols_t;
+
+
+/**
+ * Initialize a UPOLS convolver.
+ *
+ * `tap_count` need not be a multiple of `block_size`; the final partition is
+ * zero-padded. `block_size` must be a power of 2, and `2*block_size` must be a
+ * supported real FFT length.
+ *
+ * Buffers are allocated with malloc() and released by upols_deinit().
+ */
+void upols_init(
+    upols_t* conv,
+    const int32_t coef[],
+    const exponent_t coef_exp,
+    const unsigned tap_count,
+    const unsigned block_size);
+
+/**
+ * Release the buffers allocated by upols_init().
+ */
+void upols_deinit(
+    upols_t* conv);
+
+/**
+ * Transform a new block of `block_size` input samples (in chronological order)
+ * and push its spectrum onto the frequency-domain delay line.
+ */
+void upols_push_block(
+    upols_t* conv,
+    const int32_t block_in[],
+    const exponent_t block_in_exp);
+
+/**
+ * Multiply-accumulate partitions `first` through `first+count-1` of the filter
+ * against the delay line.
+ */
+void upols_macc(
+    upols_t* conv,
+    const unsigned first,
+    const unsigned count);
+
+/**
+ * Transform the accumulated spectrum back into the time domain, producing
+ * `block_size` output samples (in chronological order).
+ */
+void upols_finish(
+    upols_t* conv,
+    int32_t block_out[],
+    exponent_t* block_out_exp,
+    headroom_t* block_out_hr);
+
+/**
+ * Process one block of input samples, producing one block of output samples.
+ */
+void upols_process(
+    upols_t* conv,
+    int32_t block_out[],
+    exponent_t* block_out_exp,
+    headroom_t* block_out_hr,
+    const int32_t block_in[],
+    const exponent_t block_in_exp);
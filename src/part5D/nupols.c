@@ -0,0 +1,215 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "nupols.h"
+
+
+/**
+ * Decide which partitions a tail segment multiply-accumulates on each tick.
+ *
+ * The forward FFT must happen on the first tick and the inverse FFT on the
+ * last, so the partitions are handed out so that the estimated work on every
+ * tick is as even as possible. This keeps each tick's slice of work, and so
+ * the time each frame has to wait for the background thread, small and
+ * predictable.
+ */
+static
+void plan_tail(
+    nupols_tail_t* tail)
+{
+  // Estimated cost of a real FFT of 2*block_size samples, in units of complex
+  // multiply-accumulates of (block_size+1) bins. A radix-2 FFT does roughly
+  // (log2(block_size)/2) times as many complex multiplies as the MACC.
+  const unsigned fft_cost = MAX(1, u32_ceil_log2(tail->block_size) / 2);
+
+  unsigned load[NUPOLS_MAX_TICKS] = {0};
+  load[0] += fft_cost;
+  load[tail->ticks-1] += fft_cost;
+
+  for(int t = 0; t < tail->ticks; t++)
+    tail->macc_count[t] = 0;
+
+  for(int p = 0; p < tail->conv.partitions; p++){
+    unsigned t_min = 0;
+    for(int t = 1; t < tail->ticks; t++)
+      if(load[t] < load[t_min]) t_min = t;
+    tail->macc_count[t_min]++;
+    load[t_min]++;
+  }
+
+  tail->macc_first[0] = 0;
+  for(int t = 1; t < tail->ticks; t++)
+    tail->macc_first[t] = tail->macc_first[t-1] + tail->macc_count[t-1];
+}
+
+
+static
+void tail_init(
+    nupols_tail_t* tail,
+    const int32_t coef[],
+    const exponent_t coef_exp,
+    const unsigned tap_count,
+    const unsigned block_size,
+    const unsigned frame_size)
+{
+  tail->block_size = block_size;
+  tail->pos = 0;
+
+  if(tap_count == 0){
+    tail->ticks = 0;
+    return;
+  }
+
+  tail->ticks = block_size / frame_size;
+  upols_init(&tail->conv, coef, coef_exp, tap_count, block_size);
+
+  tail->in_fill = (int32_t*) calloc(block_size, sizeof(int32_t));
+  tail->in_work = (int32_t*) calloc(block_size, sizeof(int32_t));
+  tail->out_ready = (int32_t*) calloc(block_size, sizeof(int32_t));
+  tail->out_work = (int32_t*) calloc(block_size, sizeof(int32_t));
+  assert(tail->in_fill && tail->in_work && tail->out_ready && tail->out_work);
+  tail->out_ready_exp = NUPOLS_IO_EXP;
+  tail->out_work_exp = NUPOLS_IO_EXP;
+
+  channel_t c = chan_alloc();
+  tail->c_tick = c.end_a;
+  tail->c_worker = c.end_b;
+
+  plan_tail(tail);
+}
+
+
+void nupols_init(
+    nupols_t* conv,
+    const int32_t coef[],
+    const exponent_t coef_exp,
+    const unsigned tap_count,
+    const unsigned frame_size)
+{
+  const unsigned F = frame_size;
+  conv->frame_size = F;
+
+  // Head: taps [0, F) in direct form. The accumulator's exponent is
+  // (NUPOLS_IO_EXP + coef_exp + 30), and the output's is NUPOLS_IO_EXP.
+  const unsigned head_taps = MIN(F, tap_count);
+  const right_shift_t head_shr = -(coef_exp + 30);
+  conv->head_state = (int32_t*) calloc(head_taps, sizeof(int32_t));
+  assert(conv->head_state);
+  filter_fir_s32_init(&conv->head, conv->head_state, head_taps,
+                      (int32_t*) &coef[0], head_shr);
+
+  // Body: taps [F, 4F). The body's convolver also covers [0, F) so that its
+  // partitions line up with the input spectra without any extra delay, but
+  // partition 0 is never used.
+  conv->body_active = (tap_count > F);
+  if(conv->body_active)
+    upols_init(&conv->body, coef, coef_exp, MIN(4*F, tap_count), F);
+
+  // Tail segment k has blocks of B = (F << (k+1)) samples and starts at tap 2*B.
+  // Its result is available 2*B samples after the start of the input block.
+  for(int k = 0; k < NUPOLS_TAIL_SEGMENTS; k++){
+    const unsigned block_size = F << (k+1);
+    const unsigned start = MIN(2 * block_size, tap_count);
+    const unsigned end = (k == NUPOLS_TAIL_SEGMENTS-1)? tap_count
+                       : MIN(4 * block_size, tap_count);
+    tail_init(&conv->tail[k], &coef[start], coef_exp, end - start,
+              block_size, F);
+  }
+
+  conv->scratch = (int32_t*) malloc(F * sizeof(int32_t));
+  assert(conv->scratch);
+}
+
+
+void nupols_process(
+    nupols_t* conv,
+    int32_t frame_out[],
+    const int32_t frame_in[])
+{
+  const unsigned F = conv->frame_size;
+
+  // Start this frame's slice of work on each tail segment.
+  for(int k = 0; k < NUPOLS_TAIL_SEGMENTS; k++){
+    nupols_tail_t* tail = &conv->tail[k];
+    if(tail->ticks)
+      chan_out_word(tail->c_tick, tail->pos);
+  }
+
+  // Head
+  for(int s = 0; s < F; s++)
+    frame_out[s] = filter_fir_s32(&conv->head, frame_in[s]);
+
+  // Body
+  if(conv->body_active){
+    exponent_t body_exp;
+    headroom_t body_hr;
+    upols_push_block(&conv->body, frame_in, NUPOLS_IO_EXP);
+    upols_macc(&conv->body, 1, conv->body.partitions - 1);
+    upols_finish(&conv->body, conv->scratch, &body_exp, &body_hr);
+    vect_s32_add(frame_out, frame_out, conv->scratch, F,
+                 0, NUPOLS_IO_EXP - body_exp);
+  }
+
+  // Tail segments. The background threads only ever touch in_work[] and
+  // out_work[], so in_fill[] and out_ready[] are safe to use here.
+  for(int k = 0; k < NUPOLS_TAIL_SEGMENTS; k++){
+    nupols_tail_t* tail = &conv->tail[k];
+    if(!tail->ticks) continue;
+
+    memcpy(&tail->in_fill[tail->pos * F], frame_in, F * sizeof(int32_t));
+    vect_s32_add(frame_out, frame_out, &tail->out_ready[tail->pos * F], F,
+                 0, NUPOLS_IO_EXP - tail->out_ready_exp);
+  }
+
+  // Wait for each tail segment to finish its slice, then, at the end of a
+  // block, hand over the completed input and output blocks.
+  for(int k = 0; k < NUPOLS_TAIL_SEGMENTS; k++){
+    nupols_tail_t* tail = &conv->tail[k];
+    if(!tail->ticks) continue;
+
+    chan_in_word(tail->c_tick);
+
+    if(++tail->pos == tail->ticks){
+      tail->pos = 0;
+
+      int32_t* tmp = tail->in_fill;
+      tail->in_fill = tail->in_work;
+      tail->in_work = tmp;
+
+      tmp = tail->out_ready;
+      tail->out_ready = tail->out_work;
+      tail->out_work = tmp;
+
+      const exponent_t tmp_exp = tail->out_ready_exp;
+      tail->out_ready_exp = tail->out_work_exp;
+      tail->out_work_exp = tmp_exp;
+    }
+  }
+}
+
+
+void nupols_tail_worker(
+    nupols_tail_t* tail)
+{
+  if(!tail->ticks) return;
+
+  while(1){
+    const unsigned tick = chan_in_word(tail->c_worker);
+
+    if(tick == 0)
+      upols_push_block(&tail->conv, tail->in_work, NUPOLS_IO_EXP);
+
+    upols_macc(&tail->conv, tail->macc_first[tick], tail->macc_count[tick]);
+
+    if(tick == tail->ticks - 1){
+      headroom_t hr;
+      upols_finish(&tail->conv, tail->out_work, &tail->out_work_exp, &hr);
+    }
+
+    chan_out_word(tail->c_worker, 0);
+  }
+}
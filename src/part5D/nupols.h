@@ -0,0 +1,124 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <xcore/channel.h>
+#include <xcore/chanend.h>
+#include <xcore/parallel.h>
+
+#include "xmath/xmath.h"
+#include "upols.h"
+
+// Number of tail segments, each processed by its own background thread. Tail
+// segment k uses blocks of (frame_size << (k+1)) samples.
+#define NUPOLS_TAIL_SEGMENTS  (2)
+
+// Maximum number of frames over which a tail segment's work is spread.
+#define NUPOLS_MAX_TICKS      (1 << NUPOLS_TAIL_SEGMENTS)
+
+// Input and output samples are both Q1.31.
+#define NUPOLS_IO_EXP         (-31)
+
+
+/**
+ * One tail segment of a non-uniformly partitioned convolver.
+ *
+ * A tail segment with block size B covers the taps starting at 2*B. The input
+ * block it transforms is collected over (B / frame_size) frames, the work for
+ * that block is then spread over the next (B / frame_size) frames by a
+ * background thread, and the result is consumed over the (B / frame_size)
+ * frames after that. Because the segment's first tap is 2*B, this adds no
+ * latency to the filter.
+ */
+typedef struct {
+  // The UPOLS convolver for this segment's taps
+  upols_t conv;
+  // Samples per block
+  unsigned block_size;
+  // Frames per block. 0 if the segment is unused.
+  unsigned ticks;
+  // The range of partitions multiply-accumulated on each tick
+  unsigned macc_first[NUPOLS_MAX_TICKS];
+  unsigned macc_count[NUPOLS_MAX_TICKS];
+  // Which tick of the current block the next frame is
+  unsigned pos;
+  // Input block being filled by the foreground
+  int32_t* in_fill;
+  // Input block being transformed by the background thread
+  int32_t* in_work;
+  // Output block being consumed by the foreground
+  int32_t* out_ready;
+  exponent_t out_ready_exp;
+  // Output block being produced by the background thread
+  int32_t* out_work;
+  exponent_t out_work_exp;
+  // Foreground's end of the channel to the background thread
+  chanend_t c_tick;
+  // Background thread's end of the channel
+  chanend_t c_worker;
+} nupols_tail_t;
+
+
+/**
+ * Non-uniformly partitioned convolver.
+ *
+ * The impulse response is split into:
+ *  - a head, taps [0, F), applied in direct form with `filter_fir_s32()`
+ *  - a body, taps [F, 4F), applied by a UPOLS convolver with F-sample blocks
+ *    in the foreground
+ *  - tail segments, taps [4F, 8F) and [8F, tap_count), applied by UPOLS
+ *    convolvers with 2F- and 4F-sample blocks on background threads
+ *
+ * where F is the frame size.
+ */
+typedef struct {
+  unsigned frame_size;
+  // Direct-form head of the filter
+  filter_fir_s32_t head;
+  int32_t* head_state;
+  // Foreground UPOLS body. Its first partition duplicates the head and is
+  // skipped.
+  upols_t body;
+  unsigned body_active;
+  // Background tail segments
+  nupols_tail_t tail[NUPOLS_TAIL_SEGMENTS];
+  // Scratch frame for the body's output
+  int32_t* scratch;
+} nupols_t;
+
+
+/**
+ * Initialize a non-uniformly partitioned convolver.
+ *
+ * `coef[]` must remain valid for as long as the convolver is used, because the
+ * head filter uses it directly.
+ */
+void nupols_init(
+    nupols_t* conv,
+    const int32_t coef[],
+    const exponent_t coef_exp,
+    const unsigned tap_count,
+    const unsigned frame_size);
+
+/**
+ * Filter one frame of `frame_size` Q1.31 samples, producing one frame of Q1.31
+ * output samples.
+ *
+ * The tail segments' background threads must be running.
+ */
+void nupols_process(
+    nupols_t* conv,
+    int32_t frame_out[],
+    const int32_t frame_in[]);
+
+/**
+ * Thread entry point for a tail segment's background thread.
+ *
+ * Returns immediately if the segment is unused.
+ */
+DECLARE_JOB(nupols_tail_worker, (nupols_tail_t*));
+void nupols_tail_worker(
+    nupols_tail_t* tail);
@@ -0,0 +1,122 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include "common.h"
+#include "nupols.h"
+
+// Length of the impulse response applied by this stage. The first TAP_COUNT
+// taps are the usual filter coefficients and the remainder are zeros, so the
+// output can be compared against the other stages while all of the tail
+// segments are still exercised.
+#ifndef LONG_TAP_COUNT
+# define LONG_TAP_COUNT   (8 * TAP_COUNT)
+#endif
+
+extern 
+const q2_30 filter_coef[TAP_COUNT];
+
+// The full impulse response. The convolver's head filter uses it directly, so
+// it must outlive the convolver.
+static int32_t long_coef[LONG_TAP_COUNT];
+
+
+//// +rx_frame
+// Accept a frame of new audio data 
+static inline 
+void rx_frame(
+    int32_t buff[],
+    const chanend_t c_audio)
+{    
+  timer_start(TIMING_PHASE_RX);
+
+  frame_receive(c_audio, buff, FRAME_SIZE, NULL);
+
+  timer_start(TIMING_FRAME);
+
+  timer_stop(TIMING_PHASE_RX);
+}
+//// -rx_frame
+
+
+//// +tx_frame
+// Send a frame of new audio data
+static inline 
+void tx_frame(
+    const chanend_t c_audio,
+    const int32_t buff[])
+{    
+  timer_stop(TIMING_FRAME);
+  timer_start(TIMING_PHASE_TX);
+
+  frame_send(c_audio, buff, FRAME_SIZE, -31);
+  timer_stop(TIMING_PHASE_TX);
+}
+//// -tx_frame
+
+
+//// +filter_loop
+/**
+ * The foreground filter thread. Each frame it computes the head and body of
+ * the filter itself, while the tail segments' background threads each work on
+ * their current slice.
+ */
+DECLARE_JOB(filter_loop, (chanend_t, nupols_t*));
+void filter_loop(
+    chanend_t c_audio,
+    nupols_t* conv)
+{
+  // This buffer is where input samples will be placed.
+  int32_t frame_input[FRAME_SIZE] = {0};
+  // This buffer is where output samples will be placed.
+  int32_t frame_output[FRAME_SIZE] = {0};
+
+  // Loop forever
+  while(1) {
+
+    // Read in a new frame
+    rx_frame(&frame_input[0], 
+             c_audio);
+
+    // Calc output frame. The time for the whole frame is attributed to its
+    // FRAME_SIZE samples.
+    timer_start(TIMING_PHASE_COMPUTE);
+    timer_start(TIMING_SAMPLE);
+    nupols_process(conv, 
+                   &frame_output[0], 
+                   &frame_input[0]);
+    timer_stop_count(TIMING_SAMPLE, FRAME_SIZE);
+    timer_stop(TIMING_PHASE_COMPUTE);
+
+    // Send out the processed frame
+    tx_frame(c_audio, 
+             &frame_output[0]);
+  }
+}
+//// -filter_loop
+
+
+//// +filter_task
+/**
+ * This is the thread entry point for the hardware thread which will actually 
+ * be applying the FIR filter.
+ * 
+ * `c_audio` is the channel over which PCM audio data is exchanged with tile[0].
+ */
+void filter_task(
+    chanend_t c_audio)
+{
+  static nupols_t conv;
+
+  memcpy(&long_coef[0], &filter_coef[0], TAP_COUNT * sizeof(int32_t));
+
+  nupols_init(&conv, &long_coef[0], -30, LONG_TAP_COUNT, FRAME_SIZE);
+
+  // One thread for the foreground and one for each tail segment. None of them
+  // ever return.
+  PAR_JOBS(
+    PJOB(filter_loop, (c_audio, &conv)),
+    PJOB(nupols_tail_worker, (&conv.tail[0])),
+    PJOB(nupols_tail_worker, (&conv.tail[1]))
+  );
+}
+//// -filter_task
@@ -0,0 +1,290 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include "common.h"
+
+extern
+const q2_30 filter_coef[TAP_COUNT];
+
+// The sample history is split into segments of FRAME_SIZE samples, one per
+// received frame, each with its own exponent and headroom.
+#define SEGMENT_COUNT   (HISTORY_SIZE / FRAME_SIZE)
+
+
+// Represents the filter coefficients as a BFP vector
+struct {
+  int32_t* data;
+  exponent_t exp;
+  headroom_t hr;
+} filter_bfp = {(int32_t*) &filter_coef[0], -30, 10};
+
+
+//// +segmented_history_t
+// Sample history made up of SEGMENT_COUNT block floating-point segments.
+//
+// The samples are kept in a mirrored ring buffer whose slots are exactly one
+// frame long, so each slot is one segment. exp[] and hr[] are indexed by slot,
+// not by age; segment_slot() maps between the two.
+typedef struct {
+  history_t ring;                 // Sample data
+  exponent_t exp[SEGMENT_COUNT];  // Exponent of each segment
+  headroom_t hr[SEGMENT_COUNT];   // Headroom of each segment
+} segmented_history_t;
+//// -segmented_history_t
+
+
+// Get the slot holding the segment of the given age (0 is the newest)
+static inline
+unsigned segment_slot(
+    const segmented_history_t* history,
+    const unsigned age)
+{
+  return ((history->ring.head / FRAME_SIZE) + age) % SEGMENT_COUNT;
+}
+
+
+//// +calc_headroom
+// Compute headroom of int32 vector.
+static inline
+headroom_t calc_headroom(
+    const int32_t vec[],
+    const unsigned length)
+{
+  return vect_s32_headroom(vec, length);
+}
+//// -calc_headroom
+
+
+//// +rx_frame
+// Accept a frame of new audio data and add it to the history as a new segment
+static inline
+void rx_frame(
+    segmented_history_t* history,
+    const chanend_t c_audio)
+{
+  timer_start(TIMING_PHASE_RX);
+
+  int32_t samples[FRAME_SIZE];
+  exponent_t samples_exp;
+  frame_receive(c_audio, samples, FRAME_SIZE, &samples_exp);
+
+  // The new frame is written into the ring buffer in reverse order.
+  int32_t* frame_in = (int32_t*) history_next_frame(&history->ring);
+
+  for(int k = 0; k < FRAME_SIZE; k++)
+    frame_in[FRAME_SIZE-k-1] = samples[k];
+
+  timer_start(TIMING_FRAME);
+
+  timer_start(TIMING_HISTORY);
+  history_commit_frame(&history->ring);
+  timer_stop(TIMING_HISTORY);
+
+  // The new segment keeps the input exponent. No other segment is touched, no
+  // matter how much louder or quieter the new frame is.
+  const unsigned slot = segment_slot(history, 0);
+  history->exp[slot] = samples_exp;
+  history->hr[slot] = calc_headroom(frame_in, FRAME_SIZE);
+
+  timer_stop(TIMING_PHASE_RX);
+}
+//// -rx_frame
+
+
+//// +tx_frame
+// Send a frame of new audio data
+static inline
+void tx_frame(
+    const chanend_t c_audio,
+    const int32_t frame_out[],
+    const exponent_t frame_out_exp,
+    const headroom_t frame_out_hr,
+    const unsigned frame_size)
+{
+  const exponent_t output_exp = -31;
+
+  // The output channel is expecting PCM samples with a *fixed* exponent of
+  // output_exp, so we'll need to convert samples to use the correct exponent
+  // before sending.
+
+  const right_shift_t samp_shr = output_exp - frame_out_exp;
+
+  timer_stop(TIMING_FRAME);
+  timer_start(TIMING_PHASE_TX);
+
+  int32_t samples[FRAME_SIZE];
+  for(int k = 0; k < frame_size; k++){
+    int32_t sample = frame_out[k];
+    sample = ashr32(sample, samp_shr);
+    samples[k] = sample;
+  }
+
+  frame_send(c_audio, samples, frame_size, output_exp);
+  timer_stop(TIMING_PHASE_TX);
+}
+//// -tx_frame
+
+
+//// +filter_sample
+// Compute a single element's contribution to
+// vect_s32_dot(b, c, 1, b_shr, c_shr) without calling it. Each sample and
+// coefficient is shifted as the VPU shifts it, and the product is rounded to a
+// 30-bit right shift, as VLMACCR does.
+static inline
+int64_t dot_one(
+    const int32_t b,
+    const int32_t c,
+    const right_shift_t b_shr,
+    const right_shift_t c_shr)
+{
+  const int64_t prod = ((int64_t) ashr32(b, b_shr)) * ashr32(c, c_shr);
+  return (prod + (1 << 29)) >> 30;
+}
+
+
+// Apply the filter to produce a single output sample.
+//
+// The TAP_COUNT-sample window for output sample s overlaps (up to)
+// SEGMENT_COUNT segments. A partial dot product is computed for each segment
+// using that segment's shifts, and the partial results are added as float_s64_t
+// values. The sum starts out with exponent acc_exp, the largest of the segment
+// exponents, so that each partial result is shifted only once.
+//
+// A segment which the window overlaps by only one sample (the newest segment
+// for s = 0, and the oldest for s = FRAME_SIZE-2) isn't worth a call to
+// vect_s32_dot(), so its single product is computed directly.
+float_s64_t filter_sample(
+    const int32_t window[],
+    const unsigned s,
+    const right_shift_t b_shr[SEGMENT_COUNT],
+    const right_shift_t c_shr[SEGMENT_COUNT],
+    const exponent_t seg_exp[SEGMENT_COUNT],
+    const exponent_t acc_exp)
+{
+  // The window starts part way through the newest segment.
+  const unsigned offset = FRAME_SIZE-s-1;
+
+  float_s64_t acc = {0, acc_exp};
+  unsigned tap = 0;
+  for(int seg = 0; seg < SEGMENT_COUNT; seg++){
+    const unsigned seg_end = MIN((seg+1) * FRAME_SIZE - offset, TAP_COUNT);
+    const unsigned len = seg_end - tap;
+    if(len){
+      float_s64_t partial = {0, seg_exp[seg]};
+      if(len == 1)
+        partial.mant = dot_one(window[offset + tap], filter_bfp.data[tap],
+                               b_shr[seg], c_shr[seg]);
+      else
+        partial.mant = vect_s32_dot(&window[offset + tap],
+                                    &filter_bfp.data[tap], len,
+                                    b_shr[seg], c_shr[seg]);
+      acc = float_s64_add(acc, partial);
+    }
+    tap = seg_end;
+  }
+  return acc;
+}
+//// -filter_sample
+
+
+//// +filter_frame
+// Calculate entire output frame
+void filter_frame(
+    int32_t frame_out[FRAME_SIZE],
+    exponent_t* frame_out_exp,
+    headroom_t* frame_out_hr,
+    const segmented_history_t* history)
+{
+  const int32_t* window = (const int32_t*) history_window(&history->ring);
+
+  // Determine the shifts and result exponent of each segment's partial dot
+  // product. Preparing each one as though it were TAP_COUNT elements long
+  // ensures the sum of all the partial results still fits in the 40-bit
+  // accumulator range.
+  right_shift_t b_shr[SEGMENT_COUNT];
+  right_shift_t c_shr[SEGMENT_COUNT];
+  exponent_t seg_exp[SEGMENT_COUNT];
+  exponent_t acc_exp = INT32_MIN;
+
+  for(int seg = 0; seg < SEGMENT_COUNT; seg++){
+    const unsigned slot = segment_slot(history, seg);
+    vect_s32_dot_prepare(&seg_exp[seg], &b_shr[seg], &c_shr[seg],
+                         history->exp[slot], filter_bfp.exp,
+                         history->hr[slot], filter_bfp.hr,
+                         TAP_COUNT);
+    acc_exp = MAX(acc_exp, seg_exp[seg]);
+  }
+
+  // vect_s32_dot_prepare() ensures the result doesn't overflow the 40-bit VPU
+  // accumulators, but we need it in a 32-bit value.
+  right_shift_t s_shr = 8;
+  *frame_out_exp = acc_exp + s_shr;
+
+  // Compute FRAME_SIZE output samples.
+  for(int s = 0; s < FRAME_SIZE; s++){
+    timer_start(TIMING_SAMPLE);
+    float_s64_t samp = filter_sample(window, s, b_shr, c_shr, seg_exp,
+                                     acc_exp);
+    frame_out[s] = float_s64_to_fixed(samp, *frame_out_exp);
+    timer_stop(TIMING_SAMPLE);
+  }
+
+  //Finally, calculate the headroom of the output frame.
+  *frame_out_hr = calc_headroom(frame_out, FRAME_SIZE);
+}
+//// -filter_frame
+
+
+//// +filter_task
+/**
+ * This is the thread entry point for the hardware thread which will actually
+ * be applying the FIR filter.
+ *
+ * `c_audio` is the channel over which PCM audio data is exchanged with tile[0].
+ */
+void filter_task(
+    chanend_t c_audio)
+{
+  // Storage for the sample history's mirrored ring buffer
+  static int32_t history_buff[HISTORY_BUFFER_LENGTH(HISTORY_SIZE)];
+
+  // The sample history starts out silent.
+  segmented_history_t sample_history;
+  history_init(&sample_history.ring, &history_buff[0], HISTORY_SIZE,
+               FRAME_SIZE, sizeof(int32_t));
+  for(int k = 0; k < SEGMENT_COUNT; k++){
+    sample_history.exp[k] = -31;
+    sample_history.hr[k] = 31;
+  }
+
+  // Represents output frame as a BFP vector
+  struct {
+    int32_t data[FRAME_SIZE];   // Sample data
+    exponent_t exp;             // Exponent
+    headroom_t hr;              // Headroom
+  } frame_output;
+
+  // Loop forever
+  while(1) {
+
+    // Read in a new frame
+    rx_frame(&sample_history,
+             c_audio);
+
+    // Calc output frame
+    timer_start(TIMING_PHASE_COMPUTE);
+    filter_frame(&frame_output.data[0],
+                 &frame_output.exp,
+                 &frame_output.hr,
+                 &sample_history);
+    timer_stop(TIMING_PHASE_COMPUTE);
+
+    // Send out the processed frame
+    tx_frame(c_audio,
+             &frame_output.data[0],
+             frame_output.exp,
+             frame_output.hr,
+             FRAME_SIZE);
+  }
+}
+//// -filter_task
@@ -0,0 +1,385 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include "common.h"
+#include "pool.h"
+
+// The number of threads used for the reported sample and frame times. With
+// THREAD_SWEEP enabled, frames are also processed with every other thread
+// count from 1 to POOL_MAX_THREADS, and the frame time of each is reported.
+// Both are set when building (see CMakeLists.txt). tile[1] has no command line,
+// so the count can't be chosen when the stage is run, but pool_run() takes it
+// for each frame, which is how the sweep changes it.
+#ifndef THREADS
+# define THREADS        (POOL_MAX_THREADS)
+#endif
+
+#ifndef THREAD_SWEEP
+# define THREAD_SWEEP   (1)
+#endif
+
+// Number of consecutive frames processed with each thread count while sweeping
+#define SWEEP_FRAMES          (8)
+
+// The first frames processed with each thread count while sweeping, which are
+// left out of its timing. Workers which weren't used for the previous frames
+// (and their code and data) need a frame or two to warm up.
+#define SWEEP_WARMUP_FRAMES   (2)
+
+extern 
+const q2_30 filter_coef[TAP_COUNT];
+
+
+// Represents the filter coefficients as a BFP vector
+struct {
+  int32_t* data;
+  exponent_t exp;
+  headroom_t hr; 
+} filter_bfp = {(int32_t*) &filter_coef[0], -30, 10};
+
+
+//// +calc_headroom
+// Compute headroom of int32 vector.
+static inline
+headroom_t calc_headroom(
+    const int32_t vec[],
+    const unsigned length)
+{
+  return vect_s32_headroom(vec, length);
+}
+//// -calc_headroom
+
+
+//// +rx_frame
+// Accept a frame of new audio data 
+static inline 
+void rx_frame(
+    int32_t frame_in[FRAME_SIZE],
+    exponent_t* frame_in_exp,
+    headroom_t* frame_in_hr,
+    const chanend_t c_audio)
+{
+  timer_start(TIMING_PHASE_RX);
+
+  // The exponent of the incoming samples is sent along with them, so there's
+  // no need to assume one.
+  frame_receive(c_audio, frame_in, FRAME_SIZE, frame_in_exp);
+
+  timer_start(TIMING_FRAME);
+  
+  // Make sure the headroom is correct
+  calc_headroom(frame_in, FRAME_SIZE);
+
+  timer_stop(TIMING_PHASE_RX);
+}
+//// -rx_frame
+
+
+//// +rx_and_merge_frame
+// Accept a frame of new audio data and merge it into sample_history
+static inline 
+void rx_and_merge_frame(
+    history_t* sample_history,
+    exponent_t* sample_history_exp,
+    headroom_t* sample_history_hr,
+    const chanend_t c_audio)
+{
+  // BFP vector into which new frame will be placed.
+  struct {
+    int32_t data[FRAME_SIZE];   // Sample data
+    exponent_t exp;             // Exponent
+    headroom_t hr;              // Headroom
+  } frame_in = {{0},0,0};
+
+  // Accept a new input frame
+  rx_frame(frame_in.data, 
+           &frame_in.exp, 
+           &frame_in.hr, 
+           c_audio);
+
+  timer_start(TIMING_PHASE_RESCALE);
+  // Rescale BFP vectors if needed so they can be merged
+  const exponent_t min_frame_in_exp = frame_in.exp - frame_in.hr;
+  const exponent_t min_history_exp = *sample_history_exp - *sample_history_hr;
+  const exponent_t new_exp = MAX(min_frame_in_exp, min_history_exp);
+
+  const right_shift_t hist_shr = new_exp - *sample_history_exp;
+  const right_shift_t frame_in_shr = new_exp - frame_in.exp;
+
+  // Both copies of every sample in the ring buffer must be rescaled.
+  if(hist_shr) {
+    vect_s32_shr((int32_t*) sample_history->data, 
+                 (int32_t*) sample_history->data, 
+                 history_buffer_length(sample_history),
+                 hist_shr);
+    *sample_history_exp = new_exp;
+  }
+
+  if(frame_in_shr){
+    vect_s32_shr(&frame_in.data[0],
+                 &frame_in.data[0],
+                 FRAME_SIZE,
+                 frame_in_shr);
+  }
+  
+  timer_stop(TIMING_PHASE_RESCALE);
+
+  // Now we can merge the new frame in (reversing order)
+  int32_t* next_frame = (int32_t*) history_next_frame(sample_history);
+  for(int k = 0; k < FRAME_SIZE; k++)
+    next_frame[FRAME_SIZE-k-1] = frame_in.data[k];
+
+  timer_start(TIMING_HISTORY);
+  history_commit_frame(sample_history);
+  timer_stop(TIMING_HISTORY);
+
+  // And just ensure the headroom is correct
+  *sample_history_hr = calc_headroom(
+      (int32_t*) history_window(sample_history), HISTORY_SIZE);
+}
+//// -rx_and_merge_frame
+
+
+//// +tx_frame
+// Send a frame of new audio data
+static inline 
+void tx_frame(
+    const chanend_t c_audio,
+    const int32_t frame_out[],
+    const exponent_t frame_out_exp,
+    const headroom_t frame_out_hr,
+    const unsigned frame_size,
+    const unsigned threads,
+    const unsigned timed)
+{
+  const exponent_t output_exp = -31;
+  
+  // The output channel is expecting PCM samples with a *fixed* exponent of
+  // output_exp, so we'll need to convert samples to use the correct exponent
+  // before sending.
+
+  const right_shift_t samp_shr = output_exp - frame_out_exp;  
+
+  // Only frames computed with THREADS threads count towards the frame time, and
+  // not the warm-up frames of each sweep block.
+  if(timed && threads == THREADS){
+    timer_stop(TIMING_FRAME);
+  }
+  timer_start(TIMING_PHASE_TX);
+
+  int32_t samples[FRAME_SIZE];
+  for(int k = 0; k < frame_size; k++){
+    int32_t sample = frame_out[k];
+    sample = ashr32(sample, samp_shr);
+    samples[k] = sample;
+  }
+
+  frame_send(c_audio, samples, frame_size, output_exp);
+  timer_stop(TIMING_PHASE_TX);
+}
+//// -tx_frame
+
+
+//// +filter_sample
+// Apply the filter to produce a single output sample.
+int64_t filter_sample(
+    const int32_t sample_history[TAP_COUNT],
+    const right_shift_t b_shr,
+    const right_shift_t c_shr)
+{
+  // Compute the inner product's mantissa using the given shift parameters.
+  return vect_s32_dot(&sample_history[0], 
+                      &filter_bfp.data[0], TAP_COUNT,
+                      b_shr, c_shr);
+}
+//// -filter_sample
+
+
+//// +filter_frame
+// The parameters shared by every thread working on a frame
+typedef struct {
+  int32_t* frame_out;
+  const int32_t* history_in;
+  right_shift_t b_shr;
+  right_shift_t c_shr;
+  right_shift_t s_shr;
+} frame_job_t;
+
+
+// Compute one thread's share of the output frame. Each thread owns a
+// contiguous slice of the frame.
+static
+void filter_slice(
+    void* ctx,
+    unsigned index,
+    unsigned count)
+{
+  const frame_job_t* job = (const frame_job_t*) ctx;
+
+  const unsigned first = (index * FRAME_SIZE) / count;
+  const unsigned end = ((index + 1) * FRAME_SIZE) / count;
+
+  for(int s = first; s < end; s++){
+    job->frame_out[s] = sat32(
+      ashr64(filter_sample(&job->history_in[FRAME_SIZE-s-1], 
+                           job->b_shr, 
+                           job->c_shr), 
+             job->s_shr));
+  }
+}
+
+
+// Calculate entire output frame
+void filter_frame(
+    pool_t* pool,
+    const unsigned threads,
+    int32_t frame_out[FRAME_SIZE],
+    exponent_t* frame_out_exp,
+    headroom_t* frame_out_hr,
+    const int32_t history_in[HISTORY_SIZE],
+    const exponent_t history_in_exp,
+    const headroom_t history_in_hr)
+{
+  frame_job_t job;
+  job.frame_out = frame_out;
+  job.history_in = history_in;
+
+  // First, determine output exponent and required shifts.
+  vect_s32_dot_prepare(frame_out_exp, &job.b_shr, &job.c_shr, 
+                       history_in_exp, filter_bfp.exp,
+                       history_in_hr, filter_bfp.hr, 
+                       TAP_COUNT);
+  // vect_s32_dot_prepare() ensures the result doesn't overflow the 40-bit VPU
+  // accumulators, but we need it in a 32-bit value.
+  job.s_shr = 8;
+  *frame_out_exp += job.s_shr;
+
+  // Compute FRAME_SIZE output samples, using one fork and one join.
+  pool_run(pool, filter_slice, &job, threads);
+
+  //Finally, calculate the headroom of the output frame.
+  *frame_out_hr = calc_headroom(frame_out, FRAME_SIZE);
+}
+//// -filter_frame
+
+
+//// +filter_loop
+/**
+ * The thread which receives, filters and sends each frame, using the pool's
+ * workers to help compute each output frame.
+ */
+DECLARE_JOB(filter_loop, (chanend_t, pool_t*));
+void filter_loop(
+    chanend_t c_audio,
+    pool_t* pool)
+{
+  // Storage for the sample history's mirrored ring buffer
+  static int32_t history_buff[HISTORY_BUFFER_LENGTH(HISTORY_SIZE)];
+
+  // Represents the sample history as a BFP vector
+  struct {
+    history_t data;             // Sample data
+    exponent_t exp;             // Exponent
+    headroom_t hr;              // Headroom
+  } sample_history = {{0},-200,0};
+
+  history_init(&sample_history.data, &history_buff[0], HISTORY_SIZE, 
+               FRAME_SIZE, sizeof(int32_t));
+
+  // Represents output frame as a BFP vector
+  struct {
+    int32_t data[FRAME_SIZE];   // Sample data
+    exponent_t exp;             // Exponent
+    headroom_t hr;              // Headroom
+  } frame_output;
+
+  // Average time taken by filter_frame() with each thread count, in ns.
+  // Element k is for (k+1) threads.
+  static float frame_time_by_threads[POOL_MAX_THREADS] = {0};
+  uint64_t total_ticks[POOL_MAX_THREADS] = {0};
+  unsigned frame_count[POOL_MAX_THREADS] = {0};
+  timer_report_series("frame_time_by_threads", 
+                      &frame_time_by_threads[0], POOL_MAX_THREADS);
+
+  unsigned frame_index = 0;
+
+  // Loop forever
+  while(1) {
+
+    // The number of threads used for this frame
+    const unsigned threads = THREAD_SWEEP? 
+        (1 + (frame_index / SWEEP_FRAMES) % POOL_MAX_THREADS) : THREADS;
+    // Whether this frame's time counts towards its thread count's figures
+    const unsigned timed = !THREAD_SWEEP || 
+        ((frame_index % SWEEP_FRAMES) >= SWEEP_WARMUP_FRAMES);
+    frame_index++;
+
+    // Read in a new frame
+    rx_and_merge_frame(&sample_history.data, 
+                       &sample_history.exp,
+                       &sample_history.hr, 
+                       c_audio);
+
+    // Calc output frame. The whole frame is timed, so that the cost of handing
+    // work to the pool is included, and attributed to its FRAME_SIZE samples.
+    timer_start(TIMING_PHASE_COMPUTE);
+    const uint32_t t0 = get_reference_time();
+    timer_start(TIMING_SAMPLE);
+    filter_frame(pool, threads,
+                 &frame_output.data[0], 
+                 &frame_output.exp, 
+                 &frame_output.hr,
+                 (int32_t*) history_window(&sample_history.data), 
+                 sample_history.exp, 
+                 sample_history.hr);
+    if(timed && threads == THREADS)
+      timer_stop_count(TIMING_SAMPLE, FRAME_SIZE);
+    timer_stop(TIMING_PHASE_COMPUTE);
+    const uint32_t ticks = get_reference_time() - t0;
+
+    // reference clock freq is 100 MHz, so 1 tick is 10 ns
+    if(timed){
+      total_ticks[threads-1] += ticks;
+      frame_count[threads-1]++;
+      frame_time_by_threads[threads-1] = 
+          (10.0f * total_ticks[threads-1]) / frame_count[threads-1];
+    }
+
+    // Send out the processed frame
+    tx_frame(c_audio, 
+             &frame_output.data[0], 
+             frame_output.exp, 
+             frame_output.hr, 
+             FRAME_SIZE,
+             threads,
+             timed);
+  }
+}
+//// -filter_loop
+
+
+//// +filter_task
+/**
+ * This is the thread entry point for the hardware thread which will actually 
+ * be applying the FIR filter.
+ * 
+ * `c_audio` is the channel over which PCM audio data is exchanged with tile[0].
+ */
+void filter_task(
+    chanend_t c_audio)
+{
+  static pool_t pool;
+  pool_init(&pool, POOL_MAX_WORKERS);
+
+  // The filter loop and the pool's workers are started once, and never return.
+  PAR_JOBS(
+    PJOB(filter_loop, (c_audio, &pool)),
+    PJOB(pool_worker, (&pool, 0)),
+    PJOB(pool_worker, (&pool, 1)),
+    PJOB(pool_worker, (&pool, 2)),
+    PJOB(pool_worker, (&pool, 3)),
+    PJOB(pool_worker, (&pool, 4)),
+    PJOB(pool_worker, (&pool, 5))
+  );
+}
+//// -filter_task
@@ -0,0 +1,385 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include "common.h"
+#include "pool.h"
+
+// The number of threads across which each output sample's taps are split
+#ifndef TAP_SPLIT
+# define TAP_SPLIT        (4)
+#endif
+
+// When non-zero, each output sample is also computed with a single
+// vect_s32_dot() call (outside of the timed region), and any output which
+// differs is counted and reported as "bit_exact_mismatches".
+#ifndef VERIFY_BIT_EXACT
+# define VERIFY_BIT_EXACT (0)
+#endif
+
+extern 
+const q2_30 filter_coef[TAP_COUNT];
+
+
+// Represents the filter coefficients as a BFP vector
+struct {
+  int32_t* data;
+  exponent_t exp;
+  headroom_t hr; 
+} filter_bfp = {(int32_t*) &filter_coef[0], -30, 10};
+
+
+//// +calc_headroom
+// Compute headroom of int32 vector.
+static inline
+headroom_t calc_headroom(
+    const int32_t vec[],
+    const unsigned length)
+{
+  return vect_s32_headroom(vec, length);
+}
+//// -calc_headroom
+
+
+//// +rx_frame
+// Accept a frame of new audio data 
+static inline 
+void rx_frame(
+    int32_t frame_in[FRAME_SIZE],
+    exponent_t* frame_in_exp,
+    headroom_t* frame_in_hr,
+    const chanend_t c_audio)
+{
+  timer_start(TIMING_PHASE_RX);
+
+  // The exponent of the incoming samples is sent along with them, so there's
+  // no need to assume one.
+  frame_receive(c_audio, frame_in, FRAME_SIZE, frame_in_exp);
+
+  timer_start(TIMING_FRAME);
+  
+  // Make sure the headroom is correct
+  calc_headroom(frame_in, FRAME_SIZE);
+
+  timer_stop(TIMING_PHASE_RX);
+}
+//// -rx_frame
+
+
+//// +rx_and_merge_frame
+// Accept a frame of new audio data and merge it into sample_history
+static inline 
+void rx_and_merge_frame(
+    history_t* sample_history,
+    exponent_t* sample_history_exp,
+    headroom_t* sample_history_hr,
+    const chanend_t c_audio)
+{
+  // BFP vector into which new frame will be placed.
+  struct {
+    int32_t data[FRAME_SIZE];   // Sample data
+    exponent_t exp;             // Exponent
+    headroom_t hr;              // Headroom
+  } frame_in = {{0},0,0};
+
+  // Accept a new input frame
+  rx_frame(frame_in.data, 
+           &frame_in.exp, 
+           &frame_in.hr, 
+           c_audio);
+
+  timer_start(TIMING_PHASE_RESCALE);
+  // Rescale BFP vectors if needed so they can be merged
+  const exponent_t min_frame_in_exp = frame_in.exp - frame_in.hr;
+  const exponent_t min_history_exp = *sample_history_exp - *sample_history_hr;
+  const exponent_t new_exp = MAX(min_frame_in_exp, min_history_exp);
+
+  const right_shift_t hist_shr = new_exp - *sample_history_exp;
+  const right_shift_t frame_in_shr = new_exp - frame_in.exp;
+
+  // Both copies of every sample in the ring buffer must be rescaled.
+  if(hist_shr) {
+    vect_s32_shr((int32_t*) sample_history->data, 
+                 (int32_t*) sample_history->data, 
+                 history_buffer_length(sample_history),
+                 hist_shr);
+    *sample_history_exp = new_exp;
+  }
+
+  if(frame_in_shr){
+    vect_s32_shr(&frame_in.data[0],
+                 &frame_in.data[0],
+                 FRAME_SIZE,
+                 frame_in_shr);
+  }
+  
+  timer_stop(TIMING_PHASE_RESCALE);
+
+  // Now we can merge the new frame in (reversing order)
+  int32_t* next_frame = (int32_t*) history_next_frame(sample_history);
+  for(int k = 0; k < FRAME_SIZE; k++)
+    next_frame[FRAME_SIZE-k-1] = frame_in.data[k];
+
+  timer_start(TIMING_HISTORY);
+  history_commit_frame(sample_history);
+  timer_stop(TIMING_HISTORY);
+
+  // And just ensure the headroom is correct
+  *sample_history_hr = calc_headroom(
+      (int32_t*) history_window(sample_history), HISTORY_SIZE);
+}
+//// -rx_and_merge_frame
+
+
+//// +tx_frame
+// Send a frame of new audio data
+static inline 
+void tx_frame(
+    const chanend_t c_audio,
+    const int32_t frame_out[],
+    const exponent_t frame_out_exp,
+    const headroom_t frame_out_hr,
+    const unsigned frame_size)
+{
+  const exponent_t output_exp = -31;
+  
+  // The output channel is expecting PCM samples with a *fixed* exponent of
+  // output_exp, so we'll need to convert samples to use the correct exponent
+  // before sending.
+
+  const right_shift_t samp_shr = output_exp - frame_out_exp;  
+
+  timer_stop(TIMING_FRAME);
+  timer_start(TIMING_PHASE_TX);
+
+  int32_t samples[FRAME_SIZE];
+  for(int k = 0; k < frame_size; k++){
+    int32_t sample = frame_out[k];
+    sample = ashr32(sample, samp_shr);
+    samples[k] = sample;
+  }
+
+  frame_send(c_audio, samples, frame_size, output_exp);
+  timer_stop(TIMING_PHASE_TX);
+}
+//// -tx_frame
+
+
+//// +filter_sample
+// Apply the filter to produce a single output sample.
+int64_t filter_sample(
+    const int32_t sample_history[TAP_COUNT],
+    const right_shift_t b_shr,
+    const right_shift_t c_shr)
+{
+  // Compute the inner product's mantissa using the given shift parameters.
+  return vect_s32_dot(&sample_history[0], 
+                      &filter_bfp.data[0], TAP_COUNT,
+                      b_shr, c_shr);
+}
+//// -filter_sample
+
+
+//// +filter_frame
+// The parameters shared by every thread working on an output sample
+typedef struct {
+  const int32_t* history;
+  right_shift_t b_shr;
+  right_shift_t c_shr;
+  // The first tap of each thread's chunk. chunk_start[TAP_SPLIT] is TAP_COUNT.
+  unsigned chunk_start[TAP_SPLIT + 1];
+  // Each thread's partial result
+  int64_t partial[TAP_SPLIT];
+} sample_job_t;
+
+
+// Compute one thread's partial dot product for the current output sample.
+static
+void filter_chunk(
+    void* ctx,
+    unsigned index,
+    unsigned count)
+{
+  sample_job_t* job = (sample_job_t*) ctx;
+
+  const unsigned first = job->chunk_start[index];
+  const unsigned len = job->chunk_start[index+1] - first;
+
+  job->partial[index] = vect_s32_dot(&job->history[first], 
+                                     &filter_bfp.data[first], len,
+                                     job->b_shr, job->c_shr);
+}
+
+
+// Calculate entire output frame
+void filter_frame(
+    pool_t* pool,
+    int32_t frame_out[FRAME_SIZE],
+    exponent_t* frame_out_exp,
+    headroom_t* frame_out_hr,
+    const int32_t history_in[HISTORY_SIZE],
+    const exponent_t history_in_exp,
+    const headroom_t history_in_hr,
+    unsigned* mismatches)
+{
+  static sample_job_t job;
+
+  // Chunk boundaries are kept on multiples of 8 taps, the number of elements
+  // processed by each VPU instruction.
+  for(int k = 0; k <= TAP_SPLIT; k++)
+    job.chunk_start[k] = ((k * (TAP_COUNT / 8)) / TAP_SPLIT) * 8;
+
+  // First, determine output exponent and required shifts. Every chunk uses the
+  // same shifts, so each element's product is exactly what a single
+  // vect_s32_dot() call over all TAP_COUNT taps would compute, and the
+  // partial results can simply be added.
+  vect_s32_dot_prepare(frame_out_exp, &job.b_shr, &job.c_shr, 
+                       history_in_exp, filter_bfp.exp,
+                       history_in_hr, filter_bfp.hr, 
+                       TAP_COUNT);
+  // vect_s32_dot_prepare() ensures the result doesn't overflow the 40-bit VPU
+  // accumulators, but we need it in a 32-bit value.
+  right_shift_t s_shr = 8;
+  *frame_out_exp += s_shr;
+
+  // Compute FRAME_SIZE output samples, each split across TAP_SPLIT threads.
+  for(int s = 0; s < FRAME_SIZE; s++){
+    timer_start(TIMING_SAMPLE);
+    job.history = &history_in[FRAME_SIZE-s-1];
+    pool_run(pool, filter_chunk, &job, TAP_SPLIT);
+
+    // The partial results are always added in the same order, so the result
+    // doesn't depend on which thread finishes first.
+    int64_t samp = 0;
+    for(int k = 0; k < TAP_SPLIT; k++)
+      samp += job.partial[k];
+    frame_out[s] = sat32(ashr64(samp, s_shr));
+    timer_stop(TIMING_SAMPLE);
+
+    if(VERIFY_BIT_EXACT){
+      int64_t ref = vect_s32_dot(&history_in[FRAME_SIZE-s-1], 
+                                 &filter_bfp.data[0], TAP_COUNT,
+                                 job.b_shr, job.c_shr);
+      if(sat32(ashr64(ref, s_shr)) != frame_out[s])
+        (*mismatches)++;
+    }
+  }
+
+  //Finally, calculate the headroom of the output frame.
+  *frame_out_hr = calc_headroom(frame_out, FRAME_SIZE);
+}
+//// -filter_frame
+
+
+//// +filter_loop
+/**
+ * The thread which receives, filters and sends each frame, using the pool's
+ * workers to help compute each output sample.
+ */
+DECLARE_JOB(filter_loop, (chanend_t, pool_t*));
+void filter_loop(
+    chanend_t c_audio,
+    pool_t* pool)
+{
+  // Storage for the sample history's mirrored ring buffer
+  static int32_t history_buff[HISTORY_BUFFER_LENGTH(HISTORY_SIZE)];
+
+  // Represents the sample history as a BFP vector
+  struct {
+    history_t data;             // Sample data
+    exponent_t exp;             // Exponent
+    headroom_t hr;              // Headroom
+  } sample_history = {{0},-200,0};
+
+  history_init(&sample_history.data, &history_buff[0], HISTORY_SIZE, 
+               FRAME_SIZE, sizeof(int32_t));
+
+  // Represents output frame as a BFP vector
+  struct {
+    int32_t data[FRAME_SIZE];   // Sample data
+    exponent_t exp;             // Exponent
+    headroom_t hr;              // Headroom
+  } frame_output;
+
+  // The sample time measures the latency of each output sample. Throughput is
+  // reported separately, as output samples per second over whole frames
+  // (including receiving and sending them).
+  static float throughput = 0.0f;
+  timer_report_series("throughput", &throughput, 1);
+
+  static float mismatch_count = 0.0f;
+  unsigned mismatches = 0;
+  if(VERIFY_BIT_EXACT)
+    timer_report_series("bit_exact_mismatches", &mismatch_count, 1);
+
+  uint64_t total_ticks = 0;
+  unsigned frame_count = 0;
+  uint32_t t_last = 0;
+
+  // Loop forever
+  while(1) {
+
+    // Read in a new frame
+    rx_and_merge_frame(&sample_history.data, 
+                       &sample_history.exp,
+                       &sample_history.hr, 
+                       c_audio);
+
+    // Calc output frame
+    timer_start(TIMING_PHASE_COMPUTE);
+    filter_frame(pool,
+                 &frame_output.data[0], 
+                 &frame_output.exp, 
+                 &frame_output.hr,
+                 (int32_t*) history_window(&sample_history.data), 
+                 sample_history.exp, 
+                 sample_history.hr,
+                 &mismatches);
+    mismatch_count = mismatches;
+    timer_stop(TIMING_PHASE_COMPUTE);
+
+    // Send out the processed frame
+    tx_frame(c_audio, 
+             &frame_output.data[0], 
+             frame_output.exp, 
+             frame_output.hr, 
+             FRAME_SIZE);
+
+    // Time from one frame being sent to the next. The first interval includes
+    // start-up, so it isn't counted. Reference clock freq is 100 MHz.
+    const uint32_t t_now = get_reference_time();
+    if(frame_count++){
+      total_ticks += t_now - t_last;
+      throughput = (100.0e6f * FRAME_SIZE * (frame_count - 1)) / total_ticks;
+    }
+    t_last = t_now;
+  }
+}
+//// -filter_loop
+
+
+//// +filter_task
+/**
+ * This is the thread entry point for the hardware thread which will actually 
+ * be applying the FIR filter.
+ * 
+ * `c_audio` is the channel over which PCM audio data is exchanged with tile[0].
+ */
+void filter_task(
+    chanend_t c_audio)
+{
+  static pool_t pool;
+  pool_init(&pool, TAP_SPLIT - 1);
+
+  // The filter loop and the pool's workers are started once, and never return.
+  // Workers beyond the TAP_SPLIT-1 in use return immediately.
+  PAR_JOBS(
+    PJOB(filter_loop, (c_audio, &pool)),
+    PJOB(pool_worker, (&pool, 0)),
+    PJOB(pool_worker, (&pool, 1)),
+    PJOB(pool_worker, (&pool, 2)),
+    PJOB(pool_worker, (&pool, 3)),
+    PJOB(pool_worker, (&pool, 4)),
+    PJOB(pool_worker, (&pool, 5))
+  );
+}
+//// -filter_task
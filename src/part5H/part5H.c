@@ -0,0 +1,103 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include "common.h"
+#include "frame_pipeline.h"
+
+#if USE_USER_FILTER
+/**
+ * The files userFilter.c and userFilter.h were generated using one of the FIR
+ * filter conversion scripts from lib_xcore_math. (See Part 4C)
+ */
+# include "userFilter.h"
+#else
+// The box filter coefficient array.
+extern 
+const q2_30 filter_coef[TAP_COUNT];
+#endif
+
+
+#if !USE_USER_FILTER
+// Buffer used to hold filter state
+static int32_t filter_state[TAP_COUNT] = {0};
+
+// The filter object itself
+static filter_fir_s32_t fir_filter;
+#endif
+
+
+//// +filter_init
+// Initialize the filter, exactly as in Part 4B or Part 4C.
+static
+void filter_init()
+{
+#if USE_USER_FILTER
+  userFilter_init();
+
+  // If userFilter_exp_diff is not 0, the results will be wrong.
+  assert(userFilter_exp_diff == 0);
+#else
+  // Input and output samples are Q1.31 and coefficients Q2.30, so the
+  // accumulator shift works out to 0. (See Part 4B)
+  const exponent_t input_exp = -31;
+  const exponent_t output_exp = -31;
+  const exponent_t coef_exp = -30;
+  const right_shift_t vpu_shr = 30;
+  const exponent_t acc_exp = input_exp + coef_exp + vpu_shr;
+  const right_shift_t acc_shr = output_exp - acc_exp;
+
+  filter_fir_s32_init(&fir_filter, 
+                      &filter_state[0], 
+                      TAP_COUNT, 
+                      &filter_coef[0], 
+                      acc_shr);
+#endif
+}
+//// -filter_init
+
+
+//// +filter_frame
+// Filter one frame in-place. This is called by the pipeline's compute thread.
+static
+void filter_frame(
+    void* ctx,
+    int32_t sample_buffer[FRAME_SIZE])
+{
+  for(int s = 0; s < FRAME_SIZE; s++){
+    timer_start(TIMING_SAMPLE);
+#if USE_USER_FILTER
+    sample_buffer[s] = userFilter(sample_buffer[s]);
+#else
+    sample_buffer[s] = filter_fir_s32(&fir_filter, 
+                                      sample_buffer[s]);
+#endif
+    timer_stop(TIMING_SAMPLE);
+  }
+}
+//// -filter_frame
+
+
+//// +filter_task
+/**
+ * This is the thread entry point for the hardware thread which will actually 
+ * be applying the FIR filter.
+ * 
+ * `c_audio_in` and `c_audio_out` are the channels over which PCM audio data is
+ * received from and sent to tile[0].
+ */
+void filter_task(
+    chanend_t c_audio_in,
+    chanend_t c_audio_out)
+{
+  static frame_pipeline_t pipeline;
+
+  filter_init();
+
+  // Receiving, filtering and sending each happen on their own thread.
+  frame_pipeline_run(&pipeline, 
+                     c_audio_in, 
+                     c_audio_out, 
+                     filter_frame, 
+                     NULL);
+}
+//// -filter_task
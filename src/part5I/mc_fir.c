@@ -0,0 +1,289 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "mc_fir.h"
+#include "misc_func.h"
+
+
+mc_fir_layout_e mc_fir_choose_layout(
+    const unsigned channel_count,
+    const unsigned tap_count)
+{
+  // Lanes left empty in the last group do no useful work, so the tap count is
+  // scaled up by the fraction of lanes which are wasted.
+  const unsigned lanes = MC_FIR_GROUPS(channel_count) * MC_FIR_LANES;
+  return (tap_count * lanes <= MC_FIR_CROSSOVER_TAPS * channel_count)? 
+      MC_FIR_LAYOUT_CHANNELS : MC_FIR_LAYOUT_TAPS;
+}
+
+
+void mc_fir_init(
+    mc_fir_t* filter,
+    int32_t history_buff[],
+    const int32_t coef[],
+    const exponent_t coef_exp,
+    const unsigned tap_count,
+    const unsigned frame_size,
+    const unsigned channel_count,
+    const mc_fir_layout_e layout)
+{
+  assert(channel_count <= MC_FIR_MAX_CHANNELS);
+
+  filter->coef = coef;
+  filter->coef_exp = coef_exp;
+  filter->coef_hr = vect_s32_headroom(coef, tap_count);
+  filter->tap_count = tap_count;
+  filter->frame_size = frame_size;
+  filter->channel_count = channel_count;
+  filter->layout = (layout == MC_FIR_LAYOUT_AUTO)? 
+      mc_fir_choose_layout(channel_count, tap_count) : layout;
+
+  // With the channel-parallel layout, a history element is a row of
+  // MC_FIR_LANES samples.
+  const unsigned lanes = (filter->layout == MC_FIR_LAYOUT_CHANNELS)? 
+      MC_FIR_LANES : 1;
+  filter->unit_count = (lanes == 1)? channel_count 
+                                   : MC_FIR_GROUPS(channel_count);
+
+  const unsigned capacity = MC_FIR_HISTORY_SIZE(tap_count, frame_size);
+
+  // Every history starts out silent.
+  for(int u = 0; u < filter->unit_count; u++){
+    mc_fir_unit_t* unit = &filter->unit[u];
+    history_init(&unit->history, 
+                 &history_buff[u * lanes * HISTORY_BUFFER_LENGTH(capacity)], 
+                 capacity, frame_size, lanes * sizeof(int32_t));
+    unit->exp = -200;
+    unit->hr = 31;
+    unit->acc = NULL;
+    unit->tmp = NULL;
+
+    if(lanes != 1){
+      unit->acc = (int32_t*) malloc(lanes * frame_size * sizeof(int32_t));
+      unit->tmp = (int32_t*) malloc(lanes * frame_size * sizeof(int32_t));
+      assert(unit->acc && unit->tmp);
+    }
+  }
+}
+
+
+void mc_fir_deinit(
+    mc_fir_t* filter)
+{
+  for(int u = 0; u < filter->unit_count; u++){
+    free(filter->unit[u].acc);
+    free(filter->unit[u].tmp);
+    filter->unit[u].acc = NULL;
+    filter->unit[u].tmp = NULL;
+  }
+}
+
+
+// Merge a new frame into a channel's history. This is rx_and_merge_frame() from
+// Part 3B, except that the frame has already been received.
+static
+void merge_frame(
+    mc_fir_unit_t* unit,
+    const int32_t frame_in[],
+    const exponent_t frame_in_exp,
+    const unsigned frame_size)
+{
+  const headroom_t frame_in_hr = vect_s32_headroom(frame_in, frame_size);
+
+  // Rescale if needed so the new frame and the history share an exponent
+  const exponent_t min_frame_in_exp = frame_in_exp - frame_in_hr;
+  const exponent_t min_history_exp = unit->exp - unit->hr;
+  const exponent_t new_exp = MAX(min_frame_in_exp, min_history_exp);
+
+  const right_shift_t hist_shr = new_exp - unit->exp;
+  const right_shift_t frame_in_shr = new_exp - frame_in_exp;
+
+  // Both copies of every sample in the ring buffer must be rescaled.
+  if(hist_shr) {
+    vect_s32_shr((int32_t*) unit->history.data, 
+                 (int32_t*) unit->history.data, 
+                 history_buffer_length(&unit->history),
+                 hist_shr);
+    unit->exp = new_exp;
+  }
+
+  // Merge the new frame in (reversing order), rescaling it on the way
+  int32_t* next_frame = (int32_t*) history_next_frame(&unit->history);
+  for(int k = 0; k < frame_size; k++)
+    next_frame[frame_size-k-1] = ashr32(frame_in[k], frame_in_shr);
+
+  history_commit_frame(&unit->history);
+
+  unit->hr = vect_s32_headroom((int32_t*) history_window(&unit->history), 
+                               unit->history.capacity);
+}
+
+
+//// +filter_channel
+// Tap-parallel layout: filter one channel, computing each output sample with a
+// single vect_s32_dot() over all of the taps.
+static
+void filter_channel(
+    mc_fir_t* filter,
+    mc_fir_unit_t* unit,
+    int32_t frame_out[],
+    exponent_t* frame_out_exp,
+    const int32_t frame_in[],
+    const exponent_t frame_in_exp)
+{
+  const unsigned frame_size = filter->frame_size;
+  const unsigned tap_count = filter->tap_count;
+
+  merge_frame(unit, frame_in, frame_in_exp, frame_size);
+
+  const int32_t* history = (const int32_t*) history_window(&unit->history);
+
+  // Determine the output exponent and the shifts needed, as in Part 3B.
+  right_shift_t b_shr, c_shr;
+  vect_s32_dot_prepare(frame_out_exp, &b_shr, &c_shr, 
+                       unit->exp, filter->coef_exp,
+                       unit->hr, filter->coef_hr, 
+                       tap_count);
+
+  // vect_s32_dot_prepare() ensures the result doesn't overflow the 40-bit VPU
+  // accumulators, but we need it in a 32-bit value.
+  const right_shift_t s_shr = 8;
+  *frame_out_exp += s_shr;
+
+  for(int s = 0; s < frame_size; s++){
+    int64_t acc = vect_s32_dot(&history[frame_size-s-1], 
+                               &filter->coef[0], tap_count,
+                               b_shr, c_shr);
+    frame_out[s] = sat32(ashr64(acc, s_shr));
+  }
+}
+//// -filter_channel
+
+
+// Merge a new frame of every channel in a group into the group's history. The
+// group's channels share one exponent, so it must suit the loudest of them.
+static
+void merge_group_frame(
+    mc_fir_unit_t* unit,
+    const int32_t frame_in[],
+    const exponent_t frame_in_exp[],
+    const unsigned lanes,
+    const unsigned frame_size)
+{
+  exponent_t new_exp = unit->exp - unit->hr;
+  for(int lane = 0; lane < lanes; lane++){
+    const headroom_t hr = vect_s32_headroom(&frame_in[lane * frame_size], 
+                                            frame_size);
+    new_exp = MAX(new_exp, frame_in_exp[lane] - hr);
+  }
+
+  const right_shift_t hist_shr = new_exp - unit->exp;
+
+  // Both copies of every sample in the ring buffer must be rescaled.
+  if(hist_shr) {
+    vect_s32_shr((int32_t*) unit->history.data, 
+                 (int32_t*) unit->history.data, 
+                 MC_FIR_LANES * history_buffer_length(&unit->history),
+                 hist_shr);
+    unit->exp = new_exp;
+  }
+
+  // Each row of the new frame holds one sample of each channel. Rows are in
+  // reverse order, as usual. Lanes beyond the last channel are never written,
+  // and so stay zero.
+  int32_t* next_frame = (int32_t*) history_next_frame(&unit->history);
+  for(int lane = 0; lane < lanes; lane++){
+    const right_shift_t frame_in_shr = new_exp - frame_in_exp[lane];
+    const int32_t* samples = &frame_in[lane * frame_size];
+    for(int k = 0; k < frame_size; k++)
+      next_frame[(frame_size-k-1) * MC_FIR_LANES + lane] = 
+          ashr32(samples[k], frame_in_shr);
+  }
+
+  history_commit_frame(&unit->history);
+
+  unit->hr = vect_s32_headroom((int32_t*) history_window(&unit->history), 
+                               MC_FIR_LANES * unit->history.capacity);
+}
+
+
+//// +filter_group
+// Channel-parallel layout: filter a group of up to MC_FIR_LANES channels.
+//
+// Row r of the output (one sample of each channel) is the sum over taps t of
+// coef[t] times history row (r + t). For a fixed tap, the history rows needed
+// by the whole frame are contiguous, so each tap is a single vect_s32_scale()
+// of (MC_FIR_LANES * frame_size) elements, added into the accumulator.
+static
+void filter_group(
+    mc_fir_t* filter,
+    mc_fir_unit_t* unit,
+    const unsigned lanes,
+    int32_t frame_out[],
+    exponent_t frame_out_exp[],
+    const int32_t frame_in[],
+    const exponent_t frame_in_exp[])
+{
+  const unsigned frame_size = filter->frame_size;
+  const unsigned tap_count = filter->tap_count;
+  const unsigned length = MC_FIR_LANES * frame_size;
+
+  merge_group_frame(unit, frame_in, frame_in_exp, lanes, frame_size);
+
+  const int32_t* rows = (const int32_t*) history_window(&unit->history);
+
+  // Unlike vect_s32_dot(), the products are accumulated in 32 bits, so
+  // each product is given enough headroom that the sum of tap_count of them
+  // can't saturate.
+  exponent_t acc_exp;
+  right_shift_t b_shr, c_shr;
+  vect_s32_scale_prepare(&acc_exp, &b_shr, &c_shr, 
+                         unit->exp, filter->coef_exp,
+                         unit->hr, filter->coef_hr);
+  const right_shift_t sum_shr = u32_ceil_log2(tap_count);
+  b_shr += sum_shr;
+  acc_exp += sum_shr;
+
+  vect_s32_scale(unit->acc, &rows[0], length, filter->coef[0], b_shr, c_shr);
+  for(int t = 1; t < tap_count; t++){
+    vect_s32_scale(unit->tmp, &rows[t * MC_FIR_LANES], length, 
+                   filter->coef[t], b_shr, c_shr);
+    vect_s32_add(unit->acc, unit->acc, unit->tmp, length, 0, 0);
+  }
+
+  // Row r of the accumulator is output sample (frame_size-r-1) of each channel.
+  for(int lane = 0; lane < lanes; lane++){
+    int32_t* samples = &frame_out[lane * frame_size];
+    for(int r = 0; r < frame_size; r++)
+      samples[frame_size-r-1] = unit->acc[r * MC_FIR_LANES + lane];
+    frame_out_exp[lane] = acc_exp;
+  }
+}
+//// -filter_group
+
+
+void mc_fir_process_unit(
+    mc_fir_t* filter,
+    const unsigned unit,
+    int32_t frame_out[],
+    exponent_t frame_out_exp[],
+    const int32_t frame_in[],
+    const exponent_t frame_in_exp[])
+{
+  const unsigned frame_size = filter->frame_size;
+
+  if(filter->layout == MC_FIR_LAYOUT_TAPS){
+    filter_channel(filter, &filter->unit[unit],
+                   &frame_out[unit * frame_size], &frame_out_exp[unit],
+                   &frame_in[unit * frame_size], frame_in_exp[unit]);
+  } else {
+    const unsigned first = unit * MC_FIR_LANES;
+    const unsigned lanes = MIN(MC_FIR_LANES, filter->channel_count - first);
+    filter_group(filter, &filter->unit[unit], lanes,
+                 &frame_out[first * frame_size], &frame_out_exp[first],
+                 &frame_in[first * frame_size], &frame_in_exp[first]);
+  }
+}
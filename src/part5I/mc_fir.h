@@ -0,0 +1,171 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "xmath/xmath.h"
+#if HOST_BUILD
+# include "host_kernels.h"
+#endif
+#include "history.h"
+
+// Maximum number of channels a multichannel filter can apply its filter to
+#define MC_FIR_MAX_CHANNELS   (16)
+
+// Number of 32-bit lanes in the VPU. With the channel-parallel layout, each
+// group of this many channels is processed together.
+#define MC_FIR_LANES          (8)
+
+// The number of channel groups needed for the given number of channels
+#define MC_FIR_GROUPS(CHANNELS)   (((CHANNELS) + MC_FIR_LANES - 1) / MC_FIR_LANES)
+
+// Tap count at which the channel-parallel layout stops being faster than the
+// tap-parallel layout, when every VPU lane is in use. The default is a
+// placeholder; the crossover benchmark in appA1 measures it for a particular
+// device and frame size.
+#ifndef MC_FIR_CROSSOVER_TAPS
+# define MC_FIR_CROSSOVER_TAPS    (128)
+#endif
+
+// Number of samples of history kept for each channel. This is the smallest
+// multiple of the frame size which holds (tap_count + frame_size - 1) samples.
+#define MC_FIR_HISTORY_SIZE(TAP_COUNT, FRAME_SIZE)   \
+    ((((TAP_COUNT) + 2*(FRAME_SIZE) - 2) / (FRAME_SIZE)) * (FRAME_SIZE))
+
+// Number of int32_t elements of history buffer needed for each channel
+#define MC_FIR_CHANNEL_BUFFER_LENGTH(TAP_COUNT, FRAME_SIZE)   \
+    HISTORY_BUFFER_LENGTH(MC_FIR_HISTORY_SIZE(TAP_COUNT, FRAME_SIZE))
+
+// Number of int32_t elements of history buffer needed for the given number of
+// channels, whichever layout is used. The channel-parallel layout always
+// stores whole groups of channels.
+#define MC_FIR_HISTORY_BUFFER_LENGTH(CHANNELS, TAP_COUNT, FRAME_SIZE)   \
+    (MC_FIR_GROUPS(CHANNELS) * MC_FIR_LANES                          \
+      * MC_FIR_CHANNEL_BUFFER_LENGTH(TAP_COUNT, FRAME_SIZE))
+
+
+/**
+ * How a multichannel filter's sample history is stored, and so how it is
+ * vectorised.
+ */
+typedef enum {
+  // Choose a layout with mc_fir_choose_layout()
+  MC_FIR_LAYOUT_AUTO = 0,
+  // Each channel has its own history, and each VPU operation advances one
+  // channel by 8 taps (vect_s32_dot(), as in Part 3B).
+  MC_FIR_LAYOUT_TAPS = 1,
+  // Each group of MC_FIR_LANES channels shares a history in which the channels
+  // are interleaved, and each VPU operation advances 8 channels by one tap.
+  MC_FIR_LAYOUT_CHANNELS = 2,
+} mc_fir_layout_e;
+
+
+/**
+ * A unit of work for a multichannel filter: one channel with the tap-parallel
+ * layout, or one group of channels with the channel-parallel layout.
+ * 
+ * Its sample history is a BFP vector. With the channel-parallel layout, each
+ * element of the history is a row of MC_FIR_LANES samples, one per channel, and
+ * all channels of the group share the exponent.
+ */
+typedef struct {
+  history_t history;
+  exponent_t exp;
+  headroom_t hr;
+  // Scratch buffers of (MC_FIR_LANES * frame_size) elements, used only by the
+  // channel-parallel layout.
+  int32_t* acc;
+  int32_t* tmp;
+} mc_fir_unit_t;
+
+
+//// +mc_fir_t
+/**
+ * A FIR filter applied independently to each of several channels.
+ * 
+ * Every channel has its own sample history, but there is only one copy of the
+ * filter coefficients, which all channels share. So the coefficient memory is
+ * the same however many channels there are, and only the history memory grows
+ * with the channel count.
+ * 
+ * Units are independent of one another, so different units may be processed on
+ * different threads at the same time.
+ */
+typedef struct {
+  // Filter coefficients, shared by every channel
+  const int32_t* coef;
+  exponent_t coef_exp;
+  headroom_t coef_hr;
+  unsigned tap_count;
+  // Number of samples in each frame
+  unsigned frame_size;
+  // Number of channels being filtered
+  unsigned channel_count;
+  // How the sample history is stored
+  mc_fir_layout_e layout;
+  // Number of units (channels or groups of channels)
+  unsigned unit_count;
+  // The state of each unit
+  mc_fir_unit_t unit[MC_FIR_MAX_CHANNELS];
+} mc_fir_t;
+//// -mc_fir_t
+
+
+/**
+ * Choose the faster layout for the given number of channels and taps.
+ * 
+ * The channel-parallel layout makes one call per tap, each covering a whole
+ * frame of a group of channels, where the tap-parallel layout makes one call
+ * per output sample. With few taps, the per-call overhead dominates and the
+ * channel-parallel layout wins. Its advantage shrinks as the tap count grows,
+ * and when groups are only partly filled, because lanes are wasted.
+ */
+mc_fir_layout_e mc_fir_choose_layout(
+    const unsigned channel_count,
+    const unsigned tap_count);
+
+/**
+ * Initialize a multichannel filter.
+ * 
+ * `history_buff` must have room for
+ * MC_FIR_HISTORY_BUFFER_LENGTH(channel_count, tap_count, frame_size) elements.
+ * `coef[]` is not copied, and must remain valid for as long as the filter is
+ * used. If `layout` is MC_FIR_LAYOUT_AUTO, mc_fir_choose_layout() is used.
+ */
+void mc_fir_init(
+    mc_fir_t* filter,
+    int32_t history_buff[],
+    const int32_t coef[],
+    const exponent_t coef_exp,
+    const unsigned tap_count,
+    const unsigned frame_size,
+    const unsigned channel_count,
+    const mc_fir_layout_e layout);
+
+/**
+ * Free the scratch memory allocated by mc_fir_init(). The history buffer
+ * belongs to the caller.
+ */
+void mc_fir_deinit(
+    mc_fir_t* filter);
+
+/**
+ * Filter one frame of the channels belonging to one unit.
+ * 
+ * `frame_in[]` and `frame_out[]` hold one frame of `frame_size` samples for
+ * each of the filter's channels, one channel after another, and
+ * `frame_in_exp[]` and `frame_out_exp[]` hold the exponent of each channel's
+ * frame. Only the unit's own channels are read or written. Output exponents are
+ * chosen to avoid saturation.
+ * 
+ * Calls for different units may run concurrently.
+ */
+void mc_fir_process_unit(
+    mc_fir_t* filter,
+    const unsigned unit,
+    int32_t frame_out[],
+    exponent_t frame_out_exp[],
+    const int32_t frame_in[],
+    const exponent_t frame_in_exp[]);
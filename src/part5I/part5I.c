@@ -0,0 +1,209 @@
+// Copyright 2022-2023 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+#include <assert.h>
+
+#include "common.h"
+#include "pool.h"
+#include "mc_fir.h"
+
+// The maximum number of threads the channels are distributed across. No more
+// threads than there are channels are used.
+#ifndef THREADS
+# define THREADS        (POOL_MAX_THREADS)
+#endif
+
+// The history layout used by the filter. By default, it is chosen from the
+// channel count and tap count. (See mc_fir_choose_layout())
+#ifndef LAYOUT
+# define LAYOUT         (MC_FIR_LAYOUT_AUTO)
+#endif
+
+extern 
+const q2_30 filter_coef[TAP_COUNT];
+
+
+// One frame of every channel, each with its own exponent
+typedef struct {
+  int32_t data[MC_FIR_MAX_CHANNELS][FRAME_SIZE];
+  exponent_t exp[MC_FIR_MAX_CHANNELS];
+} multichannel_frame_t;
+
+
+//// +rx_frame
+// Accept a frame of new audio data for each channel
+static inline 
+void rx_frame(
+    multichannel_frame_t* frame_in,
+    const unsigned channel_count,
+    const chanend_t c_audio)
+{
+  timer_start(TIMING_PHASE_RX);
+
+  // tile[0] sends one frame per channel, in channel order.
+  for(int ch = 0; ch < channel_count; ch++)
+    frame_receive(c_audio, frame_in->data[ch], FRAME_SIZE, &frame_in->exp[ch]);
+
+  timer_start(TIMING_FRAME);
+
+  timer_stop(TIMING_PHASE_RX);
+}
+//// -rx_frame
+
+
+//// +tx_frame
+// Send a frame of new audio data for each channel
+static inline 
+void tx_frame(
+    const chanend_t c_audio,
+    const multichannel_frame_t* frame_out,
+    const unsigned channel_count)
+{
+  const exponent_t output_exp = -31;
+
+  timer_stop(TIMING_FRAME);
+  timer_start(TIMING_PHASE_TX);
+
+  // The output channel is expecting PCM samples with a *fixed* exponent of
+  // output_exp, so each channel's frame is converted before sending.
+  for(int ch = 0; ch < channel_count; ch++){
+    const right_shift_t samp_shr = output_exp - frame_out->exp[ch];
+
+    int32_t samples[FRAME_SIZE];
+    for(int k = 0; k < FRAME_SIZE; k++)
+      samples[k] = ashr32(frame_out->data[ch][k], samp_shr);
+
+    frame_send(c_audio, samples, FRAME_SIZE, output_exp);
+  }
+
+  timer_stop(TIMING_PHASE_TX);
+}
+//// -tx_frame
+
+
+//// +filter_channels
+// The parameters shared by every thread working on a frame
+typedef struct {
+  mc_fir_t* filter;
+  const multichannel_frame_t* frame_in;
+  multichannel_frame_t* frame_out;
+} frame_job_t;
+
+
+// Filter one thread's share of the channels. The filter's units (single
+// channels or groups of channels, depending on its layout) are dealt out to the
+// threads in turn, so no two threads ever touch the same history.
+static
+void filter_channels(
+    void* ctx,
+    unsigned index,
+    unsigned count)
+{
+  const frame_job_t* job = (const frame_job_t*) ctx;
+
+  for(int u = index; u < job->filter->unit_count; u += count){
+    mc_fir_process_unit(job->filter, u,
+                        &job->frame_out->data[0][0], 
+                        &job->frame_out->exp[0],
+                        &job->frame_in->data[0][0], 
+                        &job->frame_in->exp[0]);
+  }
+}
+//// -filter_channels
+
+
+//// +filter_loop
+/**
+ * The thread which receives, filters and sends each frame, using the pool's
+ * workers to filter several channels at once.
+ */
+DECLARE_JOB(filter_loop, (chanend_t, pool_t*));
+void filter_loop(
+    chanend_t c_audio,
+    pool_t* pool)
+{
+  // Before any audio, tile[0] sends the number of channels in the input.
+  const unsigned channel_count = chan_in_word(c_audio);
+  assert(channel_count > 0 && channel_count <= MC_FIR_MAX_CHANNELS);
+
+  // Each channel's history is MC_FIR_CHANNEL_BUFFER_LENGTH() elements. The
+  // coefficients are not copied.
+  static int32_t history_buff[MC_FIR_HISTORY_BUFFER_LENGTH(MC_FIR_MAX_CHANNELS,
+                                                           TAP_COUNT, 
+                                                           FRAME_SIZE)];
+  static mc_fir_t filter;
+  mc_fir_init(&filter, &history_buff[0], 
+              (const int32_t*) &filter_coef[0], -30, 
+              TAP_COUNT, FRAME_SIZE, channel_count, LAYOUT);
+
+  static multichannel_frame_t frame_in;
+  static multichannel_frame_t frame_out;
+
+  frame_job_t job = { &filter, &frame_in, &frame_out };
+
+  const unsigned threads = MIN(THREADS, filter.unit_count);
+
+  // Channel-samples filtered per second, not counting frame transfers.
+  static float reported_channels = 0;
+  static float channel_throughput = 0;
+  uint64_t total_ticks = 0;
+  unsigned frame_count = 0;
+  static float reported_layout = 0;
+  reported_channels = channel_count;
+  reported_layout = filter.layout;
+  timer_report_series("channel_count", &reported_channels, 1);
+  timer_report_series("layout", &reported_layout, 1);
+  timer_report_series("channel_throughput", &channel_throughput, 1);
+
+  // Loop forever
+  while(1) {
+
+    // Read in a new frame for every channel
+    rx_frame(&frame_in, channel_count, c_audio);
+
+    // Filter every channel. Sample time is per channel-sample.
+    timer_start(TIMING_PHASE_COMPUTE);
+    const uint32_t t0 = get_reference_time();
+    timer_start(TIMING_SAMPLE);
+    pool_run(pool, filter_channels, &job, threads);
+    timer_stop_count(TIMING_SAMPLE, FRAME_SIZE * channel_count);
+    timer_stop(TIMING_PHASE_COMPUTE);
+    total_ticks += get_reference_time() - t0;
+    frame_count++;
+
+    // reference clock freq is 100 MHz
+    channel_throughput = 
+        (100.0e6f * FRAME_SIZE * channel_count * frame_count) / total_ticks;
+
+    // Send out the processed frames
+    tx_frame(c_audio, &frame_out, channel_count);
+  }
+}
+//// -filter_loop
+
+
+//// +filter_task
+/**
+ * This is the thread entry point for the hardware thread which will actually 
+ * be applying the FIR filter.
+ * 
+ * `c_audio` is the channel over which PCM audio data is exchanged with tile[0].
+ */
+void filter_task(
+    chanend_t c_audio)
+{
+  static pool_t pool;
+  pool_init(&pool, POOL_MAX_WORKERS);
+
+  // The filter loop and the pool's workers are started once, and never return.
+  PAR_JOBS(
+    PJOB(filter_loop, (c_audio, &pool)),
+    PJOB(pool_worker, (&pool, 0)),
+    PJOB(pool_worker, (&pool, 1)),
+    PJOB(pool_worker, (&pool, 2)),
+    PJOB(pool_worker, (&pool, 3)),
+    PJOB(pool_worker, (&pool, 4)),
+    PJOB(pool_worker, (&pool, 5))
+  );
+}
+//// -filter_task